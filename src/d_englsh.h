@@ -352,6 +352,10 @@
 #define STSTR_CHOPPERS  "... doesn't suck - GM"
 #define STSTR_CLEV      "Changing Level..."
 
+#define STSTR_REWIND    "Rewound"
+#define STSTR_NOREWIND  "No Snapshot To Rewind To"
+#define STSTR_DIFF      "Snapshot Differences Listed"
+
 //
 //      F_Finale.C
 //
@@ -55,6 +55,7 @@ typedef enum
     ga_completed,
     ga_victory,
     ga_worlddone,
+    ga_rewind,
     ga_screenshot
 } gameaction_t;
 
@@ -96,10 +97,6 @@ typedef enum
 //
 #define MAXEVENTS               64
 
-extern  event_t         events[MAXEVENTS];
-extern  int             eventhead;
-extern  int             eventtail;
-
 extern  gameaction_t    gameaction;
 
 #endif  // __D_EVENT__
@@ -0,0 +1,288 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Demo farm. The game keeps all of its state in globals, so
+//      one process can only play one demo. Instead the process
+//      that has loaded the WADs and set up the renderer forks a
+//      worker per demo, which shares the loaded data copy on
+//      write, times the demo like -timedemo and sends the
+//      results back through a pipe.
+//
+//      -farm <demo> ... [-farmjobs <n>]
+//
+//      The workers run without sound. Best used with a HEADLESS
+//      build, otherwise each worker opens a window of its own.
+//
+//-----------------------------------------------------------------------------
+
+// For fork and sysconf.
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef MC1
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "d_main.h"
+#include "g_game.h"
+#include "i_system.h"
+#include "m_argv.h"
+
+#include "d_farm.h"
+
+#ifndef MC1
+
+#define MAXFARMDEMOS    64
+
+typedef struct
+{
+    int         tics;
+    int         frames;
+    long long   time;           // in us, from the fork
+    long long   rendertime;     // in R_RenderPlayerView
+
+} farmresult_t;
+
+typedef struct
+{
+    char*       name;
+    pid_t       pid;
+    int         fd;             // read end of the pipe
+    boolean     ok;
+    farmresult_t result;
+
+} farmjob_t;
+
+static farmjob_t farmjobs[MAXFARMDEMOS];
+static int      numfarmjobs;
+
+// In a worker, the write end of its pipe.
+static int      farmfd = -1;
+static long long farmstart;
+
+
+//
+// D_FarmWorker
+// Plays the demo as -timedemo does, never returns.
+//
+static void D_FarmWorker (char* name, int fd)
+{
+    farmfd = fd;
+    farmstart = I_GetTimeUS ();
+    rendertime = 0;
+    renderframes = 0;
+
+    G_TimeDemo (name);
+    D_DoomLoop ();
+}
+
+//
+// D_FarmDone
+//
+void D_FarmDone (void)
+{
+    farmresult_t result;
+
+    if (farmfd == -1)
+        return;
+
+    result.tics = gametic;
+    result.frames = renderframes;
+    result.time = I_GetTimeUS () - farmstart;
+    result.rendertime = rendertime;
+
+    // small enough to go through the pipe in one piece
+    if (write (farmfd, &result, sizeof(result)) != sizeof(result))
+        _exit (1);
+    _exit (0);
+}
+
+//
+// D_StartFarmJob
+//
+static void D_StartFarmJob (farmjob_t* job)
+{
+    int         fds[2];
+
+    if (pipe (fds) == -1)
+        I_Error ("D_RunFarm: couldn't create a pipe");
+
+    // don't let the worker write out what is still buffered here
+    fflush (stdout);
+    fflush (stderr);
+
+    job->pid = fork ();
+    if (job->pid == -1)
+        I_Error ("D_RunFarm: couldn't fork");
+
+    if (!job->pid)
+    {
+        close (fds[0]);
+        D_FarmWorker (job->name, fds[1]);
+    }
+
+    close (fds[1]);
+    job->fd = fds[0];
+}
+
+//
+// D_FinishFarmJob
+// Collects the results of a worker that has exited.
+//
+static void D_FinishFarmJob (farmjob_t* job, int status)
+{
+    job->ok = WIFEXITED (status) && !WEXITSTATUS (status)
+        && read (job->fd, &job->result, sizeof(job->result))
+           == sizeof(job->result);
+    close (job->fd);
+    job->pid = 0;
+
+    if (!job->ok)
+        fprintf (stderr, "D_RunFarm: %s failed\n", job->name);
+}
+
+static void D_PrintFarmReport (int workers, long long walltime)
+{
+    farmjob_t*  job;
+    int         i;
+    int         failed;
+    long long   tics;
+    long long   time;
+    long long   frames;
+    long long   render;
+
+    failed = 0;
+    tics = time = frames = render = 0;
+
+    printf ("\n%-12s %8s %8s %8s %10s %14s\n",
+            "demo", "tics", "ms", "tics/s", "frames", "render ms/frame");
+    for (i=0, job=farmjobs ; i<numfarmjobs ; i++, job++)
+    {
+        if (!job->ok)
+        {
+            printf ("%-12s %8s\n", job->name, "failed");
+            failed++;
+            continue;
+        }
+        printf ("%-12s %8i %8lli %8lli %10i %14.3f\n", job->name,
+                job->result.tics, job->result.time/1000,
+                job->result.time ?
+                job->result.tics*1000000LL/job->result.time : 0,
+                job->result.frames,
+                job->result.frames ?
+                job->result.rendertime/1000.0/job->result.frames : 0.0);
+        tics += job->result.tics;
+        time += job->result.time;
+        frames += job->result.frames;
+        render += job->result.rendertime;
+    }
+
+    printf ("%-12s %8lli %8lli %8lli %10lli %14.3f\n", "total",
+            tics, time/1000, time ? tics*1000000LL/time : 0,
+            frames, frames ? render/1000.0/frames : 0.0);
+    printf ("%i demos on %i workers in %lli ms, %lli tics/s overall\n",
+            numfarmjobs - failed, workers, walltime/1000,
+            walltime ? tics*1000000LL/walltime : 0);
+
+    if (failed)
+        I_Error ("D_RunFarm: %i of %i demos failed", failed, numfarmjobs);
+}
+
+//
+// D_RunFarm
+//
+void D_RunFarm (void)
+{
+    int         p;
+    int         workers;
+    int         running;
+    int         next;
+    int         status;
+    int         i;
+    pid_t       pid;
+    long long   starttime;
+
+    p = M_CheckParm ("-farm");
+    if (!p)
+        return;
+
+    while (++p != myargc && myargv[p][0] != '-')
+    {
+        if (numfarmjobs == MAXFARMDEMOS)
+            I_Error ("D_RunFarm: more than %i demos", MAXFARMDEMOS);
+        farmjobs[numfarmjobs++].name = myargv[p];
+    }
+
+    workers = sysconf (_SC_NPROCESSORS_ONLN);
+    p = M_CheckParm ("-farmjobs");
+    if (p && p < myargc-1)
+        workers = atoi (myargv[p+1]);
+    if (workers > numfarmjobs)
+        workers = numfarmjobs;
+    if (workers < 1)
+        workers = 1;
+
+    printf ("D_RunFarm: %i demos on %i workers.\n", numfarmjobs, workers);
+    starttime = I_GetTimeUS ();
+
+    running = next = 0;
+    while (next < numfarmjobs || running)
+    {
+        while (running < workers && next < numfarmjobs)
+        {
+            D_StartFarmJob (&farmjobs[next++]);
+            running++;
+        }
+
+        pid = waitpid (-1, &status, 0);
+        if (pid == -1)
+            I_Error ("D_RunFarm: lost the workers");
+
+        for (i=0 ; i<next ; i++)
+        {
+            if (farmjobs[i].pid == pid)
+            {
+                D_FinishFarmJob (&farmjobs[i], status);
+                running--;
+                break;
+            }
+        }
+    }
+
+    D_PrintFarmReport (workers, I_GetTimeUS () - starttime);
+    I_Quit ();
+}
+
+#else
+
+void D_RunFarm (void)
+{
+    if (M_CheckParm ("-farm"))
+        I_Error ("D_RunFarm: there are no processes to fork");
+}
+
+void D_FarmDone (void)
+{
+}
+
+#endif  // MC1
@@ -0,0 +1,32 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Demo farm, times many demos in parallel worker processes.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __D_FARM__
+#define __D_FARM__
+
+// Called by D_DoomMain once everything is set up.
+// With -farm <demo> ... it runs the demos, reports and exits.
+void D_RunFarm (void);
+
+// Called at the end of a timed demo. In a worker it sends
+//  the results to the farm and exits, otherwise it returns.
+void D_FarmDone (void);
+
+#endif  // __D_FARM__
@@ -261,6 +261,10 @@
 #define STSTR_CHOPPERS          "... DOESN'T SUCK - GM"
 #define STSTR_CLEV              "CHANGEMENT DE NIVEAU..."
 
+#define STSTR_REWIND            "RETOUR EN ARRIERE"
+#define STSTR_NOREWIND          "PAS DE RETOUR POSSIBLE"
+#define STSTR_DIFF              "DIFFERENCES LISTEES"
+
 //
 //      F_Finale.C
 //
@@ -24,6 +24,7 @@
 #define BGCOLOR         7
 #define FGCOLOR         8
 
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
@@ -58,6 +59,9 @@
 #include "st_stuff.h"
 #include "am_map.h"
 
+#include "p_rewind.h"
+#include "p_sync.h"
+#include "d_farm.h"
 #include "p_setup.h"
 #include "r_local.h"
 
@@ -84,6 +88,7 @@ boolean         fastparm;       // checkparm of -fast
 boolean         drone;
 
 boolean         singletics = false; // debug flag to cancel adaptiveness
+boolean         uncapped;       // checkparm of -uncapped
 
 //extern int soundVolume;
 //extern  int   sfxVolume;
@@ -100,6 +105,9 @@ FILE*           debugfile;
 
 boolean         advancedemo;
 
+long long       rendertime;
+int             renderframes;
+
 char            wadfile[1024];          // primary wad file
 char            mapdir[1024];           // directory of development maps
 char            basedefault[1024];      // default file
@@ -115,9 +123,31 @@ void D_DoAdvanceDemo (void);
 // Events are asynchronous inputs generally generated by the game user.
 // Events can be discarded if no responder claims them
 //
-event_t         events[MAXEVENTS];
-int             eventhead;
-int             eventtail;
+// The queue has a single producer (the I/O code, which may run on
+// a thread of its own) and a single consumer (the game loop), so the
+// head and tail are updated without locking.
+//
+static event_t          events[MAXEVENTS];
+static long long        eventtimes[MAXEVENTS];  // when posted, in us
+static atomic_int       eventhead;
+static atomic_int       eventtail;
+
+// When the last event taken from the queue was posted.
+static long long        eventtime;
+
+// Input latency is measured from when an event was posted to when
+// the first frame that reflects it is shown. Game input only shows
+// once the ticcmd built from it has been run, so its time follows
+// the ticcmd. Each of these is the oldest time, -1 if none.
+static long long        pendinginput = -1;      // not in a ticcmd yet
+static long long        ticinput[BACKUPTICS];   // in a ticcmd, not run
+static long long        frameinput = -1;        // run, not drawn
+
+// Input to present latency histogram. Bucket 0 counts latencies
+// below 1 ms, bucket i counts 2^(i-1) to 2^i ms, and the last
+// bucket counts everything above that.
+#define NUMLATENCYBUCKETS       9
+static int              inputlatency[NUMLATENCYBUCKETS];
 
 //
 // D_PostEvent
@@ -125,8 +155,131 @@ int             eventtail;
 //
 void D_PostEvent (event_t* ev)
 {
-    events[eventhead++] = *ev;
-    eventhead &= (MAXEVENTS-1);
+    int         head;
+    int         next;
+
+    head = atomic_load_explicit (&eventhead, memory_order_relaxed);
+    next = (head+1) & (MAXEVENTS-1);
+
+    // Drop the event if the queue is full. Only the game loop
+    // moves the tail, so the oldest unread event can't make way.
+    // The old ring wrapped instead and lost all unread events.
+    if (next == atomic_load_explicit (&eventtail, memory_order_acquire))
+        return;
+
+    events[head] = *ev;
+    eventtimes[head] = I_GetTimeUS ();
+    atomic_store_explicit (&eventhead, next, memory_order_release);
+}
+
+//
+// D_GetEvent
+// Takes the next event from the queue, returns false if empty
+//
+boolean D_GetEvent (event_t* ev)
+{
+    int         tail;
+
+    tail = atomic_load_explicit (&eventtail, memory_order_relaxed);
+    if (tail == atomic_load_explicit (&eventhead, memory_order_acquire))
+        return false;
+
+    *ev = events[tail];
+    eventtime = eventtimes[tail];
+    atomic_store_explicit (&eventtail, (tail+1) & (MAXEVENTS-1),
+                           memory_order_release);
+    return true;
+}
+
+//
+// D_MergeInput
+// Keeps the oldest of two input times
+//
+static void D_MergeInput (long long* time, long long other)
+{
+    if (other >= 0 && (*time < 0 || other < *time))
+        *time = other;
+}
+
+//
+// D_TicInput
+// Called when the ticcmd for the given tic has been built
+//
+void D_TicInput (int tic)
+{
+    ticinput[tic%BACKUPTICS] = pendinginput;
+    pendinginput = -1;
+}
+
+//
+// D_RunTicInput
+// Called when the ticcmds for the given tic are run
+//
+void D_RunTicInput (int tic)
+{
+    D_MergeInput (&frameinput, ticinput[tic%BACKUPTICS]);
+    ticinput[tic%BACKUPTICS] = -1;
+}
+
+//
+// D_TakeInputTime
+// Returns when the oldest input that has been run since the
+// last call was posted, -1 if none.
+// Called by the video code when a frame is drawn.
+//
+long long D_TakeInputTime (void)
+{
+    long long   time;
+
+    time = frameinput;
+    frameinput = -1;
+    return time;
+}
+
+//
+// D_AddInputLatency
+// Called by the video code when a frame is shown,
+// with the input time that was taken for it
+//
+void D_AddInputLatency (long long time)
+{
+    long long   ms;
+    int         bucket;
+
+    if (time < 0)
+        return;
+
+    ms = (I_GetTimeUS () - time) / 1000;
+    for (bucket = 0 ; ms > 0 && bucket < NUMLATENCYBUCKETS-1 ; bucket++)
+        ms >>= 1;
+    inputlatency[bucket]++;
+}
+
+//
+// D_PrintInputLatency
+//
+void D_PrintInputLatency (void)
+{
+    int         i;
+    int         total;
+
+    total = 0;
+    for (i=0 ; i<NUMLATENCYBUCKETS ; i++)
+        total += inputlatency[i];
+    if (!total)
+        return;
+
+    printf ("D_PrintInputLatency: input to present latency:\n");
+    for (i=0 ; i<NUMLATENCYBUCKETS ; i++)
+    {
+        if (i == 0)
+            printf ("      < 1 ms");
+        else if (i < NUMLATENCYBUCKETS-1)
+            printf ("  %3d-%3d ms", 1 << (i-1), 1 << i);
+        else
+            printf ("    >= %3d ms", 1 << (i-1));
+        printf (": %d\n", inputlatency[i]);
+    }
 }
 
 //
@@ -135,20 +288,23 @@ void D_PostEvent (event_t* ev)
 //
 void D_ProcessEvents (void)
 {
-    event_t*    ev;
+    event_t     ev;
 
     // IF STORE DEMO, DO NOT ACCEPT INPUT
     if ( ( gamemode == commercial )
          && (W_CheckNumForName("map01")<0) )
       return;
 
-    for ( ; eventtail != eventhead ; )
+    while (D_GetEvent (&ev))
     {
-        ev = &events[eventtail++];
-        eventtail &= (MAXEVENTS - 1);
-        if (M_Responder (ev))
-            continue;               // menu ate the event
-        G_Responder (ev);
+        if (M_Responder (&ev))
+        {
+            // menu ate the event, it shows on the next frame
+            D_MergeInput (&frameinput, eventtime);
+            continue;
+        }
+        G_Responder (&ev);
+        D_MergeInput (&pendinginput, eventtime);
     }
 }
 
@@ -240,7 +396,23 @@ void D_Display (void)
 
     // draw the view directly
     if (gamestate == GS_LEVEL && !automapactive && gametic)
+    {
+        interpfrac = uncapped && !singletics ? I_GetTimeFrac () : FRACUNIT;
+        rendertime -= I_GetTimeUS ();
         R_RenderPlayerView (&players[displayplayer]);
+        rendertime += I_GetTimeUS ();
+        renderframes++;
+        V_MarkRect (viewwindowx, viewwindowy, scaledviewwidth, viewheight);
+
+        if (levelloadtime)
+        {
+            if (devparm)
+                fprintf (stderr, "D_Display: first frame %lld ms after load\n",
+                         (I_GetTimeUS () - levelloadtime) / 1000);
+            levelloadtime = 0;
+            W_ResetMisses ();
+        }
+    }
 
     if (gamestate == GS_LEVEL && gametic)
         HU_Drawer ();
@@ -303,11 +475,9 @@ void D_Display (void)
 
     do
     {
-        do
-        {
-            nowtime = I_GetTime ();
-            tics = nowtime - wipestart;
-        } while (!tics);
+        I_WaitTic (wipestart + 1);
+        nowtime = I_GetTime ();
+        tics = nowtime - wipestart;
         wipestart = nowtime;
         done = wipe_ScreenWipe(wipe_Melt
                                , 0, 0, SCREENWIDTH, SCREENHEIGHT, tics);
@@ -324,6 +494,11 @@ extern  boolean         demorecording;
 
 void D_DoomLoop (void)
 {
+    int         i;
+
+    for (i=0 ; i<BACKUPTICS ; i++)
+        ticinput[i] = -1;
+
     if (demorecording)
         G_BeginRecording ();
 
@@ -353,6 +528,8 @@ void D_DoomLoop (void)
             I_StartTic ();
             D_ProcessEvents ();
             G_BuildTiccmd (&netcmds[consoleplayer][maketic%BACKUPTICS]);
+            D_TicInput (maketic);
+            D_RunTicInput (maketic);
             if (advancedemo)
                 D_DoAdvanceDemo ();
             M_Ticker ();
@@ -365,6 +542,10 @@ void D_DoomLoop (void)
             TryRunTics (); // will run at least one tic
         }
 
+        // nothing is drawn or heard while seeking
+        if (G_Seeking ())
+            continue;
+
         S_UpdateSounds (players[consoleplayer].mo);  // move positional sounds
 
         // Update display, next frame, with current state.
@@ -400,7 +581,7 @@ void D_PageTicker (void)
 //
 void D_PageDrawer (void)
 {
-    V_DrawPatchScaled (0,0, 0, W_CacheLumpName(pagename, PU_CACHE));
+    V_DrawPatchScaledNum (0,0,0,W_GetNumForName(pagename));
 }
 
 //
@@ -759,6 +940,9 @@ void D_DoomMain (void)
     nomonsters = M_CheckParm ("-nomonsters");
     respawnparm = M_CheckParm ("-respawn");
     fastparm = M_CheckParm ("-fast");
+    levelcache = M_CheckParm ("-levelcache");
+    nolevelsnapshot = M_CheckParm ("-nosnapshot");
+    uncapped = M_CheckParm ("-uncapped");
     devparm = M_CheckParm ("-devparm");
     if (M_CheckParm ("-altdeath"))
         deathmatch = 2;
@@ -901,11 +1085,23 @@ void D_DoomMain (void)
     if (!p)
         p = M_CheckParm ("-timedemo");
 
-    if (p && p < myargc-1)
+    // -playdemo can name more demos, played in turn
+    while (p && p < myargc-1 && myargv[p+1][0] != '-')
     {
-        sprintf (file,"%s.lmp", myargv[p+1]);
+        sprintf (file,"%s.lmp", myargv[++p]);
         D_AddFile (file);
-        printf("Playing demo %s.lmp.\n",myargv[p+1]);
+        printf("Playing demo %s.lmp.\n",myargv[p]);
+    }
+
+    // the demos for the farm workers
+    p = M_CheckParm ("-farm");
+    if (p)
+    {
+        while (++p != myargc && myargv[p][0] != '-')
+        {
+            sprintf (file,"%s.lmp", myargv[p]);
+            D_AddFile (file);
+        }
     }
 
     // get skill / episode / map from parms
@@ -1044,6 +1240,8 @@ void D_DoomMain (void)
 
     printf ("\nP_Init: Init Playloop state.\n");
     P_Init ();
+    P_InitRewind ();
+    P_InitSync ();
 
     printf ("I_Init: Setting up machine state.\n");
     I_Init ();
@@ -1071,6 +1269,9 @@ void D_DoomMain (void)
         printf ("External statistics registered.\n");
     }
 
+    // fork the demo farm workers now that everything is loaded
+    D_RunFarm ();
+
     // start the apropriate game based on parms
     p = M_CheckParm ("-record");
 
@@ -1080,10 +1281,15 @@ void D_DoomMain (void)
         autostart = true;
     }
 
+    // run up to a tic before drawing anything
+    p = M_CheckParm ("-skiptic");
+    if (p && p < myargc-1)
+        G_SeekTic (atoi (myargv[p+1]));
+
     p = M_CheckParm ("-playdemo");
     if (p && p < myargc-1)
     {
-        singledemo = true;              // quit after one demo
+        singledemo = true;              // quit after the demos
         G_DeferedPlayDemo (myargv[p+1]);
         D_DoomLoop ();  // never returns
     }
@@ -36,9 +36,35 @@ void D_AddFile (const char *file);
 //
 void D_DoomMain (void);
 
+// Called by D_DoomMain and the demo farm workers, never returns.
+void D_DoomLoop (void);
+
+// Time spent in R_RenderPlayerView and the frames it drew.
+extern long long        rendertime;
+extern int              renderframes;
+
 // Called by IO functions when input is detected.
+// May be called from a thread other than the game loop.
 void D_PostEvent (event_t* ev);
 
+// Takes the next posted event, returns false if there is none.
+boolean D_GetEvent (event_t* ev);
+
+// Called by the net code when the ticcmd for a tic has been
+// built, and when the ticcmds for a tic are run.
+void D_TicInput (int tic);
+void D_RunTicInput (int tic);
+
+// Called by IO functions when a frame is drawn, returns
+// I_GetTimeUS for the oldest input that the frame reflects,
+// or -1 if there was no new input.
+long long D_TakeInputTime (void);
+
+// Called by IO functions when the frame is shown, with the time
+// from D_TakeInputTime. Adds to the input latency histogram.
+void D_AddInputLatency (long long time);
+void D_PrintInputLatency (void);
+
 //
 // BASE LEVEL
 //
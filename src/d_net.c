@@ -19,6 +19,7 @@
 //
 //-----------------------------------------------------------------------------
 
+#include "d_main.h"
 #include "m_menu.h"
 #include "i_system.h"
 #include "i_video.h"
@@ -358,6 +359,10 @@ void NetUpdate (void)
     newtics = nowtime - gametime;
     gametime = nowtime;
 
+    // make as many tics as will fit while seeking
+    if (gametic < seektic)
+        newtics = BACKUPTICS;
+
     if (newtics <= 0)   // nothing new to update
         goto listen;
 
@@ -385,6 +390,7 @@ void NetUpdate (void)
 
         //printf ("mk:%i ",maketic);
         G_BuildTiccmd (&localcmds[maketic%BACKUPTICS]);
+        D_TicInput (maketic);
         maketic++;
     }
 
@@ -428,19 +434,20 @@ void NetUpdate (void)
 //
 void CheckAbort (void)
 {
-    event_t *ev;
+    event_t     ev;
     int         stoptic;
 
     stoptic = I_GetTime () + 2;
     while (I_GetTime() < stoptic)
+    {
         I_StartTic ();
+        I_Sleep (1000);
+    }
 
     I_StartTic ();
-    for (; eventtail != eventhead;)
+    while (D_GetEvent (&ev))
     {
-        ev = &events[eventtail++];
-        eventtail &= (MAXEVENTS - 1);
-        if (ev->type == ev_keydown && ev->data1 == KEY_ESCAPE)
+        if (ev.type == ev_keydown && ev.data1 == KEY_ESCAPE)
             I_Error ("Network game synchronization aborted.");
     }
 }
@@ -645,9 +652,22 @@ void TryRunTics (void)
     else
         counts = availabletics;
 
+    // run what there is while seeking, but not past it
+    if (gametic < seektic)
+    {
+        counts = availabletics;
+        if (counts > (seektic - gametic)/ticdup)
+            counts = (seektic - gametic)/ticdup;
+    }
+
     if (counts < 1)
         counts = 1;
 
+    // with an uncapped frame rate, draw another frame
+    // instead of waiting for the next tic
+    if (uncapped && !netgame && lowtic < gametic/ticdup + counts)
+        return;
+
     frameon++;
 
     if (debugfile)
@@ -702,6 +722,17 @@ void TryRunTics (void)
             M_Ticker ();
             return;
         }
+
+        // sleep instead of spinning until there is something to run,
+        // local tics are only made once per tic but other nodes
+        // can deliver theirs at any time
+        if (lowtic < gametic/ticdup + counts)
+        {
+            if (netgame)
+                I_Sleep (1000);
+            else
+                I_WaitTic ((gametime+1)*ticdup);
+        }
     }
 
     // run the count * ticdup dics
@@ -714,6 +745,7 @@ void TryRunTics (void)
             if (advancedemo)
                 D_DoAdvanceDemo ();
             M_Ticker ();
+            D_RunTicInput (gametic/ticdup);
             G_Ticker ();
             gametic++;
 
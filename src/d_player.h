@@ -150,6 +150,9 @@ typedef struct player_s
     // True if secret level has been done.
     boolean             didsecret;
 
+    // viewz at the start of the tic, for render interpolation.
+    fixed_t             oldviewz;
+
 } player_t;
 
 //
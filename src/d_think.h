@@ -46,6 +46,19 @@ typedef union
 //  an actor.
 typedef actionf_t  think_t;
 
+// Thinker classes. Every thinker is also linked into
+//  the list of its class, so that scans for a certain
+//  kind of thinker do not have to walk all of them.
+typedef enum
+{
+    th_mobj,            // P_MobjThinker
+    th_mover,           // ceilings, doors, floors, plats
+    th_light,           // flashes, strobes, glows, flickers
+    th_misc,
+    NUMTHCLASSES
+
+} thclass_t;
+
 // Doubly linked list of actors.
 typedef struct thinker_s
 {
@@ -53,6 +66,10 @@ typedef struct thinker_s
     struct thinker_s*   next;
     think_t             function;
 
+    // Links in the list of the thinker class.
+    struct thinker_s*   cprev;
+    struct thinker_s*   cnext;
+
 } thinker_t;
 
 #endif  // __D_THINK__
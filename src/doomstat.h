@@ -127,6 +127,9 @@ extern  boolean         viewactive;
 extern  boolean         nodrawers;
 extern  boolean         noblit;
 
+// Tic to run up to without drawing, 0 if not seeking.
+extern  int             seektic;
+
 extern  int             viewwindowx;
 extern  int             viewwindowy;
 extern  int             viewheight;
@@ -166,6 +169,9 @@ extern  boolean demorecording;
 // Quit after playing a demo from cmdline.
 extern  boolean         singledemo;
 
+// -timedemo, exit with a report at the end.
+extern  boolean         timingdemo;
+
 //?
 extern  gamestate_t     gamestate;
 
@@ -219,6 +225,9 @@ extern  int             mouseSensitivity;
 // debug flag to cancel adaptiveness
 extern  boolean         singletics;
 
+// draw frames in between tics
+extern  boolean         uncapped;
+
 extern  int             bodyqueslot;
 
 // Needed to store the number of the dummy sky flat.
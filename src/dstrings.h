@@ -33,6 +33,7 @@
 
 // Misc. other strings.
 #define SAVEGAMENAME    "doomsav"
+#define LEVELCACHENAME  "doomlvl"
 
 //
 // File locations,
@@ -573,7 +573,7 @@ void F_CastDrawer (void)
     patch_t*            patch;
 
     // erase the entire screen to a background
-    V_DrawPatchScaled (0,0,0, W_CacheLumpName ("BOSSBACK", PU_CACHE));
+    V_DrawPatchScaledNum (0,0,0,W_GetNumForName("BOSSBACK"));
 
     F_CastPrint (castorder[castnum].name);
 
@@ -700,22 +700,18 @@ void F_Drawer (void)
         {
           case 1:
             if ( gamemode == retail )
-              V_DrawPatchScaled (0,0,0,
-                         W_CacheLumpName("CREDIT",PU_CACHE));
+              V_DrawPatchScaledNum (0,0,0,W_GetNumForName("CREDIT"));
             else
-              V_DrawPatchScaled (0,0,0,
-                         W_CacheLumpName("HELP2",PU_CACHE));
+              V_DrawPatchScaledNum (0,0,0,W_GetNumForName("HELP2"));
             break;
           case 2:
-            V_DrawPatchScaled(0,0,0,
-                        W_CacheLumpName("VICTORY2",PU_CACHE));
+            V_DrawPatchScaledNum (0,0,0,W_GetNumForName("VICTORY2"));
             break;
           case 3:
             F_BunnyScroll ();
             break;
           case 4:
-            V_DrawPatchScaled (0,0,0,
-                         W_CacheLumpName("ENDPIC",PU_CACHE));
+            V_DrawPatchScaledNum (0,0,0,W_GetNumForName("ENDPIC"));
             break;
         }
     }
@@ -30,9 +30,13 @@
 #include "m_misc.h"
 #include "m_menu.h"
 #include "m_random.h"
+#include "m_stream.h"
 #include "i_system.h"
 
 #include "p_setup.h"
+#include "p_rewind.h"
+#include "p_sync.h"
+#include "d_farm.h"
 #include "p_saveg.h"
 #include "p_tick.h"
 
@@ -62,9 +66,6 @@
 
 #include "g_game.h"
 
-#define SAVEGAMESIZE    0x2c000
-#define SAVESTRINGSIZE  24
-
 boolean G_CheckDemoStatus (void);
 void    G_ReadDemoTiccmd (ticcmd_t* cmd);
 void    G_WriteDemoTiccmd (ticcmd_t* cmd);
@@ -81,6 +82,9 @@ void    G_DoCompleted (void);
 void    G_DoVictory (void);
 void    G_DoWorldDone (void);
 void    G_DoSaveGame (void);
+void    G_DoRewind (void);
+
+static void G_CloseDemo (void);
 
 gameaction_t    gameaction;
 gamestate_t     gamestate;
@@ -97,6 +101,9 @@ boolean         usergame;               // ok to save / end game
 boolean         timingdemo;             // if true, exit with report on completion
 boolean         nodrawers;              // for comparative timing purposes
 boolean         noblit;                 // for comparative timing purposes
+int             seektic;                // run without drawing up to here
+static int      seekstart;              // gametic when the seek began
+static long long seektime;
 int             starttime;              // for comparative timing purposes
 
 boolean         viewactive;
@@ -116,9 +123,8 @@ char            demoname[32];
 boolean         demorecording;
 boolean         demoplayback;
 boolean         netdemo;
-byte*           demobuffer;
-byte*           demo_p;
-byte*           demoend;
+static stream_t* demostream;
+static byte*    demolump;               // compressed demo lump, if cached
 boolean         singledemo;             // quit after playing a demo from cmdline
 
 boolean         precache = true;        // if true, load all graphics at start
@@ -165,6 +171,8 @@ fixed_t         angleturn[3] = {640, 1280, 320};        // + slow turn
 
 #define SLOWTURNTICS    6
 
+#define SEEKTICS        (60*TICRATE)
+
 #define NUMKEYS         256
 
 boolean         gamekeydown[NUMKEYS];
@@ -425,6 +433,9 @@ void G_BuildTiccmd (ticcmd_t* cmd)
 //
 extern  gamestate_t     wipegamestate;
 
+// When the current level was loaded, until its first frame is drawn.
+long long       levelloadtime;
+
 void G_DoLoadLevel (void)
 {
     int             i;
@@ -451,6 +462,7 @@ void G_DoLoadLevel (void)
     }
 
     levelstarttic = gametic;        // for time calculation
+    levelloadtime = I_GetTimeUS ();
 
     if (wipegamestate == GS_LEVEL)
         wipegamestate = -1;             // force a wipe
@@ -499,6 +511,14 @@ boolean G_Responder (event_t* ev)
         return true;
     }
 
+    // seek a minute ahead in the demo
+    if (demoplayback && ev->type == ev_keydown
+        && ev->data1 == KEY_RIGHTARROW)
+    {
+        G_SeekTic ((seektic ? seektic : gametic) + SEEKTICS);
+        return true;
+    }
+
     // any other key pops up menu if in demos
     if (gameaction == ga_nothing && !singledemo &&
         (demoplayback || gamestate == GS_DEMOSCREEN)
@@ -622,6 +642,9 @@ void G_Ticker (void)
           case ga_worlddone:
             G_DoWorldDone ();
             break;
+          case ga_rewind:
+            G_DoRewind ();
+            break;
           case ga_screenshot:
             M_ScreenShot ();
             gameaction = ga_nothing;
@@ -708,6 +731,8 @@ void G_Ticker (void)
     {
       case GS_LEVEL:
         P_Ticker ();
+        P_SyncTicker ();
+        P_RewindTicker ();
         ST_Ticker ();
         AM_Ticker ();
         HU_Ticker ();
@@ -715,6 +740,7 @@ void G_Ticker (void)
 
       case GS_INTERMISSION:
         WI_Ticker ();
+        R_UpdatePrefetch ();
         break;
 
       case GS_FINALE:
@@ -986,6 +1012,9 @@ void G_SecretExitLevel (void)
 void G_DoCompleted (void)
 {
     int             i;
+    int             lump;
+    char            lumpname[9];
+    long long       misstime;
 
     gameaction = ga_nothing;
 
@@ -1102,6 +1131,18 @@ void G_DoCompleted (void)
     if (statcopy)
         memcpy (statcopy, &wminfo, sizeof(wminfo));
 
+    i = W_GetMisses (&misstime);
+    if (i && devparm)
+        fprintf (stderr, "G_DoCompleted: %d lumps read during the level "
+                 "(%lld ms)\n", i, misstime / 1000);
+
+    // Read the next level during the intermission, unless the
+    //  game ends here.
+    if (!(gamemode == commercial ? gamemap == 30 : gamemap == 8)
+        && P_MapLumpName (gameepisode, wminfo.next+1, lumpname)
+        && (lump = W_CheckNumForName (lumpname)) != -1)
+        R_PrefetchLevel (lump);
+
     WI_Start (&wminfo);
 }
 
@@ -1143,6 +1184,33 @@ void G_DoWorldDone (void)
     viewactive = true;
 }
 
+//
+// G_Rewind
+// Can be called by the status bar cheats.
+//
+static int      rewindback;
+
+void G_Rewind (int back)
+{
+    rewindback = back;
+    gameaction = ga_rewind;
+}
+
+void G_DoRewind (void)
+{
+    gameaction = ga_nothing;
+
+    // The demo would go on from where it was.
+    if (netgame || demoplayback || demorecording
+        || gamestate != GS_LEVEL || !P_Rewind (rewindback))
+    {
+        players[consoleplayer].message = STSTR_NOREWIND;
+        return;
+    }
+
+    players[consoleplayer].message = STSTR_REWIND;
+}
+
 //
 // G_InitFromSavegame
 // Can be called by the startup code or the menu task.
@@ -1166,18 +1234,23 @@ void G_DoLoadGame (void)
     int         i;
     int         a,b,c;
     char        vcheck[VERSIONSIZE];
+    long long   starttime;
 
     gameaction = ga_nothing;
 
-    length = M_ReadFile (savename, &savebuffer);
-    (void)length;  // Check this?
+    starttime = I_GetTimeUS ();
+    length = P_LoadFile (savename, &savebuffer);
     save_p = savebuffer + SAVESTRINGSIZE;
 
     // skip the description field
     memset (vcheck,0,sizeof(vcheck));
     sprintf (vcheck,"version %i",VERSION);
-    if (strcmp ((const char*)save_p, vcheck))
+    if (length < SAVESTRINGSIZE + VERSIONSIZE
+        || strcmp ((const char*)save_p, vcheck))
+    {
+        Z_Free (savebuffer);
         return;                         // bad version
+    }
     save_p += VERSIONSIZE;
 
     gameskill = *save_p++;
@@ -1186,7 +1259,10 @@ void G_DoLoadGame (void)
     for (i=0 ; i<MAXPLAYERS ; i++)
         playeringame[i] = *save_p++;
 
-    // load a base level
+    // load a base level, ending any demo playback; a demo
+    // being recorded goes on into the loaded game
+    if (demoplayback)
+        G_CloseDemo ();
     G_InitNew (gameskill, gameepisode, gamemap);
 
     // get the times
@@ -1207,6 +1283,10 @@ void G_DoLoadGame (void)
     // done
     Z_Free (savebuffer);
 
+    if (devparm)
+        fprintf (stderr, "G_DoLoadGame: %d bytes, loaded in %.2f ms\n",
+                 length, (I_GetTimeUS () - starttime) / 1000.0);
+
     if (setsizeneeded)
         R_ExecuteSetViewSize ();
 
@@ -1236,6 +1316,7 @@ void G_DoSaveGame (void)
     char*       description;
     int         length;
     int         i;
+    long long   starttime;
 
     if (M_CheckParm("-cdrom"))
         sprintf(name,"c:\\doomdata\\"SAVEGAMENAME"%d.dsg",savegameslot);
@@ -1243,7 +1324,8 @@ void G_DoSaveGame (void)
         sprintf (name,SAVEGAMENAME"%d.dsg",savegameslot);
     description = savedescription;
 
-    save_p = savebuffer = screens[1]+0x4000;
+    starttime = I_GetTimeUS ();
+    P_SaveBegin ();
 
     memcpy (save_p, description, SAVESTRINGSIZE);
     save_p += SAVESTRINGSIZE;
@@ -1266,12 +1348,14 @@ void G_DoSaveGame (void)
     P_ArchiveThinkers ();
     P_ArchiveSpecials ();
 
+    P_SaveReserve (1);
     *save_p++ = 0x1d;           // consistancy marker
 
-    length = save_p - savebuffer;
-    if (length > SAVEGAMESIZE)
-        I_Error ("Savegame buffer overrun");
-    M_WriteFile (name, savebuffer, length);
+    // The file is compressed and written in the background.
+    length = P_SaveFile (name);
+    if (devparm)
+        fprintf (stderr, "G_DoSaveGame: %d bytes, archived in %.2f ms\n",
+                 length, (I_GetTimeUS () - starttime) / 1000.0);
     gameaction = ga_nothing;
     savedescription[0] = 0;
 
@@ -1304,6 +1388,9 @@ G_DeferedInitNew
 
 void G_DoNewGame (void)
 {
+    // the write stream of a demo being recorded stays open
+    if (demoplayback)
+        G_CloseDemo ();
     demoplayback = false;
     netdemo = false;
     netgame = false;
@@ -1396,7 +1483,7 @@ G_InitNew
 
     usergame = true;                // will be set false if a demo
     paused = false;
-    demoplayback = false;
+    demoplayback = false;           // callers close the demo, or set it again
     automapactive = false;
     viewactive = true;
     gameepisode = episode;
@@ -1440,56 +1527,63 @@ G_InitNew
 //
 #define DEMOMARKER              0x80
 
+//
+// G_DecodeDemoTiccmd
+// Recorded tics are read back from the bytes that were written,
+//  so that both turn out exactly the same.
+//
+static void G_DecodeDemoTiccmd (const byte* data, ticcmd_t* cmd)
+{
+    cmd->forwardmove = ((signed char)data[0]);
+    cmd->sidemove = ((signed char)data[1]);
+    cmd->angleturn = ((unsigned char)data[2])<<8;
+    cmd->buttons = (unsigned char)data[3];
+}
+
 void G_ReadDemoTiccmd (ticcmd_t* cmd)
 {
-    if (*demo_p == DEMOMARKER)
+    byte            data[4];
+
+    // a demo that was cut short ends where the file does
+    if (M_StreamRead (demostream, data, 1) < 1
+        || data[0] == DEMOMARKER
+        || M_StreamRead (demostream, data+1, 3) < 3)
     {
         // end of demo data stream
         G_CheckDemoStatus ();
         return;
     }
-    cmd->forwardmove = ((signed char)*demo_p++);
-    cmd->sidemove = ((signed char)*demo_p++);
-    cmd->angleturn = ((unsigned char)*demo_p++)<<8;
-    cmd->buttons = (unsigned char)*demo_p++;
+    G_DecodeDemoTiccmd (data, cmd);
 }
 
 void G_WriteDemoTiccmd (ticcmd_t* cmd)
 {
+    byte            data[4];
+
     if (gamekeydown['q'])           // press q to end demo recording
         G_CheckDemoStatus ();
-    *demo_p++ = cmd->forwardmove;
-    *demo_p++ = cmd->sidemove;
-    *demo_p++ = (cmd->angleturn+128)>>8;
-    *demo_p++ = cmd->buttons;
-    demo_p -= 4;
-    if (demo_p > demoend - 16)
-    {
-        // no more space
-        G_CheckDemoStatus ();
-        return;
-    }
+    data[0] = cmd->forwardmove;
+    data[1] = cmd->sidemove;
+    data[2] = (cmd->angleturn+128)>>8;
+    data[3] = cmd->buttons;
+    M_StreamWrite (demostream, data, 4);
 
-    G_ReadDemoTiccmd (cmd);         // make SURE it is exactly the same
+    G_DecodeDemoTiccmd (data, cmd); // make SURE it is exactly the same
 }
 
 //
 // G_RecordDemo
+// The demo is streamed out as it is recorded,
+//  so there is no limit to its length.
 //
 void G_RecordDemo (char* name)
 {
-    int             i;
-    int                         maxsize;
-
     usergame = false;
     strcpy (demoname, name);
     strcat (demoname, ".lmp");
-    maxsize = 0x20000;
-    i = M_CheckParm ("-maxdemo");
-    if (i && i<myargc-1)
-        maxsize = atoi(myargv[i+1])*1024;
-    demobuffer = Z_Malloc (maxsize,PU_STATIC,NULL);
-    demoend = demobuffer + maxsize;
+    demostream = M_OpenWriteStream (demoname);
+    if (!demostream)
+        I_Error ("G_RecordDemo: couldn't create %s", demoname);
 
     demorecording = true;
 }
@@ -1497,21 +1591,25 @@ void G_RecordDemo (char* name)
 void G_BeginRecording (void)
 {
     int             i;
+    byte            header[9+MAXPLAYERS];
+    byte*           header_p;
 
-    demo_p = demobuffer;
+    header_p = header;
 
-    *demo_p++ = VERSION;
-    *demo_p++ = gameskill;
-    *demo_p++ = gameepisode;
-    *demo_p++ = gamemap;
-    *demo_p++ = deathmatch;
-    *demo_p++ = respawnparm;
-    *demo_p++ = fastparm;
-    *demo_p++ = nomonsters;
-    *demo_p++ = consoleplayer;
+    *header_p++ = VERSION;
+    *header_p++ = gameskill;
+    *header_p++ = gameepisode;
+    *header_p++ = gamemap;
+    *header_p++ = deathmatch;
+    *header_p++ = respawnparm;
+    *header_p++ = fastparm;
+    *header_p++ = nomonsters;
+    *header_p++ = consoleplayer;
 
     for (i=0 ; i<MAXPLAYERS ; i++)
-        *demo_p++ = playeringame[i];
+        *header_p++ = playeringame[i];
+
+    M_StreamWrite (demostream, header, header_p - header);
 }
 
 //
@@ -1526,20 +1624,68 @@ void G_DeferedPlayDemo (char* name)
     gameaction = ga_playdemo;
 }
 
+//
+// G_OpenDemo
+// Streams the demo lump from its file when it is stored as is.
+//
+static void G_OpenDemo (const char* name)
+{
+    int             lump;
+    int             handle;
+    int             position;
+
+    // one that was cut short
+    G_CloseDemo ();
+
+    lump = W_GetNumForName (name);
+    handle = W_LumpFile (lump, &position);
+    if (handle != -1)
+        demostream = M_OpenReadStream (handle, position, W_LumpLength (lump));
+    else
+    {
+        demolump = W_CacheLumpNum (lump, PU_STATIC);
+        demostream = M_OpenMemoryStream (demolump, W_LumpLength (lump));
+    }
+    if (!demostream)
+        I_Error ("G_OpenDemo: couldn't open %s", name);
+}
+
+static void G_CloseDemo (void)
+{
+    if (demostream)
+        M_CloseReadStream (demostream);
+    demostream = NULL;
+    if (demolump)
+    {
+        Z_ChangeTag (demolump, PU_CACHE);
+        demolump = NULL;
+    }
+}
+
 void G_DoPlayDemo (void)
 {
     skill_t skill;
     int             i, episode, map, version;
+    byte            header[9+MAXPLAYERS];
+    byte*           demo_p;
 
     gameaction = ga_nothing;
-    demobuffer = demo_p = W_CacheLumpName (defdemoname, PU_STATIC);
+    G_OpenDemo (defdemoname);
+    memset (header, 0, sizeof(header));
+    M_StreamRead (demostream, header, sizeof(header));
+    demo_p = header;
     version = *demo_p++;
 
     // We allow VERSION 1.10 to load 1.9 demos (they seem compatible).
     if (version != VERSION && !(version == 109 && VERSION == 110))
     {
       fprintf( stderr, "Demo is from a different game version!\n");
+      G_CloseDemo ();
       gameaction = ga_nothing;
+
+      // a timed demo would never end
+      if (timingdemo)
+          I_Error ("G_DoPlayDemo: %s is from a different version", defdemoname);
       return;
     }
 
@@ -1560,6 +1706,11 @@ void G_DoPlayDemo (void)
         netdemo = true;
     }
 
+    // G_InitNew clears demoplayback before the level is set
+    // up, so a snapshot of the same map would be restored,
+    // without the spawn time random numbers
+    P_DropSnapshot ();
+
     // don't spend a lot of time in loadlevel
     precache = false;
     G_InitNew (skill, episode, map);
@@ -1583,6 +1734,63 @@ void G_TimeDemo (char* name)
     gameaction = ga_playdemo;
 }
 
+//
+// G_SeekTic
+// The tics are run without drawing anything or
+//  playing sounds, until gametic gets there.
+//
+void G_SeekTic (int tic)
+{
+    if ((netgame && !netdemo) || tic <= gametic)
+        return;
+
+    if (!seektic)
+    {
+        seekstart = gametic;
+        seektime = I_GetTimeUS ();
+    }
+    seektic = tic;
+}
+
+static void G_EndSeek (void)
+{
+    int         tics;
+    long long   time;
+
+    tics = gametic - seekstart;
+    time = I_GetTimeUS () - seektime;
+    if (devparm)
+        fprintf (stderr, "G_Seek: ran %i tics in %lli ms, %lli tics/s\n",
+                 tics, time/1000, time ? tics*1000000LL/time : 0);
+    seektic = 0;
+}
+
+boolean G_Seeking (void)
+{
+    if (!seektic)
+        return false;
+    if (gametic < seektic)
+        return true;
+
+    G_EndSeek ();
+    return false;
+}
+
+//
+// G_NextSingleDemo
+// -playdemo can name more demos, played in turn.
+//
+static char* G_NextSingleDemo (void)
+{
+    static int  p;      // the demo being played
+
+    if (!p)
+        p = M_CheckParm ("-playdemo") + 1;
+    if (p == 1 || p >= myargc-1 || myargv[p+1][0] == '-')
+        return NULL;
+    return myargv[++p];
+}
+
 /*
 ===================
 =
@@ -1596,20 +1804,28 @@ void G_TimeDemo (char* name)
 boolean G_CheckDemoStatus (void)
 {
     int             endtime;
+    char*           nextdemo;
 
     if (timingdemo)
     {
         endtime = I_GetTime ();
+        D_FarmDone ();
         I_Error ("timed %i gametics in %i realtics",gametic
                  , endtime-starttime);
     }
 
     if (demoplayback)
     {
-        if (singledemo)
+        nextdemo = singledemo ? G_NextSingleDemo () : NULL;
+
+        // the demo ended before the seek did
+        if (seektic && !nextdemo)
+            G_EndSeek ();
+
+        if (singledemo && !nextdemo)
             I_Quit ();
 
-        Z_ChangeTag (demobuffer, PU_CACHE);
+        G_CloseDemo ();
         demoplayback = false;
         netdemo = false;
         netgame = false;
@@ -1619,16 +1835,22 @@ boolean G_CheckDemoStatus (void)
         fastparm = false;
         nomonsters = false;
         consoleplayer = 0;
-        D_AdvanceDemo ();
+        if (nextdemo)
+            G_DeferedPlayDemo (nextdemo);
+        else
+            D_AdvanceDemo ();
         return true;
     }
 
     if (demorecording)
     {
-        *demo_p++ = DEMOMARKER;
-        M_WriteFile (demoname, demobuffer, demo_p - demobuffer);
-        Z_Free (demobuffer);
+        byte        marker = DEMOMARKER;
+
+        M_StreamWrite (demostream, &marker, 1);
         demorecording = false;
+        if (!M_CloseWriteStream (demostream))
+            I_Error ("Couldn't write demo %s",demoname);
+        demostream = NULL;
         I_Error ("Demo %s recorded",demoname);
     }
 
@@ -31,6 +31,9 @@ void G_DeathMatchSpawnPlayer (int playernum);
 
 void G_InitNew (skill_t skill, int episode, int map);
 
+// I_GetTimeUS when the level was loaded, 0 once it is drawn.
+extern long long levelloadtime;
+
 // Can be called by the startup code or M_Responder.
 // A normal game starts at map 1,
 // but a warp test can start elsewhere
@@ -47,6 +50,9 @@ void G_DoLoadGame (void);
 // Called by M_Responder.
 void G_SaveGame (int slot, char* description);
 
+// Called by ST_Responder, goes back a number of snapshots.
+void G_Rewind (int back);
+
 // Only called by startup code.
 void G_RecordDemo (char* name);
 
@@ -54,6 +60,12 @@ void G_BeginRecording (void);
 
 void G_PlayDemo (char* name);
 void G_TimeDemo (char* name);
+
+// Runs up to a tic as fast as possible, -skiptic or the seek key.
+void G_SeekTic (int tic);
+
+// True while seeking, reports the speed once the tic is reached.
+boolean G_Seeking (void);
 boolean G_CheckDemoStatus (void);
 
 void G_ExitLevel (void);
@@ -42,6 +42,9 @@ void I_ShutdownSound (void);
 // Get raw data lump index for sound descriptor.
 int I_GetSfxLumpNum (sfxinfo_t* sfxinfo);
 
+// Loads a sound so that it can be started without delay.
+void I_PrecacheSound (int id);
+
 // Starts a sound in a particular sound channel.
 int I_StartSound (int id, int vol, int sep, int pitch, int priority);
 
@@ -19,12 +19,15 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 
 #define _POSIX_SOURCE  // Because ALSA redefines struct timespec otherwise.
 #include <alsa/asoundlib.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include "z_zone.h"
 
@@ -36,6 +39,11 @@
 
 #include "doomdef.h"
 
+#ifdef HAVE_AVX2
+#include <immintrin.h>
+static boolean s_avx2;
+#endif
+
 // The number of internal mixing channels,
 //  the samples calculated for each mixing step,
 //  the size of the 16bit, 2 hardware channel (stereo)
@@ -55,35 +63,117 @@
 #define VOL_MAX 255
 #define VOL_SHIFT 8
 
-// The actual lengths of all sound effects.
-static int s_sfx_lengths[NUMSFX];
+// Sound effects are loaded when they are first played, into a cache that is
+// bounded to s_sfx_cache_budget bytes. When the cache is full, the least
+// recently played sounds that are not playing are evicted. The mixer may not
+// have seen the latest commands yet, so an evicted sound is handed to it to
+// free, and the samples are allocated with malloc rather than from the zone.
+#define DEFAULT_SFX_CACHE_KB 1024
+
+typedef struct
+{
+    short* data;              // Samples, NULL if not loaded
+    int length;               // Number of samples (without padding)
+    int size;                 // Allocated bytes
+    unsigned int lastused;    // s_sfx_clock when last played
+} sfxcache_t;
+
+static sfxcache_t s_sfx_cache[NUMSFX];
+static unsigned int s_sfx_clock;
+static int s_sfx_cache_budget;
+static int s_sfx_cache_size;
+static int s_sfx_cache_peak;
+static int s_num_sfx_loads;
+static int s_num_sfx_evictions;
 
 // The global mixing buffer.
 // Basically, samples from all active internal channels
 //  are modifed and added, and stored in the buffer
 //  that is submitted to the audio device.
+// It is used as a circular FIFO of mixed frames that have not yet been
+// written to the device.
 static signed short s_mixbuffer[MIXBUFFERSIZE];
+static int s_fifo_start;  // First frame that has not been written.
+static int s_fifo_count;  // Number of frames that have not been written.
+
+// Per sample left and right sums of all channels, before clamping.
+static int s_accum_left[SAMPLECOUNT];
+static int s_accum_right[SAMPLECOUNT];
 
-// The state for one internal mix channel.
+// The state for one internal mix channel, owned by the mixer (which runs in
+// the audio thread, if there is one).
 typedef struct
 {
-    unsigned char* data;      // Current sample pointer
-    unsigned char* data_end;  // Sample end
+    short* data;              // Current sample pointer
+    short* data_end;          // Sample end
     int leftvol;              // Left volume
     int rightvol;             // Right volume
     unsigned int step;        // 16.16 bit step size
     unsigned int step_rem;    // 0.16 bit remainder of last step
-    int start_t;              // Start time for the sound
     int handle;               // External handle
-    int id;                   // SFX id (used to catch duplicates)
 } mixchannel_t;
 
 static mixchannel_t s_channel[NUM_CHANNELS];
 
-// We keep track of where in the mixbuffer we shall start mixing, based on how
-// much was left from the previous mixing pass in case not all samples were sent
-// to the sound device.
-static int s_mix_start;
+// What the game side knows about a mix channel.
+typedef struct
+{
+    int start_t;              // Start time for the sound
+    int handle;               // External handle, 0 if never used
+    int id;                   // SFX id (used to catch duplicates)
+    boolean stopped;          // Stop requested, mixer may not know yet
+} chaninfo_t;
+
+static chaninfo_t s_chaninfo[NUM_CHANNELS];
+
+// The handle of the last sound that the mixer finished or stopped on each
+// channel. Until then the mixer may use the sound data.
+static atomic_int s_finished_handle[NUM_CHANNELS];
+
+// Channel commands, sent from the game side to the mixer through a lock-free
+// single producer, single consumer queue.
+typedef enum
+{
+    CMD_START,
+    CMD_UPDATE,
+    CMD_STOP,
+    CMD_RETIRE                // Free an evicted sound
+} chancmdtype_t;
+
+typedef struct
+{
+    chancmdtype_t type;
+    int chan;
+    int handle;
+    short* data;              // CMD_START and CMD_RETIRE
+    short* data_end;          // CMD_START only
+    unsigned int step;        // CMD_START and CMD_UPDATE
+    int leftvol;              // CMD_START and CMD_UPDATE
+    int rightvol;             // CMD_START and CMD_UPDATE
+} chancmd_t;
+
+#define NUM_COMMANDS 256  // Must be a power of two.
+
+static chancmd_t s_commands[NUM_COMMANDS];
+static atomic_int s_command_head;  // Written by the game side.
+static atomic_int s_command_tail;  // Written by the mixer.
+
+// The audio thread.
+static pthread_t s_thread;
+static boolean s_thread_running;
+static atomic_int s_quit_thread;
+
+// Set in a forked child, which has no audio thread and must not
+// touch the device of its parent.
+static boolean s_silent;
+
+static void* audiothread (void* arg);
+
+// Statistics, owned by the mixer.
+static int s_num_underruns;
+static long long s_delay_sum;  // Frames queued in the device.
+static long s_delay_max;
+static int s_num_delays;
 
 // A counter that keeps track of unique channel handles.
 static int s_next_handle;
@@ -95,7 +185,8 @@ static int s_steptable[256];
 static snd_pcm_t* s_alsa_handle;
 
 //
-// This function loads the sound data from the WAD lump, for single sound.
+// This function loads the sound data from the WAD lump, for single sound, and
+// converts it to signed 16-bit samples.
 //
 static void* getsfx (const char* sfxname, int* len)
 {
@@ -131,20 +222,19 @@ static void* getsfx (const char* sfxname, int* len)
     unsigned char* samples = sfx + 8;
     int samples_size = size - 8;
 
-    // Pads the sound effect out to the mixing buffer size (this enables faster
-    // sampling since we don't have to check for the end of the data in the
-    // sampling routine - not currently used though).
-    int paddedsize =
-        ((samples_size + (SAMPLECOUNT - 1)) / SAMPLECOUNT) * SAMPLECOUNT;
+    // Pad the sound effect with one silent sample, so that the interpolation
+    // in the mixer can read one sample past the last one.
+    int paddedsize = samples_size + 1;
 
-    // Allocate from zone memory.
-    unsigned char* paddedsfx =
-        (unsigned char*)Z_Malloc (paddedsize, PU_STATIC, 0);
+    // Allocate from the C heap, since the mixer frees it.
+    short* paddedsfx = (short*)malloc (paddedsize * sizeof (short));
+    if (paddedsfx == NULL)
+        I_Error ("getsfx: Unable to allocate %s", name);
 
-    // Now copy and pad.
-    memcpy (paddedsfx, samples, (size_t)samples_size);
-    for (int i = samples_size; i < paddedsize; i++)
-        paddedsfx[i] = 128;
+    // Convert from 8-bit unsigned to 16-bit signed, and pad.
+    for (int i = 0; i < samples_size; i++)
+        paddedsfx[i] = (short)(((int)samples[i] - 128) * 256);
+    paddedsfx[samples_size] = 0;
 
     // Remove the cached lump.
     Z_Free (sfx);
@@ -170,7 +260,7 @@ static inline short clamp_to_short (int x)
     return (short)clamp (x, -32768, 32767);
 }
 
-static void setchannelvolume (int chan, int vol, int sep)
+static void calcvolume (int vol, int sep, int* leftvol, int* rightvol)
 {
     // Convert volume range from 0..15 to 0..255.
     vol *= 17;
@@ -180,12 +270,142 @@ static void setchannelvolume (int chan, int vol, int sep)
     // sep is in the range 0..255 (128 represents center).
     int lsep = sep + 1;    // 1..256
     int rsep = sep - 257;  // -1..255
-    int leftvol = vol - ((vol * lsep * lsep) >> 16);
-    int rightvol = vol - ((vol * rsep * rsep) >> 16);
+    int l = vol - ((vol * lsep * lsep) >> 16);
+    int r = vol - ((vol * rsep * rsep) >> 16);
 
     // Clamp the volume (just in case - should not be necessary).
-    s_channel[chan].leftvol = clamp (leftvol, 0, VOL_MAX);
-    s_channel[chan].rightvol = clamp (rightvol, 0, VOL_MAX);
+    *leftvol = clamp (l, 0, VOL_MAX);
+    *rightvol = clamp (r, 0, VOL_MAX);
+}
+
+//
+// Game side of the channel command queue.
+//
+static void processcommands (void);
+
+static void sendcommand (const chancmd_t* cmd)
+{
+    int head = atomic_load_explicit (&s_command_head, memory_order_relaxed);
+    int next = (head + 1) & (NUM_COMMANDS - 1);
+
+    // Wait for the mixer if the queue is full.
+    while (next == atomic_load_explicit (&s_command_tail, memory_order_acquire))
+    {
+        if (s_thread_running)
+            sched_yield ();
+        else
+            processcommands ();
+    }
+
+    s_commands[head] = *cmd;
+    atomic_store_explicit (&s_command_head, next, memory_order_release);
+}
+
+// Is the mixer (possibly) using the sound data of the channel?
+static boolean channelbusy (int chan)
+{
+    int handle = s_chaninfo[chan].handle;
+    return handle != 0 &&
+           atomic_load_explicit (&s_finished_handle[chan],
+                                 memory_order_acquire) != handle;
+}
+
+static boolean channelactive (int chan)
+{
+    return channelbusy (chan) && !s_chaninfo[chan].stopped;
+}
+
+static void stopchannel (int chan)
+{
+    chancmd_t cmd;
+    cmd.type = CMD_STOP;
+    cmd.chan = chan;
+    cmd.handle = s_chaninfo[chan].handle;
+    sendcommand (&cmd);
+    s_chaninfo[chan].stopped = true;
+}
+
+//
+// Sound effect cache.
+//
+
+// Linked sounds (e.g. the chaingun, which uses the pistol sound) share the
+// data of the sound that they link to.
+static int rootsfx (int id)
+{
+    return S_sfx[id].link ? (int)(S_sfx[id].link - S_sfx) : id;
+}
+
+static boolean sfxinuse (int id)
+{
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        if (rootsfx (s_chaninfo[i].id) == id && channelbusy (i))
+            return true;
+    }
+    return false;
+}
+
+static void evictsfx (void)
+{
+    while (s_sfx_cache_size > s_sfx_cache_budget)
+    {
+        // Find the least recently used sound that is not playing.
+        int victim = -1;
+        for (int i = 1; i < NUMSFX; i++)
+        {
+            sfxcache_t* sfx = &s_sfx_cache[i];
+            if (sfx->data == NULL || sfx->lastused == s_sfx_clock ||
+                sfxinuse (i))
+                continue;
+            if (victim < 0 || sfx->lastused < s_sfx_cache[victim].lastused)
+                victim = i;
+        }
+
+        // Everything is playing, so we go over budget for now.
+        if (victim < 0)
+            break;
+
+        // The mixer may still be playing the sound, if it has not applied
+        // the command that replaced it yet. It frees the sound once it has.
+        chancmd_t cmd;
+        cmd.type = CMD_RETIRE;
+        cmd.chan = 0;
+        cmd.handle = 0;
+        cmd.data = s_sfx_cache[victim].data;
+        sendcommand (&cmd);
+
+        s_sfx_cache[victim].data = NULL;
+        s_sfx_cache_size -= s_sfx_cache[victim].size;
+        ++s_num_sfx_evictions;
+    }
+}
+
+static sfxcache_t* cachesfx (int id)
+{
+    sfxcache_t* sfx = &s_sfx_cache[rootsfx (id)];
+    sfx->lastused = ++s_sfx_clock;
+    if (sfx->data == NULL)
+    {
+        sfx->data = (short*)getsfx (S_sfx[rootsfx (id)].name, &sfx->length);
+        sfx->size = (sfx->length + 1) * (int)sizeof (short);
+        s_sfx_cache_size += sfx->size;
+        ++s_num_sfx_loads;
+        evictsfx ();
+        if (s_sfx_cache_size > s_sfx_cache_peak)
+            s_sfx_cache_peak = s_sfx_cache_size;
+    }
+    return sfx;
+}
+
+//
+// A child that is forked from the game, such as a demo farm worker,
+// keeps running without sound.
+//
+static void forkedchild (void)
+{
+    s_thread_running = false;
+    s_silent = true;
 }
 
 //
@@ -196,6 +416,7 @@ void I_InitSound ()
 {
     int i;
     int err;
+    long long start_time = I_GetTimeUS ();
 
     // Secure and configure sound device first.
     fprintf (stderr, "I_InitSound: ");
@@ -219,29 +440,19 @@ void I_InitSound ()
         return;
     }
     fprintf (stderr, "Configured audio device.\n");
+    pthread_atfork (NULL, NULL, forkedchild);
 
-    // Initialize external data (all sounds) at start, keep static.
-    fprintf (stderr, "I_InitSound: ");
+#ifdef HAVE_AVX2
+    s_avx2 = I_HaveAVX2 ();
+#endif
 
-    // Pre-cache all sounds effects.
-    for (i = 1; i < NUMSFX; i++)
-    {
-        // Alias? Example is the chaingun sound linked to pistol.
-        if (!S_sfx[i].link)
-        {
-            // Load data from WAD file.
-            S_sfx[i].data = getsfx (S_sfx[i].name, &s_sfx_lengths[i]);
-        }
-        else
-        {
-            // Previously loaded already?
-            S_sfx[i].data = S_sfx[i].link->data;
-            s_sfx_lengths[i] =
-                s_sfx_lengths[(S_sfx[i].link - S_sfx) /
-                              sizeof (sfxinfo_t)];  // Is this correct?
-        }
-    }
-    fprintf (stderr, "Pre-cached all sound data.\n");
+    // Sound effects are loaded on demand, into a cache of limited size.
+    s_sfx_cache_budget = DEFAULT_SFX_CACHE_KB * 1024;
+    i = M_CheckParm ("-sfxcache");
+    if (i && i < myargc - 1)
+        s_sfx_cache_budget = atoi (myargv[i + 1]) * 1024;
+    memset (s_sfx_cache, 0, sizeof (s_sfx_cache));
+    s_sfx_cache_size = 0;
 
     // This table provides step widths for pitch parameters.
     for (int i = -128; i < 128; i++)
@@ -250,19 +461,38 @@ void I_InitSound ()
 
     // Reset internal mixing channel state.
     for (int i = 0; i < NUM_CHANNELS; i++)
+    {
         memset (&s_channel[i], 0, sizeof (mixchannel_t));
+        memset (&s_chaninfo[i], 0, sizeof (chaninfo_t));
+        atomic_init (&s_finished_handle[i], 0);
+    }
+    atomic_init (&s_command_head, 0);
+    atomic_init (&s_command_tail, 0);
 
     // Now initialize mixbuffer with zero.
     memset (&s_mixbuffer[0], 0, sizeof(s_mixbuffer));
 
-    // We start mixing at the beginning of the mixbuffer.
-    s_mix_start = 0;
+    // The FIFO starts out empty.
+    s_fifo_start = 0;
+    s_fifo_count = 0;
 
     // Start with a non-zero handle.
     s_next_handle = 123;
 
+    // Mix and write from a separate thread, unless told not to.
+    if (!M_CheckParm ("-syncsound"))
+    {
+        atomic_init (&s_quit_thread, 0);
+        if (pthread_create (&s_thread, NULL, audiothread, NULL) == 0)
+            s_thread_running = true;
+        else
+            fprintf (stderr, "I_InitSound: Unable to start audio thread\n");
+    }
+
     // Finished initialization.
-    fprintf (stderr, "I_InitSound: Sound module ready.\n");
+    fprintf (stderr,
+             "I_InitSound: Sound module ready in %.1f ms.\n",
+             (double)(I_GetTimeUS () - start_time) / 1000.0);
 }
 
 void I_ShutdownSound (void)
@@ -278,14 +508,44 @@ void I_ShutdownSound (void)
 
     while (!done)
     {
-        for (i = 0; i < 8 && s_channel[i].data == NULL; i++)
+        for (i = 0; i < NUM_CHANNELS && !channelactive (i); i++)
             ;
 
         // FIXME. No proper channel output.
-        // if (i==8)
+        // if (i==NUM_CHANNELS)
         done = 1;
     }
 
+    // The device belongs to the parent.
+    if (s_silent)
+        return;
+
+    // Stop the audio thread.
+    if (s_thread_running)
+    {
+        atomic_store (&s_quit_thread, 1);
+        pthread_join (s_thread, NULL);
+        s_thread_running = false;
+    }
+
+    fprintf (stderr,
+             "I_ShutdownSound: %d sfx loaded, %d evicted, "
+             "%d KB resident, peak %d KB\n",
+             s_num_sfx_loads,
+             s_num_sfx_evictions,
+             s_sfx_cache_size / 1024,
+             s_sfx_cache_peak / 1024);
+
+    if (s_num_delays > 0)
+    {
+        fprintf (stderr,
+                 "I_ShutdownSound: %d underruns, "
+                 "latency avg %.1f ms, max %.1f ms\n",
+                 s_num_underruns,
+                 1000.0 * (double)s_delay_sum / ((double)s_num_delays * SAMPLERATE),
+                 1000.0 * (double)s_delay_max / SAMPLERATE);
+    }
+
     // Cleaning up.
     err = snd_pcm_drain (s_alsa_handle);
     if (err < 0)
@@ -324,10 +584,10 @@ int I_StartSound (int id, int vol, int sep, int pitch, int priority)
         for (int i = 0; i < NUM_CHANNELS; i++)
         {
             // Active, and using the same SFX?
-            if (s_channel[i].data != NULL && s_channel[i].id == id)
+            if (channelactive (i) && s_chaninfo[i].id == id)
             {
                 // Reset.
-                s_channel[i].data = NULL;
+                stopchannel (i);
                 // We are sure that iff, there will only be one.
                 break;
             }
@@ -340,48 +600,62 @@ int I_StartSound (int id, int vol, int sep, int pitch, int priority)
     int oldest = gametic;
     for (int i = 0; i < NUM_CHANNELS; i++)
     {
-        if (s_channel[i].data == NULL)
+        if (!channelactive (i))
         {
             chan = i;
             break;
         }
-        if (s_channel[i].start_t < oldest)
+        if (s_chaninfo[i].start_t < oldest)
         {
             chan = i;
-            oldest = s_channel[i].start_t;
+            oldest = s_chaninfo[i].start_t;
         }
     }
 
+    // Load the sound, if needed.
+    sfxcache_t* sfx = cachesfx (id);
+
+    chancmd_t cmd;
+    cmd.type = CMD_START;
+    cmd.chan = chan;
+
     // Set start/stop pointers to the raw data.
-    s_channel[chan].data = (unsigned char*)S_sfx[id].data;
-    s_channel[chan].data_end = s_channel[chan].data + s_sfx_lengths[id];
+    cmd.data = sfx->data;
+    cmd.data_end = cmd.data + sfx->length;
 
     // Set the sample step size (pitch).
-    s_channel[chan].step = (unsigned int)s_steptable[pitch];
-    s_channel[chan].step_rem = 0u;
+    cmd.step = (unsigned int)s_steptable[pitch];
 
     // Set the channel volume.
-    setchannelvolume (chan, vol, sep);
+    calcvolume (vol, sep, &cmd.leftvol, &cmd.rightvol);
 
     // Set the start gametic.
-    s_channel[chan].start_t = gametic;
+    s_chaninfo[chan].start_t = gametic;
 
     // Preserve sound SFX id, e.g. for avoiding duplicates of chainsaw.
-    s_channel[chan].id = id;
+    s_chaninfo[chan].id = id;
+    s_chaninfo[chan].stopped = false;
 
     // Assign and return a handle to this SFX.
-    s_channel[chan].handle = s_next_handle++;
-    return s_channel[chan].handle;
+    s_chaninfo[chan].handle = s_next_handle++;
+    cmd.handle = s_chaninfo[chan].handle;
+    sendcommand (&cmd);
+    return s_chaninfo[chan].handle;
 }
 
 void I_UpdateSoundParams (int handle, int vol, int sep, int pitch)
 {
     for (int i = 0; i < NUM_CHANNELS; i++)
     {
-        if (s_channel[i].data != NULL && s_channel[i].handle == handle)
+        if (channelactive (i) && s_chaninfo[i].handle == handle)
         {
-            s_channel[i].step = (unsigned int)s_steptable[pitch];
-            setchannelvolume (i, vol, sep);
+            chancmd_t cmd;
+            cmd.type = CMD_UPDATE;
+            cmd.chan = i;
+            cmd.handle = handle;
+            cmd.step = (unsigned int)s_steptable[pitch];
+            calcvolume (vol, sep, &cmd.leftvol, &cmd.rightvol);
+            sendcommand (&cmd);
             break;
         }
     }
@@ -391,9 +665,9 @@ void I_StopSound (int handle)
 {
     for (int i = 0; i < NUM_CHANNELS; i++)
     {
-        if (s_channel[i].data != NULL && s_channel[i].handle == handle)
+        if (channelactive (i) && s_chaninfo[i].handle == handle)
         {
-            s_channel[i].data = NULL;
+            stopchannel (i);
             break;
         }
     }
@@ -405,14 +679,25 @@ void I_StopSound (int handle)
 void I_StopAllSounds ()
 {
     for (int i = 0; i < NUM_CHANNELS; i++)
-        s_channel[i].data = NULL;
+    {
+        if (channelactive (i))
+            stopchannel (i);
+    }
+}
+
+//
+// Load a sound effect into the cache ahead of time.
+//
+void I_PrecacheSound (int id)
+{
+    cachesfx (id);
 }
 
 int I_SoundIsPlaying (int handle)
 {
     for (int i = 0; i < NUM_CHANNELS; i++)
     {
-        if (s_channel[i].data != NULL && s_channel[i].handle == handle)
+        if (channelactive (i) && s_chaninfo[i].handle == handle)
         {
             return 1;
         }
@@ -421,6 +706,183 @@ int I_SoundIsPlaying (int handle)
     return 0;
 }
 
+//
+// Mixer side of the channel command queue.
+//
+static void processcommands (void)
+{
+    int tail = atomic_load_explicit (&s_command_tail, memory_order_relaxed);
+    int head = atomic_load_explicit (&s_command_head, memory_order_acquire);
+    for (; tail != head; tail = (tail + 1) & (NUM_COMMANDS - 1))
+    {
+        const chancmd_t* cmd = &s_commands[tail];
+        mixchannel_t* channel = &s_channel[cmd->chan];
+        switch (cmd->type)
+        {
+            case CMD_START:
+                channel->data = cmd->data;
+                channel->data_end = cmd->data_end;
+                channel->step = cmd->step;
+                channel->step_rem = 0u;
+                channel->leftvol = cmd->leftvol;
+                channel->rightvol = cmd->rightvol;
+                channel->handle = cmd->handle;
+                break;
+            case CMD_UPDATE:
+                if (channel->data != NULL && channel->handle == cmd->handle)
+                {
+                    channel->step = cmd->step;
+                    channel->leftvol = cmd->leftvol;
+                    channel->rightvol = cmd->rightvol;
+                }
+                break;
+            case CMD_STOP:
+                if (channel->handle == cmd->handle)
+                {
+                    channel->data = NULL;
+                    atomic_store_explicit (&s_finished_handle[cmd->chan],
+                                           cmd->handle,
+                                           memory_order_release);
+                }
+                break;
+            case CMD_RETIRE:
+                // All earlier commands have been applied, so no channel
+                // plays the sound any more.
+                free (cmd->data);
+                break;
+        }
+    }
+    atomic_store_explicit (&s_command_tail, tail, memory_order_release);
+}
+
+#ifdef HAVE_AVX2
+//
+// Mix samples from one channel eight at a time, the same way as mixchannel.
+// Returns how many were mixed.
+//
+AVX2_TARGET
+static int mixchannel_avx2 (int* accum_left,
+                            int* accum_right,
+                            const short* data,
+                            unsigned int pos,
+                            unsigned int step,
+                            int leftvol,
+                            int rightvol,
+                            int count)
+{
+    int i = 0;
+    const __m256i lane = _mm256_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i step8 = _mm256_set1_epi32 ((int)step);
+    const __m256i frac_mask = _mm256_set1_epi32 (65535);
+    const __m256i lvol = _mm256_set1_epi32 (leftvol);
+    const __m256i rvol = _mm256_set1_epi32 (rightvol);
+    __m256i p = _mm256_add_epi32 (_mm256_set1_epi32 ((int)pos),
+                                  _mm256_mullo_epi32 (lane, step8));
+    for (; i <= count - 8; i += 8)
+    {
+        // Each 32-bit gather reads two consecutive 16-bit samples.
+        __m256i idx = _mm256_srli_epi32 (p, 16);
+        __m256i s12 = _mm256_i32gather_epi32 ((const int*)data, idx, 2);
+        __m256i s1 = _mm256_srai_epi32 (_mm256_slli_epi32 (s12, 16), 16);
+        __m256i s2 = _mm256_srai_epi32 (s12, 16);
+        __m256i frac = _mm256_and_si256 (p, frac_mask);
+        __m256i diff = _mm256_srai_epi32 (_mm256_sub_epi32 (s2, s1), 8);
+        __m256i sample = _mm256_add_epi32 (
+            s1, _mm256_srai_epi32 (_mm256_mullo_epi32 (frac, diff), 8));
+
+        __m256i* l = (__m256i*)&accum_left[i];
+        __m256i* r = (__m256i*)&accum_right[i];
+        __m256i dl = _mm256_srai_epi32 (_mm256_mullo_epi32 (lvol, sample),
+                                        VOL_SHIFT);
+        __m256i dr = _mm256_srai_epi32 (_mm256_mullo_epi32 (rvol, sample),
+                                        VOL_SHIFT);
+        _mm256_storeu_si256 (l, _mm256_add_epi32 (_mm256_loadu_si256 (l), dl));
+        _mm256_storeu_si256 (r, _mm256_add_epi32 (_mm256_loadu_si256 (r), dr));
+
+        p = _mm256_add_epi32 (p, _mm256_slli_epi32 (step8, 3));
+    }
+    return i;
+}
+
+//
+// Interleave and clamp the accumulators eight frames at a time, the same way
+// as mixframes. Returns the first frame that was not done.
+//
+AVX2_TARGET
+static int interleave_avx2 (int first, int last)
+{
+    int i = first;
+    for (; i <= last - 8; i += 8)
+    {
+        // Interleave left and right, and pack to 16 bits with saturation.
+        __m256i l = _mm256_loadu_si256 ((const __m256i*)&s_accum_left[i]);
+        __m256i r = _mm256_loadu_si256 ((const __m256i*)&s_accum_right[i]);
+        __m256i lr = _mm256_packs_epi32 (_mm256_unpacklo_epi32 (l, r),
+                                         _mm256_unpackhi_epi32 (l, r));
+        _mm256_storeu_si256 ((__m256i*)&s_mixbuffer[SAMPLECHANS * i], lr);
+    }
+    return i;
+}
+#endif
+
+//
+// Mix a block of samples from one channel into the accumulators, and advance
+// the channel.
+//
+static void mixchannel (mixchannel_t* channel, int first, int count)
+{
+    const short* data = channel->data;
+    unsigned int pos = channel->step_rem;  // 16.16 bit, relative to data
+    unsigned int step = channel->step;
+    int leftvol = channel->leftvol;
+    int rightvol = channel->rightvol;
+    int* accum_left = &s_accum_left[first];
+    int* accum_right = &s_accum_right[first];
+
+    // The channel is mixed for as long as the position is inside the sound.
+    long long end_pos = (long long)(channel->data_end - data) << 16;
+    long long num_left = (end_pos - pos + step - 1) / step;
+    if (num_left < 1)
+        num_left = 1;  // A started sound always plays at least one sample.
+    if (num_left < count)
+        count = (int)num_left;
+
+    int i = 0;
+#ifdef HAVE_AVX2
+    if (s_avx2)
+        i = mixchannel_avx2 (accum_left, accum_right, data, pos, step,
+                             leftvol, rightvol, count);
+#endif
+    for (; i < count; ++i)
+    {
+        // Perform linear interpolation between two consecutive samples.
+        // Note: It is safe to sample beyond the end of the sample since we
+        // have added padding.
+        unsigned int p = pos + (unsigned int)i * step;
+        const short* s = &data[p >> 16];
+        int frac_pos = (int)(p & 65535u);
+        int sample = s[0] + ((frac_pos * ((s[1] - s[0]) >> 8)) >> 8);
+
+        // Add left and right part for this channel (sound) to the current
+        // data. Adjust volume accordingly.
+        accum_left[i] += (leftvol * sample) >> VOL_SHIFT;
+        accum_right[i] += (rightvol * sample) >> VOL_SHIFT;
+    }
+
+    // Update the sample position using fixed point (16.16 bit) arithmetic,
+    // and check whether we have reached the end of this sample.
+    pos += (unsigned int)count * step;
+    if ((long long)pos >= end_pos)
+    {
+        channel->data = NULL;
+    }
+    else
+    {
+        channel->data += pos >> 16;
+        channel->step_rem = pos & 65535u;
+    }
+}
+
 //
 // This function loops all active (internal) sound channels, retrieves a given
 // number of samples from the raw sound data, modifies it according to the
@@ -429,73 +891,97 @@ int I_SoundIsPlaying (int handle)
 // for transferring the contents of the mixbuffer to the (two) hardware channels
 // (left and right, that is).
 //
-void I_UpdateSound (void)
+// Each channel is mixed into the accumulators as one block, and the sum is
+// clamped and interleaved at the end. This gives exactly the same result as
+// mixing all channels sample by sample.
+//
+static void mixframes (int first, int count)
 {
-    // Mix sounds into the mixing buffer.
-    for (int i = s_mix_start; i < SAMPLECOUNT; ++i)
+    memset (&s_accum_left[first], 0, (size_t)count * sizeof (int));
+    memset (&s_accum_right[first], 0, (size_t)count * sizeof (int));
+
+    for (int chan = 0; chan < NUM_CHANNELS; chan++)
     {
-        int dl = 0;
-        int dr = 0;
-        for (int chan = 0; chan < NUM_CHANNELS; chan++)
+        mixchannel_t* channel = &s_channel[chan];
+        if (channel->data)
         {
-            mixchannel_t* channel = &s_channel[chan];
+            mixchannel (channel, first, count);
 
-            // Check channel, if active.
-            unsigned char* sample_ptr = channel->data;
-            if (sample_ptr)
-            {
-                int frac_pos = (int)channel->step_rem;
-
-                // Perform linear interpolation between two consecutive samples,
-                // and convert from 8-bit unsigned to 16-bit signed.
-                // Note: It is safe to sample beyond the end of the sample since
-                // we have added padding.
-                int s1 = (int)sample_ptr[0];
-                int s2 = (int)sample_ptr[1];
-                int sample = (s1 << 8) + ((frac_pos * (s2 - s1)) >> 8) - 32768;
-
-                // Add left and right part for this channel (sound) to the
-                // current data. Adjust volume accordingly.
-                dl += (channel->leftvol * sample) >> VOL_SHIFT;
-                dr += (channel->rightvol * sample) >> VOL_SHIFT;
-
-                // Update the sample position using fixed point (16.16 bit)
-                // arithmetic.
-                unsigned int increment = channel->step + (unsigned int)frac_pos;
-                sample_ptr += increment >> 16;
-                channel->step_rem = increment & 65535u;
-
-                // Check whether we have reached the end of this sample.
-                if (sample_ptr >= channel->data_end)
-                    sample_ptr = NULL;
-
-                channel->data = sample_ptr;
-            }
+            // Tell the game side when the sound is done.
+            if (!channel->data)
+                atomic_store_explicit (&s_finished_handle[chan],
+                                       channel->handle,
+                                       memory_order_release);
         }
+    }
 
-        s_mixbuffer[SAMPLECHANS * i] = clamp_to_short (dl);
-        s_mixbuffer[SAMPLECHANS * i + 1] = clamp_to_short (dr);
+    int i = first;
+    int last = first + count;
+#ifdef HAVE_AVX2
+    if (s_avx2)
+        i = interleave_avx2 (first, last);
+#endif
+    for (; i < last; ++i)
+    {
+        s_mixbuffer[SAMPLECHANS * i] = clamp_to_short (s_accum_left[i]);
+        s_mixbuffer[SAMPLECHANS * i + 1] = clamp_to_short (s_accum_right[i]);
     }
 }
 
 //
-// This would be used to write out the mixbuffer during each game loop update.
-// Updates sound buffer and audio device at runtime.
+// Apply the pending channel commands, and mix as many frames as the audio
+// device can take right now into the FIFO.
 //
-void I_SubmitSound (void)
+static void fillfifo (void)
 {
-    snd_pcm_uframes_t frames_left = SAMPLECOUNT;
-    while (frames_left > 0)
+    processcommands ();
+
+    snd_pcm_sframes_t avail = snd_pcm_avail_update (s_alsa_handle);
+    if (avail < 0)
+    {
+        if (avail == -EPIPE)
+            ++s_num_underruns;
+        snd_pcm_recover (s_alsa_handle, (int)avail, 1);
+        return;
+    }
+
+    int wanted = avail < SAMPLECOUNT ? (int)avail : SAMPLECOUNT;
+    while (s_fifo_count < wanted)
     {
-        snd_pcm_sframes_t res =
-            snd_pcm_writei (s_alsa_handle, s_mixbuffer, frames_left);
+        // Mix up to the end of the circular buffer at a time.
+        int end = (s_fifo_start + s_fifo_count) % SAMPLECOUNT;
+        int count = wanted - s_fifo_count;
+        if (end + count > SAMPLECOUNT)
+            count = SAMPLECOUNT - end;
+        mixframes (end, count);
+        s_fifo_count += count;
+    }
+}
+
+//
+// Write the mixed frames in the FIFO to the audio device.
+//
+static void writefifo (void)
+{
+    while (s_fifo_count > 0)
+    {
+        snd_pcm_uframes_t count = (snd_pcm_uframes_t)s_fifo_count;
+        if (s_fifo_start + s_fifo_count > SAMPLECOUNT)
+            count = (snd_pcm_uframes_t)(SAMPLECOUNT - s_fifo_start);
+
+        snd_pcm_sframes_t res = snd_pcm_writei (
+            s_alsa_handle, &s_mixbuffer[SAMPLECHANS * s_fifo_start], count);
         if (res < 0)
+        {
+            if (res == -EPIPE)
+                ++s_num_underruns;
             res = snd_pcm_recover (s_alsa_handle, (int)res, 1);
+        }
         if (res < 0)
         {
             // We get EAGAIN when the resource is busy (because we're using
             // non-blocking mode and the device can't accept any more data right
-            // now). We'll try again the next time I_SubmitSound is called.
+            // now). We'll try again the next time.
             // If the error was something else, print it.
             if (res != -EAGAIN)
             {
@@ -503,23 +989,56 @@ void I_SubmitSound (void)
             }
             break;
         }
-        frames_left -= (snd_pcm_uframes_t)res;
+
+        s_fifo_start = (s_fifo_start + (int)res) % SAMPLECOUNT;
+        s_fifo_count -= (int)res;
     }
 
-    // Keep mix samples that were not submitted.
-    if (frames_left > 0 && frames_left < SAMPLECOUNT)
+    // Keep track of how much audio is queued in the device.
+    snd_pcm_sframes_t delay;
+    if (snd_pcm_delay (s_alsa_handle, &delay) == 0 && delay >= 0)
     {
-        // TODO(m): We may be able to avoid the memmove if we treat the
-        // mixbuffer as a circular FIFO.
-        size_t offs = (SAMPLECOUNT - frames_left) * SAMPLECHANS;
-        size_t size = frames_left * SAMPLESIZE;
-        memmove (&s_mixbuffer[0], &s_mixbuffer[offs], size);
-        s_mix_start = (int)frames_left;
+        s_delay_sum += delay;
+        if (delay > s_delay_max)
+            s_delay_max = delay;
+        ++s_num_delays;
     }
-    else
+}
+
+//
+// The audio thread sleeps until the device has room for another period, and
+// then mixes and writes it.
+//
+static void* audiothread (void* arg)
+{
+    // UNUSED.
+    (void)arg;
+
+    while (!atomic_load (&s_quit_thread))
     {
-        s_mix_start = 0;
+        snd_pcm_wait (s_alsa_handle, 100);
+        fillfifo ();
+        writefifo ();
     }
+    return NULL;
+}
+
+//
+// Without an audio thread, mixing and writing is done once per frame from
+// the game loop.
+//
+void I_UpdateSound (void)
+{
+    if (s_silent)
+        processcommands ();
+    else if (!s_thread_running)
+        fillfifo ();
+}
+
+void I_SubmitSound (void)
+{
+    if (!s_thread_running && !s_silent)
+        writefifo ();
 }
 
 //
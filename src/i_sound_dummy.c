@@ -51,6 +51,11 @@ int I_GetSfxLumpNum (sfxinfo_t* sfx)
     return -1;
 }
 
+void I_PrecacheSound (int id)
+{
+    (void)id;
+}
+
 int I_StartSound (int id, int vol, int sep, int pitch, int priority)
 {
     (void)vol;
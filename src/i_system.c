@@ -17,21 +17,31 @@
 //
 //-----------------------------------------------------------------------------
 
+#define _POSIX_C_SOURCE 199309L  // Required to get clock_gettime()
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "doomdef.h"
+#include "m_fixed.h"
 #include "m_misc.h"
 #include "i_video.h"
 #include "i_sound.h"
 
+#include "d_main.h"
 #include "d_net.h"
 #include "g_game.h"
+#include "p_rewind.h"
+#include "p_sync.h"
+#include "p_saveg.h"
+#include "w_wad.h"
 
 #include "i_system.h"
 
@@ -66,22 +76,101 @@ byte* I_ZoneBase (int*  size)
     return (byte *) malloc (*size);
 }
 
+//
+// I_GetTimeUS
+// returns microseconds since the first call
+//
+long long I_GetTimeUS (void)
+{
+    static atomic_llong basetime = -1;
+    long long           now;
+    long long           base;
+
+#if defined(CLOCK_MONOTONIC)
+    struct timespec     ts;
+
+    // The monotonic clock does not jump when the wall clock is set.
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    now = (long long)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+#else
+    struct timeval      tp;
+
+    gettimeofday (&tp, NULL);
+    now = (long long)tp.tv_sec*1000000 + tp.tv_usec;
+#endif
+
+    // The sound and input threads call this too. The first call
+    // sets the base, and a call that races with it gets its base.
+    base = atomic_load (&basetime);
+    if (base < 0 && atomic_compare_exchange_strong (&basetime, &base, now))
+        base = now;
+    return now - base;
+}
+
 //
 // I_GetTime
-// returns time in 1/70th second tics
+// returns time in 1/35th second tics
 //
 int  I_GetTime (void)
 {
-    struct timeval      tp;
-    int                 newtics;
-    static int          basetime=0;
+    return (int)(I_GetTimeUS ()*TICRATE/1000000);
+}
+
+//
+// I_GetTimeFrac
+// returns how far into the current tic we are, 0 - FRACUNIT-1
+//
+fixed_t I_GetTimeFrac (void)
+{
+    long long   ticus;
 
-    gettimeofday(&tp, NULL);
-    if (!basetime)
-        basetime = tp.tv_sec;
-    newtics = (tp.tv_sec-basetime)*TICRATE + tp.tv_usec*TICRATE/1000000;
-    return newtics;
+    ticus = I_GetTimeUS ()*TICRATE % 1000000;
+    return (fixed_t)(ticus*FRACUNIT/1000000);
+}
+
+//
+// I_Sleep
+// gives up the CPU for about the given number of microseconds
+//
+void I_Sleep (int usec)
+{
+#if defined(CLOCK_MONOTONIC)
+    struct timespec     ts;
+
+    if (usec <= 0)
+        return;
+    ts.tv_sec = usec/1000000;
+    ts.tv_nsec = (usec%1000000)*1000;
+    nanosleep (&ts, NULL);
+#else
+    // No scheduler to give the time to.
+    (void)usec;
+#endif
+}
+
+//
+// I_WaitTic
+// sleeps until I_GetTime reaches the given tic
+//
+void I_WaitTic (int tic)
+{
+    long long   now;
+    long long   due;
+
+    due = ((long long)tic*1000000 + TICRATE-1)/TICRATE;
+    while ((now = I_GetTimeUS ()) < due)
+        I_Sleep ((int)(due - now));
+}
+
+#ifdef HAVE_AVX2
+//
+// I_HaveAVX2
+//
+boolean I_HaveAVX2 (void)
+{
+    return __builtin_cpu_supports ("avx2") != 0;
 }
+#endif
 
 //
 // I_Init
@@ -98,10 +187,15 @@ void I_Init (void)
 void I_Quit (void)
 {
     D_QuitNetGame ();
+    P_WaitSave ();
+    P_ClearRewind ();
+    P_CloseSync ();
     I_ShutdownSound();
     I_ShutdownMusic();
     M_SaveDefaults ();
     I_ShutdownGraphics();
+    D_PrintInputLatency ();
+    W_PrintStats ();
     exit(0);
 }
 
@@ -23,6 +23,7 @@
 
 #include "d_ticcmd.h"
 #include "d_event.h"
+#include "m_fixed.h"
 
 // Called by DoomMain.
 void I_Init (void);
@@ -36,6 +37,29 @@ byte*   I_ZoneBase (int *size);
 // returns current time in tics.
 int I_GetTime (void);
 
+// Returns microseconds since an arbitrary starting point,
+// for measuring time intervals.
+long long I_GetTimeUS (void);
+
+// Returns the time elapsed within the current tic,
+// as a fraction of a tic (0 - FRACUNIT-1).
+fixed_t I_GetTimeFrac (void);
+
+// Gives up the CPU for about the given number of
+// microseconds, instead of busy-waiting.
+void I_Sleep (int usec);
+
+// Sleeps until I_GetTime returns at least the given tic.
+void I_WaitTic (int tic);
+
+// x86-64 builds have AVX2 versions of some loops, compiled
+// with AVX2_TARGET and taken when I_HaveAVX2 returns true.
+#if defined(__x86_64__) && defined(__GNUC__)
+#define HAVE_AVX2
+#define AVX2_TARGET __attribute__ ((target ("avx2")))
+boolean I_HaveAVX2 (void);
+#endif
+
 //
 // Called by D_DoomLoop,
 // called before processing any tics in a frame
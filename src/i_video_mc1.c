@@ -349,6 +349,7 @@ void I_UpdateNoBlit (void)
 void I_FinishUpdate (void)
 {
     memcpy (s_framebuffer, screens[0], SCREENWIDTH * SCREENHEIGHT);
+    D_AddInputLatency (D_TakeInputTime ());
 }
 
 void I_WaitVBL (int count)
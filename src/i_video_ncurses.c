@@ -15,24 +15,97 @@
 // GNU General Public License for more details.
 //
 // DESCRIPTION:
-//      Dummy system interface for video.
+//      Terminal interface for video.
+//      ncurses sets up the terminal, but frames are written as
+//      ANSI escape sequences: two pixels per cell using half
+//      blocks, in 24-bit or 256 colour, and only for the cells
+//      that changed since the previous frame.
+//      Keys are read from stdin by a thread of their own.
 //
 //-----------------------------------------------------------------------------
 
-#include <ncurses.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
 
+#include "d_main.h"
+#include "i_system.h"
 #include "i_video.h"
 #include "v_video.h"
 #include "doomdef.h"
 
+// The curses headers define these keys too.
+enum
+{
+    DOOM_KEY_ENTER = KEY_ENTER,
+    DOOM_KEY_BACKSPACE = KEY_BACKSPACE
+};
+
+// Included last, since the curses headers define true and false,
+// which would clash with the boolean type in doomtype.h.
+#include <ncurses.h>
+
 static const char COL_TO_CHAR[] = " .-~=+cuoaqO0X8@#";
 #define NUM_CHAR_LEVELS ((sizeof (COL_TO_CHAR) / sizeof (COL_TO_CHAR[0])) - 1)
 
-static boolean do_color;
-static int num_colors;
-static byte palette_lut[256];
-static byte short_palette[257 * 3];  // Actually (num_colors+1) * 3 entries.
+// Upper half block (U+2580) in UTF-8. The foreground colour is
+// the upper pixel and the background colour is the lower pixel.
+static const char HALF_BLOCK[] = "\xe2\x96\x80";
+
+typedef enum
+{
+    mode_mono,          // Grey scale ASCII art.
+    mode_256,           // xterm 256 colour palette.
+    mode_truecolor      // 24-bit colour.
+} colormode_t;
+
+static colormode_t color_mode;
+
+// Palette index -> ASCII character, xterm colour or 0xRRGGBB.
+static unsigned palette_lut[256];
+
+// What the terminal shows, one entry per cell. In the colour modes
+// the upper pixel colour is in the high half and the lower pixel
+// colour is in the low half.
+static unsigned long long* cells;
+static int cells_width;
+static int cells_height;
+
+// Frame output is collected here, and written with a single write.
+static char* out_buf;
+static size_t out_size;
+static size_t out_capacity;
+
+static int num_frames;
+static long long bytes_written;
+static size_t max_bytes_written;
+
+// A terminal only reports key presses, so a key is held down until
+// it has not repeated for a while. The first hold also covers the
+// delay before auto-repeat starts. Ctrl, Alt and Shift can't be
+// read, so fire, strafe and run need plain keys in the config.
+#define FIRST_HOLD_US 500000
+#define REPEAT_HOLD_US 100000
+#define MAX_HELD_KEYS 8
+
+typedef struct
+{
+    int key;
+    long long release_time;
+} held_key_t;
+
+// Only used by the input thread.
+static held_key_t held_keys[MAX_HELD_KEYS];
+static int num_held_keys;
+
+static pthread_t input_thread;
+static int input_thread_running;
+static atomic_int input_thread_quit;
 
 static int sqr_diff (int a, int b)
 {
@@ -45,8 +118,238 @@ static int color_diff (int r1, int g1, int b1, int r2, int g2, int b2)
     return sqr_diff (r1, r2) + sqr_diff (g1, g2) + sqr_diff (b1, b2);
 }
 
+static void out_reserve (size_t size)
+{
+    if (out_size + size <= out_capacity)
+        return;
+    while (out_size + size > out_capacity)
+        out_capacity = out_capacity ? out_capacity * 2 : 65536;
+    out_buf = (char*)realloc (out_buf, out_capacity);
+    if (out_buf == NULL)
+        I_Error ("I_FinishUpdate: Unable to allocate output buffer");
+}
+
+static void out_str (const char* str, size_t len)
+{
+    out_reserve (len);
+    memcpy (&out_buf[out_size], str, len);
+    out_size += len;
+}
+
+static void out_printf (const char* fmt, unsigned a, unsigned b, unsigned c)
+{
+    out_reserve (64);
+    out_size += (size_t)snprintf (&out_buf[out_size], 64, fmt, a, b, c);
+}
+
+static void out_flush (void)
+{
+    size_t pos = 0;
+    while (pos < out_size)
+    {
+        ssize_t n = write (STDOUT_FILENO, &out_buf[pos], out_size - pos);
+        if (n <= 0)
+            break;
+        pos += (size_t)n;
+    }
+    out_size = 0;
+}
+
+// Makes sure that the cell buffer matches the terminal size. On a
+// change the screen is cleared and every cell will be redrawn.
+static void check_size (void)
+{
+    struct winsize ws;
+    int width = COLS;
+    int height = LINES;
+    if (ioctl (STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 &&
+        ws.ws_row > 0)
+    {
+        width = ws.ws_col;
+        height = ws.ws_row;
+    }
+
+    if (cells != NULL && width == cells_width && height == cells_height)
+        return;
+
+    free (cells);
+    cells = (unsigned long long*)malloc (sizeof (unsigned long long) *
+                                         (size_t)(width * height));
+    if (cells == NULL)
+        I_Error ("I_FinishUpdate: Unable to allocate cell buffer");
+
+    // Nothing can match this, so all cells are drawn.
+    for (int i = 0; i < width * height; ++i)
+        cells[i] = ~0ULL;
+    cells_width = width;
+    cells_height = height;
+
+    out_str ("\x1b[0m\x1b[2J", 8);
+}
+
+static void printstats (void)
+{
+    if (num_frames == 0)
+        return;
+
+    printf ("I_ShutdownGraphics: %d frames, %.0f bytes written per frame, "
+            "max %lu\n",
+            num_frames,
+            (double)bytes_written / num_frames,
+            (unsigned long)max_bytes_written);
+}
+
+static void post_key (evtype_t type, int key)
+{
+    event_t event;
+    event.type = type;
+    event.data1 = key;
+    event.data2 = 0;
+    event.data3 = 0;
+    D_PostEvent (&event);
+}
+
+static void release_key (int index)
+{
+    post_key (ev_keyup, held_keys[index].key);
+    --num_held_keys;
+    memmove (&held_keys[index], &held_keys[index + 1],
+             sizeof (held_key_t) * (size_t)(num_held_keys - index));
+}
+
+static void press_key (int key, long long now)
+{
+    for (int i = 0; i < num_held_keys; ++i)
+    {
+        if (held_keys[i].key == key)
+        {
+            held_keys[i].release_time = now + REPEAT_HOLD_US;
+            return;
+        }
+    }
+
+    // Let go of the oldest key to make room.
+    if (num_held_keys == MAX_HELD_KEYS)
+        release_key (0);
+
+    post_key (ev_keydown, key);
+    held_keys[num_held_keys].key = key;
+    held_keys[num_held_keys].release_time = now + FIRST_HOLD_US;
+    ++num_held_keys;
+}
+
+static void release_expired_keys (long long now)
+{
+    int i = 0;
+    while (i < num_held_keys)
+    {
+        if (held_keys[i].release_time <= now)
+            release_key (i);
+        else
+            ++i;
+    }
+}
+
+// Translates the escape sequence after ESC [ or ESC O.
+static int escape_key (int number, int final)
+{
+    switch (final)
+    {
+        case 'A': return KEY_UPARROW;
+        case 'B': return KEY_DOWNARROW;
+        case 'C': return KEY_RIGHTARROW;
+        case 'D': return KEY_LEFTARROW;
+        case 'P': return KEY_F1;
+        case 'Q': return KEY_F2;
+        case 'R': return KEY_F3;
+        case 'S': return KEY_F4;
+        case '~':
+            switch (number)
+            {
+                case 11: return KEY_F1;
+                case 12: return KEY_F2;
+                case 13: return KEY_F3;
+                case 14: return KEY_F4;
+                case 15: return KEY_F5;
+                case 17: return KEY_F6;
+                case 18: return KEY_F7;
+                case 19: return KEY_F8;
+                case 20: return KEY_F9;
+                case 21: return KEY_F10;
+                case 23: return KEY_F11;
+                case 24: return KEY_F12;
+            }
+            break;
+    }
+    return 0;
+}
+
+// Turns the bytes read from the terminal into key presses.
+static void decode_keys (const unsigned char* buf, int len, long long now)
+{
+    int i = 0;
+    while (i < len)
+    {
+        int c = buf[i++];
+        int key = 0;
+
+        if (c == 27 && i + 1 < len && (buf[i] == '[' || buf[i] == 'O'))
+        {
+            int number = 0;
+            for (++i; i < len && buf[i] >= '0' && buf[i] <= '9'; ++i)
+                number = number * 10 + (buf[i] - '0');
+            if (i < len)
+                key = escape_key (number, buf[i++]);
+        }
+        else if (c == 27)
+            key = KEY_ESCAPE;
+        else if (c == '\r' || c == '\n')
+            key = DOOM_KEY_ENTER;
+        else if (c == 127 || c == 8)
+            key = DOOM_KEY_BACKSPACE;
+        else if (c == '\t')
+            key = KEY_TAB;
+        else if (c >= 'A' && c <= 'Z')
+            key = c - 'A' + 'a';
+        else if (c >= ' ' && c < 127)
+            key = c;
+
+        if (key)
+            press_key (key, now);
+    }
+}
+
+static void* input_thread_main (void* arg)
+{
+    struct pollfd pfd;
+    unsigned char buf[64];
+    ssize_t n;
+
+    (void)arg;
+    while (!atomic_load (&input_thread_quit))
+    {
+        pfd.fd = STDIN_FILENO;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll (&pfd, 1, num_held_keys ? 10 : 50) > 0)
+        {
+            n = read (STDIN_FILENO, buf, sizeof (buf));
+            if (n <= 0)
+                break;
+            decode_keys (buf, (int)n, I_GetTimeUS ());
+        }
+        release_expired_keys (I_GetTimeUS ());
+    }
+
+    while (num_held_keys > 0)
+        release_key (0);
+    return NULL;
+}
+
 void I_InitGraphics (void)
 {
+    const char* colorterm;
+
     // Allocate memory for the framebuffer.
     screens[0] = (byte*)malloc (SCREENWIDTH * SCREENHEIGHT);
 
@@ -56,33 +359,26 @@ void I_InitGraphics (void)
     intrflush (stdscr, FALSE);
     keypad (stdscr, TRUE);
 
-    // Detect color capabilities.
-    do_color = false;
+    // Detect color capabilities. There is no terminfo entry for
+    // 24-bit colour, but terminals that support it set COLORTERM.
+    color_mode = mode_mono;
     if (has_colors () == TRUE)
-    {
-// Note: init_color() appears to have no effect on macOS terminals.
-#if !defined(__APPLE__)
         start_color ();
-        num_colors = ((COLOR_PAIRS - 1) < 256) ? (COLOR_PAIRS - 1) : 256;
-        num_colors = (COLORS < num_colors) ? COLORS : num_colors;
-
-        if (num_colors > 100 && can_change_color () == TRUE)
-        {
-            for (int i = 0; i < num_colors; ++i)
-            {
-                // Generate a curses pair.
-                init_pair (i + 1, i, i);
-            }
-
-            // Let the short palette wrap by appending the first element last.
-            short_palette[num_colors * 3 + 0] = short_palette[0];
-            short_palette[num_colors * 3 + 1] = short_palette[1];
-            short_palette[num_colors * 3 + 2] = short_palette[2];
-
-            do_color = true;
-        }
-#endif
-    }
+    colorterm = getenv ("COLORTERM");
+    if (colorterm != NULL && (strcmp (colorterm, "truecolor") == 0 ||
+                              strcmp (colorterm, "24bit") == 0))
+        color_mode = mode_truecolor;
+    else if (has_colors () == TRUE && COLORS >= 256)
+        color_mode = mode_256;
+
+    // Hide the cursor.
+    out_str ("\x1b[?25l", 6);
+
+    // Post the keys from a thread, so that they get into the event
+    // queue while the game loop is busy with a frame.
+    atomic_store (&input_thread_quit, 0);
+    input_thread_running =
+        pthread_create (&input_thread, NULL, input_thread_main, NULL) == 0;
 
 // Redirect stderr to /dev/null.
 // TODO(m): Maybe redirect to a pipe and show it in I_ShutdownGraphics?
@@ -95,8 +391,25 @@ void I_InitGraphics (void)
 
 void I_ShutdownGraphics (void)
 {
+    if (input_thread_running)
+    {
+        atomic_store (&input_thread_quit, 1);
+        pthread_join (input_thread, NULL);
+        input_thread_running = 0;
+    }
+
+    // Restore the colours and the cursor.
+    out_str ("\x1b[0m\x1b[2J\x1b[?25h", 14);
+    out_flush ();
     endwin ();
+    printstats ();
+
     free (screens[0]);
+    free (cells);
+    cells = NULL;
+    free (out_buf);
+    out_buf = NULL;
+    out_capacity = 0;
 }
 
 void I_StartFrame (void)
@@ -106,107 +419,73 @@ void I_StartFrame (void)
 
 void I_StartTic (void)
 {
-    // Er? This is declared in i_system.h.
+    // The input thread posts the keys.
 }
 
 void I_SetPalette (byte* palette)
 {
-    int pal_idx;
-    int next_pal_idx;
     int i;
     int j;
-    int best_value;
-    int best_err;
-    int err;
     int r;
     int g;
     int b;
+    int best_value;
+    int best_err;
+    int err;
     int brightness;
-    short rs;
-    short gs;
-    short bs;
-    int col_div;
 
-    if (do_color)
+    for (i = 0; i < 256; ++i)
     {
-        // Create a smaller palette consisting of num_colors.
-        next_pal_idx = 0;
-        for (i = 0; i < num_colors; ++i)
+        // The color that we want.
+        r = (int)palette[i * 3 + 0];
+        g = (int)palette[i * 3 + 1];
+        b = (int)palette[i * 3 + 2];
+
+        if (color_mode == mode_truecolor)
         {
-            pal_idx = next_pal_idx;
-            next_pal_idx = ((i + 1) * 256) / num_colors;
-
-            // Calculate the average color for a number of palette entries.
-            // Note: This assumes that the palette is reasonably smooth.
-            r = 0;
-            g = 0;
-            b = 0;
-            for (j = pal_idx; j < next_pal_idx; ++j)
-            {
-                r += (int)*palette++;
-                g += (int)*palette++;
-                b += (int)*palette++;
-            }
-            col_div = next_pal_idx - pal_idx;
-            r = (r + (col_div >> 1)) / col_div;
-            g = (g + (col_div >> 1)) / col_div;
-            b =  (b + (col_div >> 1)) / col_div;
-
-            // Store the average color in the short palette.
-            short_palette[i * 3 + 0] = (byte)r;
-            short_palette[i * 3 + 1] = (byte)g;
-            short_palette[i * 3 + 2] = (byte)b;
-
-            // Generate a curses color.
-            rs = (short)((1000 * r) / 255);
-            gs = (short)((1000 * g) / 255);
-            bs = (short)((1000 * b) / 255);
-            init_color ((short)i, rs, gs, bs);
+            palette_lut[i] = ((unsigned)r << 16) | ((unsigned)g << 8) |
+                             (unsigned)b;
         }
-
-        // Define the optimal palette -> short_palette LUT.
-        for (i = 0; i < 256; ++i)
+        else if (color_mode == mode_256)
         {
-            // The color that we want.
-            r = (int)palette[i * 3 + 0];
-            g = (int)palette[i * 3 + 1];
-            b = (int)palette[i * 3 + 2];
-
-            // Find the closest match.
-            best_err = 99999999;
-            best_value = 0;
-            for (j = 0; j < num_colors; ++j)
+            // Find the closest match in the 6x6x6 color cube
+            // (16-231) and the grey ramp (232-255).
+            static const int CUBE[6] = {0, 95, 135, 175, 215, 255};
+            int ri = 0;
+            int gi = 0;
+            int bi = 0;
+            for (j = 1; j < 6; ++j)
+            {
+                if (sqr_diff (r, CUBE[j]) < sqr_diff (r, CUBE[ri]))
+                    ri = j;
+                if (sqr_diff (g, CUBE[j]) < sqr_diff (g, CUBE[gi]))
+                    gi = j;
+                if (sqr_diff (b, CUBE[j]) < sqr_diff (b, CUBE[bi]))
+                    bi = j;
+            }
+            best_value = 16 + 36 * ri + 6 * gi + bi;
+            best_err =
+                color_diff (r, g, b, CUBE[ri], CUBE[gi], CUBE[bi]);
+            for (j = 0; j < 24; ++j)
             {
-                err = color_diff (r,
-                                  g,
-                                  b,
-                                  (int)short_palette[j * 3 + 0],
-                                  (int)short_palette[j * 3 + 1],
-                                  (int)short_palette[j * 3 + 2]);
+                int grey = 8 + 10 * j;
+                err = color_diff (r, g, b, grey, grey, grey);
                 if (err < best_err)
                 {
-                    best_value = j;
+                    best_value = 232 + j;
                     best_err = err;
                 }
             }
-            palette_lut[i] = (byte)best_value;
+            palette_lut[i] = (unsigned)best_value;
         }
-    }
-    else
-    {
-        for (i = 0; i < 256; ++i)
+        else
         {
-            // The color that we want.
-            r = (int)palette[i * 3 + 0];
-            g = (int)palette[i * 3 + 1];
-            b = (int)palette[i * 3 + 2];
-
             // Convert to grey scale.
             brightness = (76 * r + 150 * g + 30 * b) >> 8;
 
             // Convert to a character.
             best_value = ((NUM_CHAR_LEVELS - 1) * brightness + 128) / 255;
-            palette_lut[i] = (byte)COL_TO_CHAR[best_value];
+            palette_lut[i] = (unsigned)COL_TO_CHAR[best_value];
         }
     }
 }
@@ -217,49 +496,102 @@ void I_UpdateNoBlit (void)
 
 void I_FinishUpdate (void)
 {
-    int text_width;
-    int text_height;
     int x;
     int y;
-
-    // Get consol size.
-    text_width = COLS;
-    text_height = LINES;
-
-    // We just do nearest neigbour sampling.
-    for (y = 0; y < text_height; ++y)
+    int cur_x;
+    int cur_y;
+    unsigned long long cur_colors;
+
+    check_size ();
+
+    // The cursor position and colours are unknown at the start of
+    // the frame, so the first changed cell always sets them.
+    cur_x = -1;
+    cur_y = -1;
+    cur_colors = ~0ULL;
+
+    // We just do nearest neigbour sampling. In the colour modes
+    // each cell holds two pixels, one above the other.
+    const int pixel_rows = color_mode == mode_mono ? cells_height
+                                                   : cells_height * 2;
+    for (y = 0; y < cells_height; ++y)
     {
-        int v = (y * SCREENHEIGHT) / text_height;
-        byte* row = &screens[0][v * SCREENWIDTH];
-        if (do_color)
+        const byte* upper;
+        const byte* lower;
+        if (color_mode == mode_mono)
         {
-            int last_pair = 1;
-            attron (COLOR_PAIR (last_pair));
-            for (x = 0; x < text_width; ++x)
-            {
-                int u = (x * SCREENWIDTH) / text_width;
-                int pair = 1 + (int)palette_lut[row[u]];
-                if (pair != last_pair)
-                {
-                    attroff (COLOR_PAIR (last_pair));
-                    attron (COLOR_PAIR (pair));
-                    last_pair = pair;
-                }
-                mvaddch (y, x, ' ');
-            }
-            attroff (COLOR_PAIR (last_pair));
+            upper = &screens[0][((y * SCREENHEIGHT) / pixel_rows) *
+                                SCREENWIDTH];
+            lower = upper;
         }
         else
         {
-            for (x = 0; x < text_width; ++x)
+            upper = &screens[0][(((y * 2) * SCREENHEIGHT) / pixel_rows) *
+                                SCREENWIDTH];
+            lower = &screens[0][(((y * 2 + 1) * SCREENHEIGHT) / pixel_rows) *
+                                SCREENWIDTH];
+        }
+
+        unsigned long long* cell = &cells[y * cells_width];
+        for (x = 0; x < cells_width; ++x)
+        {
+            int u = (x * SCREENWIDTH) / cells_width;
+            unsigned long long colors =
+                ((unsigned long long)palette_lut[upper[u]] << 32) |
+                palette_lut[lower[u]];
+            if (colors == cell[x])
+                continue;
+            cell[x] = colors;
+
+            // Move the cursor, unless it is already there.
+            if (x != cur_x || y != cur_y)
+                out_printf ("\x1b[%u;%uH", (unsigned)y + 1, (unsigned)x + 1, 0);
+
+            if (color_mode == mode_mono)
             {
-                int u = (x * SCREENWIDTH) / text_width;
-                mvaddch (y, x, (chtype)palette_lut[row[u]]);
+                char c = (char)palette_lut[upper[u]];
+                out_str (&c, 1);
             }
+            else
+            {
+                unsigned fg = (unsigned)(colors >> 32);
+                unsigned bg = (unsigned)colors;
+                if (colors != cur_colors)
+                {
+                    if (color_mode == mode_truecolor)
+                    {
+                        if (fg != (unsigned)(cur_colors >> 32))
+                            out_printf ("\x1b[38;2;%u;%u;%um",
+                                        fg >> 16, (fg >> 8) & 255, fg & 255);
+                        if (bg != (unsigned)cur_colors)
+                            out_printf ("\x1b[48;2;%u;%u;%um",
+                                        bg >> 16, (bg >> 8) & 255, bg & 255);
+                    }
+                    else
+                    {
+                        if (fg != (unsigned)(cur_colors >> 32))
+                            out_printf ("\x1b[38;5;%um", fg, 0, 0);
+                        if (bg != (unsigned)cur_colors)
+                            out_printf ("\x1b[48;5;%um", bg, 0, 0);
+                    }
+                    cur_colors = colors;
+                }
+                out_str (HALF_BLOCK, sizeof (HALF_BLOCK) - 1);
+            }
+
+            // Writing the last column may leave the cursor
+            // anywhere, so don't assume that it advanced.
+            cur_x = x + 1 < cells_width ? x + 1 : -1;
+            cur_y = y;
         }
     }
 
-    refresh ();
+    ++num_frames;
+    bytes_written += (long long)out_size;
+    if (out_size > max_bytes_written)
+        max_bytes_written = out_size;
+    out_flush ();
+    D_AddInputLatency (D_TakeInputTime ());
 }
 
 void I_WaitVBL (int count)
@@ -28,14 +28,71 @@
 #include "d_main.h"
 #include "i_system.h"
 #include "m_argv.h"
+#include "m_bbox.h"
 #include "v_video.h"
 
+#ifdef HAVE_AVX2
+#include <immintrin.h>
+static boolean s_avx2;
+#endif
+
 static SDL_Window* s_window;
 static SDL_Renderer* s_renderer;
 static SDL_Texture* s_texture;
 
 static unsigned int s_palette[256];
 
+// Frames are handed over to the conversion thread through a triple
+// buffer, so that the game never has to wait for the conversion. Each
+// frame carries its own copy of the palette.
+//
+// SDL only supports the render API on the thread that created the window
+// and pumps its events, so the conversion thread makes no SDL video calls.
+// It converts the frames to ARGB in s_pixels, and the main thread uploads
+// and presents them when they are ready. The main thread never waits for
+// the conversion thread: if it is busy, the frame is presented later.
+#define NUM_FRAMES 3
+
+typedef struct
+{
+    unsigned char pixels[SCREENWIDTH * SCREENHEIGHT];
+    unsigned int palette[256];
+    SDL_Rect dirty;    // Part that changed since the previous frame.
+    Uint64 timestamp;  // When the frame was handed over.
+    long long inputtime;  // Oldest input reflected by the frame, or -1.
+} frame_t;
+
+static boolean s_threaded;
+static SDL_Thread* s_thread;
+static SDL_mutex* s_mutex;
+static SDL_cond* s_cond;
+static frame_t* s_frames;
+static int s_ready_frame = -1;       // Latest frame, not yet picked up.
+static int s_converting_frame = -1;  // Frame owned by the thread.
+static boolean s_quit_thread;
+
+// The converted frame, guarded by s_pixels_mutex.
+static SDL_mutex* s_pixels_mutex;
+static unsigned int* s_pixels;
+static boolean s_pixels_ready;       // Converted, not presented yet.
+static SDL_Rect s_pixels_dirty;      // Part not uploaded yet.
+static Uint64 s_pixels_timestamp;
+static long long s_pixels_inputtime;
+
+// The palette of the converted pixels, used to tell if the whole frame
+// has to be converted again.
+static unsigned int s_texture_palette[256];
+static boolean s_texture_valid;
+
+// Frame latency statistics (handover to present).
+static int s_num_presented;
+static int s_num_dropped;            // Replaced before conversion.
+static int s_num_unshown;            // Replaced after conversion.
+static Uint64 s_latency_sum;
+static Uint64 s_latency_max;
+static Uint64 s_bytes_converted;
+static Uint64 s_first_frame_time;
+
 static unsigned int color_to_argb8888 (unsigned int r,
                                        unsigned int g,
                                        unsigned int b)
@@ -200,6 +257,319 @@ static void handleevent (SDL_Event* sdlevent)
     }
 }
 
+static void createrenderer (boolean novsync)
+{
+    int video_w = SCREENWIDTH;
+    int video_h = SCREENHEIGHT;
+
+    // Create the renderer.
+    s_renderer = SDL_CreateRenderer (
+        s_window, -1, novsync ? 0 : SDL_RENDERER_PRESENTVSYNC);
+    if (s_renderer == NULL)
+        return;
+    SDL_RenderSetLogicalSize (s_renderer, video_w, video_h);
+
+    // Create the texture.
+    s_texture = SDL_CreateTexture (s_renderer,
+                                   SDL_PIXELFORMAT_ARGB8888,
+                                   SDL_TEXTUREACCESS_STREAMING,
+                                   video_w,
+                                   video_h);
+}
+
+// Get the dirty part of screen 0 as an SDL rectangle, and start over.
+static void getdirtyrect (SDL_Rect* rect)
+{
+    int x1 = dirtybox[BOXLEFT] < 0 ? 0 : dirtybox[BOXLEFT];
+    int x2 = dirtybox[BOXRIGHT] >= SCREENWIDTH ? SCREENWIDTH - 1
+                                               : dirtybox[BOXRIGHT];
+    int y1 = dirtybox[BOXBOTTOM] < 0 ? 0 : dirtybox[BOXBOTTOM];
+    int y2 = dirtybox[BOXTOP] >= SCREENHEIGHT ? SCREENHEIGHT - 1
+                                              : dirtybox[BOXTOP];
+    rect->x = x1;
+    rect->y = y1;
+    rect->w = x2 >= x1 ? x2 - x1 + 1 : 0;
+    rect->h = y2 >= y1 ? y2 - y1 + 1 : 0;
+    V_ClearDirtyBox ();
+}
+
+static void unionrect (SDL_Rect* rect, const SDL_Rect* other)
+{
+    if (other->w <= 0 || other->h <= 0)
+        return;
+    if (rect->w <= 0 || rect->h <= 0)
+    {
+        *rect = *other;
+        return;
+    }
+    int x1 = rect->x < other->x ? rect->x : other->x;
+    int y1 = rect->y < other->y ? rect->y : other->y;
+    int x2 = rect->x + rect->w > other->x + other->w ? rect->x + rect->w
+                                                     : other->x + other->w;
+    int y2 = rect->y + rect->h > other->y + other->h ? rect->y + rect->h
+                                                     : other->y + other->h;
+    rect->x = x1;
+    rect->y = y1;
+    rect->w = x2 - x1;
+    rect->h = y2 - y1;
+}
+
+#ifdef HAVE_AVX2
+// Expand pixels eight at a time, returns how many were done.
+AVX2_TARGET
+static int expandrow_avx2 (unsigned int* dst,
+                           const unsigned char* src,
+                           const unsigned int* palette,
+                           int count)
+{
+    int x = 0;
+    for (; x <= count - 8; x += 8)
+    {
+        __m128i idx8 = _mm_loadl_epi64 ((const __m128i*)&src[x]);
+        __m256i idx = _mm256_cvtepu8_epi32 (idx8);
+        __m256i argb = _mm256_i32gather_epi32 ((const int*)palette, idx, 4);
+        _mm256_storeu_si256 ((__m256i*)&dst[x], argb);
+    }
+    return x;
+}
+#endif
+
+// Expand a row of 8-bit indexed pixels to 32-bit ARGB.
+static void expandrow (unsigned int* dst,
+                       const unsigned char* src,
+                       const unsigned int* palette,
+                       int count)
+{
+    int x = 0;
+#ifdef HAVE_AVX2
+    if (s_avx2)
+        x = expandrow_avx2 (dst, src, palette, count);
+#endif
+    for (; x <= count - 4; x += 4)
+    {
+        unsigned int c0 = palette[src[x]];
+        unsigned int c1 = palette[src[x + 1]];
+        unsigned int c2 = palette[src[x + 2]];
+        unsigned int c3 = palette[src[x + 3]];
+        dst[x] = c0;
+        dst[x + 1] = c1;
+        dst[x + 2] = c2;
+        dst[x + 3] = c3;
+    }
+    for (; x < count; ++x)
+        dst[x] = palette[src[x]];
+}
+
+// The part of a frame to convert: all of it when the palette changed.
+static void convertrect (const unsigned int* palette,
+                         const SDL_Rect* dirty,
+                         SDL_Rect* rect)
+{
+    *rect = *dirty;
+    if (!s_texture_valid ||
+        memcmp (palette, s_texture_palette, sizeof (s_texture_palette)) != 0)
+    {
+        rect->x = 0;
+        rect->y = 0;
+        rect->w = SCREENWIDTH;
+        rect->h = SCREENHEIGHT;
+        memcpy (s_texture_palette, palette, sizeof (s_texture_palette));
+        s_texture_valid = true;
+    }
+}
+
+// Convert a part of a frame from 8-bit indexed pixels to 32-bit ARGB.
+// The destination points at the top left corner of the rectangle.
+static void convertframe (unsigned int* dst,
+                          int pitch,
+                          const unsigned char* src,
+                          const unsigned int* palette,
+                          const SDL_Rect* rect)
+{
+    src += rect->y * SCREENWIDTH + rect->x;
+    for (int y = 0; y < rect->h; ++y)
+    {
+        expandrow (dst, src, palette, rect->w);
+        src += SCREENWIDTH;
+        dst += pitch;
+    }
+    s_bytes_converted += (Uint64)rect->w * rect->h;
+}
+
+static void render (void)
+{
+    SDL_RenderClear (s_renderer);
+    SDL_RenderCopy (s_renderer, s_texture, NULL, NULL);
+    SDL_RenderPresent (s_renderer);
+}
+
+static void addlatency (Uint64 timestamp, long long inputtime)
+{
+    Uint64 latency = SDL_GetPerformanceCounter () - timestamp;
+    ++s_num_presented;
+    s_latency_sum += latency;
+    if (latency > s_latency_max)
+        s_latency_max = latency;
+    D_AddInputLatency (inputtime);
+}
+
+// Convert the dirty part of a frame straight into the texture and present
+// it, for -syncvideo.
+static void presentframe (const unsigned char* src,
+                          const unsigned int* palette,
+                          const SDL_Rect* dirty)
+{
+    SDL_Rect rect;
+    convertrect (palette, dirty, &rect);
+    if (rect.w > 0 && rect.h > 0)
+    {
+        void* pixels;
+        int pitch;
+        if (SDL_LockTexture (s_texture, &rect, &pixels, &pitch) != 0)
+        {
+            fprintf (stderr, "I_FinishUpdate: Unable to lock texture\n");
+            s_texture_valid = false;
+            return;
+        }
+        convertframe ((unsigned int*)pixels, pitch / 4, src, palette, &rect);
+        SDL_UnlockTexture (s_texture);
+    }
+    render ();
+}
+
+// Upload and present the latest converted frame, if there is one and the
+// conversion thread is not busy with the next one. Main thread only.
+static void presentconverted (void)
+{
+    if (SDL_TryLockMutex (s_pixels_mutex) != 0)
+        return;
+    if (!s_pixels_ready)
+    {
+        SDL_UnlockMutex (s_pixels_mutex);
+        return;
+    }
+
+    SDL_Rect rect = s_pixels_dirty;
+    if (rect.w > 0 && rect.h > 0)
+    {
+        const unsigned int* pixels = &s_pixels[rect.y * SCREENWIDTH + rect.x];
+        if (SDL_UpdateTexture (s_texture, &rect, pixels, SCREENWIDTH * 4) != 0)
+            fprintf (stderr, "I_FinishUpdate: Unable to update texture\n");
+    }
+    s_pixels_dirty.w = s_pixels_dirty.h = 0;
+    s_pixels_ready = false;
+    Uint64 timestamp = s_pixels_timestamp;
+    long long inputtime = s_pixels_inputtime;
+    SDL_UnlockMutex (s_pixels_mutex);
+
+    render ();
+    addlatency (timestamp, inputtime);
+}
+
+static int convertthread (void* data)
+{
+    (void)data;
+
+    SDL_LockMutex (s_mutex);
+    while (1)
+    {
+        while (s_ready_frame < 0 && !s_quit_thread)
+            SDL_CondWait (s_cond, s_mutex);
+        if (s_quit_thread)
+            break;
+
+        // Take ownership of the latest frame.
+        s_converting_frame = s_ready_frame;
+        s_ready_frame = -1;
+        frame_t* frame = &s_frames[s_converting_frame];
+        SDL_UnlockMutex (s_mutex);
+
+        // Convert it, on top of a frame that may not have been presented
+        // yet. Its changes and input are then carried over.
+        SDL_Rect rect;
+        SDL_LockMutex (s_pixels_mutex);
+        convertrect (frame->palette, &frame->dirty, &rect);
+        convertframe (&s_pixels[rect.y * SCREENWIDTH + rect.x],
+                      SCREENWIDTH,
+                      frame->pixels,
+                      frame->palette,
+                      &rect);
+        unionrect (&s_pixels_dirty, &rect);
+        if (s_pixels_ready)
+        {
+            ++s_num_unshown;
+            if (s_pixels_inputtime >= 0 &&
+                (frame->inputtime < 0 ||
+                 s_pixels_inputtime < frame->inputtime))
+                frame->inputtime = s_pixels_inputtime;
+        }
+        s_pixels_timestamp = frame->timestamp;
+        s_pixels_inputtime = frame->inputtime;
+        s_pixels_ready = true;
+        SDL_UnlockMutex (s_pixels_mutex);
+
+        SDL_LockMutex (s_mutex);
+        s_converting_frame = -1;
+    }
+    SDL_UnlockMutex (s_mutex);
+    return 0;
+}
+
+static void startthread (void)
+{
+    s_frames = (frame_t*)malloc (NUM_FRAMES * sizeof (frame_t));
+    s_pixels = (unsigned int*)malloc (SCREENWIDTH * SCREENHEIGHT *
+                                      sizeof (unsigned int));
+    s_mutex = SDL_CreateMutex ();
+    s_cond = SDL_CreateCond ();
+    s_pixels_mutex = SDL_CreateMutex ();
+    if (s_frames == NULL || s_pixels == NULL || s_mutex == NULL ||
+        s_cond == NULL || s_pixels_mutex == NULL)
+        I_Error ("Couldn't create the SDL conversion thread state");
+
+    s_thread = SDL_CreateThread (convertthread, "convert", NULL);
+    if (s_thread == NULL)
+        I_Error ("Couldn't create the SDL conversion thread");
+}
+
+static void stopthread (void)
+{
+    SDL_LockMutex (s_mutex);
+    s_quit_thread = true;
+    SDL_CondSignal (s_cond);
+    SDL_UnlockMutex (s_mutex);
+    SDL_WaitThread (s_thread, NULL);
+    s_thread = NULL;
+
+    SDL_DestroyMutex (s_pixels_mutex);
+    SDL_DestroyCond (s_cond);
+    SDL_DestroyMutex (s_mutex);
+    free (s_pixels);
+    free (s_frames);
+}
+
+static void printstats (void)
+{
+    if (s_num_presented == 0)
+        return;
+
+    double freq = (double)SDL_GetPerformanceFrequency ();
+    double seconds =
+        (double)(SDL_GetPerformanceCounter () - s_first_frame_time) / freq;
+    printf ("I_ShutdownGraphics: %.1f fps rendered, "
+            "%d frames presented, %d dropped, "
+            "latency avg %.2f ms, max %.2f ms, "
+            "%.0f of %d bytes converted per frame\n",
+            (double)(s_num_presented + s_num_dropped + s_num_unshown) /
+                seconds,
+            s_num_presented,
+            s_num_dropped + s_num_unshown,
+            1000.0 * (double)s_latency_sum / (freq * s_num_presented),
+            1000.0 * (double)s_latency_max / freq,
+            (double)s_bytes_converted / s_num_presented,
+            SCREENWIDTH * SCREENHEIGHT);
+}
+
 void I_InitGraphics (void)
 {
     // Only initialize once.
@@ -213,8 +583,15 @@ void I_InitGraphics (void)
     boolean novsync =
         (M_CheckParm ("-novsync") != 0) || (M_CheckParm ("-timedemo") != 0);
     boolean grabmouse = M_CheckParm ("-grabmouse") != 0;
-    int video_w = SCREENWIDTH;
-    int video_h = SCREENHEIGHT;
+
+    // Convert frames on a separate thread, unless asked not to. All SDL
+    // video calls, including the present, stay on the main thread, so with
+    // vsync the main thread still waits for the display when it presents.
+    s_threaded = M_CheckParm ("-syncvideo") == 0;
+
+#ifdef HAVE_AVX2
+    s_avx2 = I_HaveAVX2 ();
+#endif
 
     // Should we open the window in fullscreen mode?
     Uint32 window_flags = 0;
@@ -237,22 +614,16 @@ void I_InitGraphics (void)
     if (s_window == NULL)
         I_Error ("Couldn't create SDL window");
 
-    // Create the renderer.
-    s_renderer = SDL_CreateRenderer (
-        s_window, -1, novsync ? 0 : SDL_RENDERER_PRESENTVSYNC);
+    // Create the renderer and the texture.
+    createrenderer (novsync);
     if (s_renderer == NULL)
         I_Error ("Couldn't create SDL renderer");
-    SDL_RenderSetLogicalSize (s_renderer, video_w, video_h);
-
-    // Create the texture.
-    s_texture = SDL_CreateTexture (s_renderer,
-                                   SDL_PIXELFORMAT_ARGB8888,
-                                   SDL_TEXTUREACCESS_STREAMING,
-                                   video_w,
-                                   video_h);
     if (s_texture == NULL)
         I_Error ("Couldn't create SDL texture");
 
+    if (s_threaded)
+        startthread ();
+
     // Configure the mouse.
     if (grabmouse || fullscreen)
     {
@@ -269,9 +640,12 @@ void I_InitGraphics (void)
 
 void I_ShutdownGraphics (void)
 {
-    free (screens[0]);
+    if (s_thread != NULL)
+        stopthread ();
     SDL_DestroyTexture (s_texture);
     SDL_DestroyRenderer (s_renderer);
+    printstats ();
+    free (screens[0]);
     SDL_DestroyWindow (s_window);
     SDL_Quit ();
 }
@@ -283,11 +657,15 @@ void I_WaitVBL (int count)
 
 void I_StartFrame (void)
 {
-    // er?
+    if (s_thread != NULL)
+        presentconverted ();
 }
 
 void I_StartTic (void)
 {
+    if (s_thread != NULL)
+        presentconverted ();
+
     SDL_Event e;
     while (SDL_PollEvent (&e))
         handleevent (&e);
@@ -300,30 +678,54 @@ void I_UpdateNoBlit (void)
 
 void I_FinishUpdate (void)
 {
-    // Copy the internal screen to the SDL texture, converting the
-    // 8-bit indexed pixels to 32-bit ARGB.
-    void* pixels;
-    int pitch;
-    if (SDL_LockTexture (s_texture, NULL, &pixels, &pitch) != 0)
+    Uint64 start = SDL_GetPerformanceCounter ();
+    if (s_first_frame_time == 0)
+        s_first_frame_time = start;
+
+    SDL_Rect dirty;
+    getdirtyrect (&dirty);
+
+    if (s_thread == NULL)
     {
-        fprintf (stderr, "I_FinishUpdate: Unable to lock texture\n");
+        presentframe ((const unsigned char*)screens[0], s_palette, &dirty);
+        addlatency (start, D_TakeInputTime ());
         return;
     }
-    const unsigned char* src = (const unsigned char*)screens[0];
-    unsigned int* dst = (unsigned int*)pixels;
-    for (int y = 0; y < SCREENHEIGHT; ++y)
+
+    // Present what the thread has converted so far.
+    presentconverted ();
+
+    // Pick a frame that the conversion thread does not own. With three
+    // frames there is always one, so we never wait for the thread.
+    SDL_LockMutex (s_mutex);
+    int slot = 0;
+    while (slot == s_ready_frame || slot == s_converting_frame)
+        ++slot;
+    SDL_UnlockMutex (s_mutex);
+
+    frame_t* frame = &s_frames[slot];
+    memcpy (frame->pixels, screens[0], SCREENWIDTH * SCREENHEIGHT);
+    memcpy (frame->palette, s_palette, sizeof (s_palette));
+    frame->timestamp = start;
+    long long inputtime = D_TakeInputTime ();
+
+    // Hand it over, replacing any frame that was not picked up in time.
+    // The changes and input of a replaced frame are carried over.
+    SDL_LockMutex (s_mutex);
+    if (s_ready_frame >= 0)
     {
-        for (int x = 0; x < SCREENWIDTH; ++x)
-            dst[x] = s_palette[src[x]];
-        src += SCREENWIDTH;
-        dst += pitch / 4;
+        frame_t* dropped = &s_frames[s_ready_frame];
+        unionrect (&dirty, &dropped->dirty);
+        if (dropped->inputtime >= 0 &&
+            (inputtime < 0 || dropped->inputtime < inputtime))
+            inputtime = dropped->inputtime;
+        ++s_num_dropped;
     }
-    SDL_UnlockTexture (s_texture);
-
-    // Render the texture.
-    SDL_RenderClear (s_renderer);
-    SDL_RenderCopy (s_renderer, s_texture, NULL, NULL);
-    SDL_RenderPresent (s_renderer);
+    frame->dirty = dirty;
+    frame->inputtime = inputtime;
+    s_ready_frame = slot;
+    SDL_CondSignal (s_cond);
+    SDL_UnlockMutex (s_mutex);
 }
 
 void I_ReadScreen (byte* scr)
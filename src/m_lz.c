@@ -0,0 +1,220 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Simple LZ77 codec, used for compressed lumps.
+//
+//      The stream is a list of sequences. Each sequence starts with
+//      a token byte: the upper nibble is the number of literals and
+//      the lower nibble is the match length minus MINMATCH. A nibble
+//      of 15 is followed by extra length bytes, which are added until
+//      a byte below 255. Then come the literals, and a 16-bit little
+//      endian match offset. The last sequence has no match, so the
+//      stream ends right after its literals.
+//
+//      Decoding only needs byte reads and copies, and no memory
+//      besides the output buffer.
+//
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "m_lz.h"
+
+#define MINMATCH        4
+#define MAXOFFSET       65535
+#define HASHBITS        12
+
+static unsigned LZ_Hash (const byte* p)
+{
+    unsigned x = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+    return (x * 2654435761u) >> (32 - HASHBITS);
+}
+
+//
+// LZ_PutLength
+// Writes the extra bytes of a length that did not fit in a nibble.
+//
+static byte* LZ_PutLength (byte* op, byte* end, int len)
+{
+    for ( ; len >= 255 ; len -= 255)
+    {
+        if (op >= end)
+            return NULL;
+        *op++ = 255;
+    }
+    if (op >= end)
+        return NULL;
+    *op++ = (byte)len;
+    return op;
+}
+
+//
+// LZ_PutSequence
+// Writes literals followed by a match. A matchlen of 0 marks
+// the last sequence, which has no match.
+//
+static byte* LZ_PutSequence (byte* op,
+                             byte* end,
+                             const byte* lit,
+                             int litlen,
+                             int offset,
+                             int matchlen)
+{
+    byte*       token;
+    int         ml = matchlen ? matchlen - MINMATCH : 0;
+
+    if (op >= end)
+        return NULL;
+    token = op++;
+    *token = (byte)(((litlen < 15 ? litlen : 15) << 4) | (ml < 15 ? ml : 15));
+
+    if (litlen >= 15 && !(op = LZ_PutLength (op, end, litlen - 15)))
+        return NULL;
+    if (end - op < litlen)
+        return NULL;
+    memcpy (op, lit, litlen);
+    op += litlen;
+
+    if (!matchlen)
+        return op;
+
+    if (end - op < 2)
+        return NULL;
+    *op++ = (byte)offset;
+    *op++ = (byte)(offset >> 8);
+    if (ml >= 15 && !(op = LZ_PutLength (op, end, ml - 15)))
+        return NULL;
+    return op;
+}
+
+//
+// LZ_Compress
+// Greedy parse, with one hash table entry per bucket.
+//
+int LZ_Compress (const byte* src, int size, byte* dest, int capacity)
+{
+    int         hashtab[1 << HASHBITS];
+    byte*       op = dest;
+    byte*       end = dest + capacity;
+    int         anchor = 0;
+    int         ip = 0;
+    int         i;
+
+    for (i = 0; i < (1 << HASHBITS); i++)
+        hashtab[i] = -1;
+
+    while (ip + MINMATCH <= size)
+    {
+        unsigned h = LZ_Hash (&src[ip]);
+        int ref = hashtab[h];
+        hashtab[h] = ip;
+
+        if (ref < 0 || ip - ref > MAXOFFSET
+            || memcmp (&src[ref], &src[ip], MINMATCH))
+        {
+            ip++;
+            continue;
+        }
+
+        int len = MINMATCH;
+        while (ip + len < size && src[ref + len] == src[ip + len])
+            len++;
+
+        op = LZ_PutSequence (op, end, &src[anchor], ip - anchor,
+                             ip - ref, len);
+        if (!op)
+            return 0;
+
+        // Keep the table fresh at the end of the match.
+        if (ip + len + MINMATCH <= size && len > 2)
+            hashtab[LZ_Hash (&src[ip + len - 2])] = ip + len - 2;
+
+        ip += len;
+        anchor = ip;
+    }
+
+    op = LZ_PutSequence (op, end, &src[anchor], size - anchor, 0, 0);
+    if (!op)
+        return 0;
+    return op - dest;
+}
+
+//
+// LZ_GetLength
+// Adds the extra bytes of a length, returns -1 past the end.
+//
+static int LZ_GetLength (const byte** ip, const byte* end, int len)
+{
+    byte        b;
+
+    do
+    {
+        if (*ip >= end)
+            return -1;
+        b = *(*ip)++;
+        len += b;
+    } while (b == 255);
+    return len;
+}
+
+//
+// LZ_Decompress
+//
+int LZ_Decompress (const byte* src, int csize, byte* dest, int size)
+{
+    const byte* ip = src;
+    const byte* iend = src + csize;
+    byte*       op = dest;
+    byte*       oend = dest + size;
+
+    while (ip < iend)
+    {
+        int token = *ip++;
+
+        // Literals.
+        int len = token >> 4;
+        if (len == 15 && (len = LZ_GetLength (&ip, iend, len)) < 0)
+            return -1;
+        if (iend - ip < len || oend - op < len)
+            return -1;
+        memcpy (op, ip, len);
+        ip += len;
+        op += len;
+
+        // The last sequence ends with its literals.
+        if (ip == iend)
+            break;
+
+        // Match.
+        if (iend - ip < 2)
+            return -1;
+        int offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        len = token & 15;
+        if (len == 15 && (len = LZ_GetLength (&ip, iend, len)) < 0)
+            return -1;
+        len += MINMATCH;
+        if (offset == 0 || offset > op - dest || oend - op < len)
+            return -1;
+
+        // The match may overlap the output, so copy byte by byte.
+        const byte* ref = op - offset;
+        while (len--)
+            *op++ = *ref++;
+    }
+
+    return op - dest;
+}
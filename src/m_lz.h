@@ -0,0 +1,36 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Simple LZ77 codec, used for compressed lumps.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __M_LZ__
+#define __M_LZ__
+
+#include "doomtype.h"
+
+// Compresses size bytes from src into dest, which can hold
+// capacity bytes. Returns the compressed size, or 0 if the
+// result would not fit.
+int LZ_Compress (const byte* src, int size, byte* dest, int capacity);
+
+// Decompresses csize bytes from src into dest, which can hold
+// size bytes. Returns the decompressed size, or -1 if the
+// data is corrupt.
+int LZ_Decompress (const byte* src, int csize, byte* dest, int size);
+
+#endif  // __M_LZ__
@@ -42,6 +42,7 @@
 #include "hu_stuff.h"
 
 #include "g_game.h"
+#include "p_saveg.h"
 
 #include "m_argv.h"
 #include "m_swap.h"
@@ -509,6 +510,9 @@ void M_ReadSaveStrings(void)
     int             i;
     char    name[256];
 
+    // A savegame may still be on its way to the disk.
+    P_WaitSave ();
+
     for (i = 0;i < load_end;i++)
     {
         if (M_CheckParm("-cdrom"))
@@ -742,12 +746,12 @@ void M_DrawReadThis1(void)
     switch ( gamemode )
     {
       case commercial:
-        V_DrawPatchScaled (0,0,0,W_CacheLumpName("HELP",PU_CACHE));
+        V_DrawPatchScaledNum (0,0,0,W_GetNumForName("HELP"));
         break;
       case shareware:
       case registered:
       case retail:
-        V_DrawPatchScaled (0,0,0,W_CacheLumpName("HELP1",PU_CACHE));
+        V_DrawPatchScaledNum (0,0,0,W_GetNumForName("HELP1"));
         break;
       default:
         break;
@@ -766,11 +770,11 @@ void M_DrawReadThis2(void)
       case retail:
       case commercial:
         // This hack keeps us from having to change menus.
-        V_DrawPatchScaled (0,0,0,W_CacheLumpName("CREDIT",PU_CACHE));
+        V_DrawPatchScaledNum (0,0,0,W_GetNumForName("CREDIT"));
         break;
       case shareware:
       case registered:
-        V_DrawPatchScaled (0,0,0,W_CacheLumpName("HELP2",PU_CACHE));
+        V_DrawPatchScaledNum (0,0,0,W_GetNumForName("HELP2"));
         break;
       default:
         break;
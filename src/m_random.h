@@ -29,6 +29,10 @@ int M_Random (void);
 // As M_Random, but used only by the play simulation.
 int P_Random (void);
 
+// Where M_Random and P_Random are in the table.
+extern int      rndindex;
+extern int      prndindex;
+
 // Fix randoms for demos.
 void M_ClearRandom (void);
 
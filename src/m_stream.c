@@ -0,0 +1,368 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Buffered file streams. Each stream has two buffers, one
+//      that is being filled or emptied by the game and one that
+//      is being written out or read ahead on a thread.
+//
+//-----------------------------------------------------------------------------
+
+// For pread.
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#define O_BINARY                0
+
+#ifndef MC1
+#include <pthread.h>
+#define STREAM_THREAD
+#endif
+
+#include "m_stream.h"
+
+#ifdef MC1
+#define STREAMBUFFERSIZE        0x1000
+#else
+#define STREAMBUFFERSIZE        0x4000
+#endif
+
+struct stream_s
+{
+    int         handle;
+    boolean     writing;
+    boolean     failed;
+
+    // The buffer the game uses and where it is in it.
+    byte*       buffers[2];
+    int         length;
+    int         current;
+    int         pos;
+
+    // File position of the next read and the bytes after it.
+    int         position;
+    int         left;
+
+    // The buffer the job works on, owned by it until it is done.
+    byte*       jobbuffer;
+    int         joblength;
+
+#ifdef STREAM_THREAD
+    pthread_t   thread;
+    boolean     running;
+#endif
+};
+
+
+//
+// M_StreamJob
+// Writes out the job buffer, or reads ahead into it.
+//
+static void M_StreamJob (stream_t* stream)
+{
+    int         size;
+    int         count;
+
+    if (stream->writing)
+    {
+        size = stream->joblength;
+        count = write (stream->handle, stream->jobbuffer, size);
+        if (count < size)
+            stream->failed = true;
+        return;
+    }
+
+    size = stream->left < STREAMBUFFERSIZE ? stream->left : STREAMBUFFERSIZE;
+#ifdef STREAM_THREAD
+    count = pread (stream->handle, stream->jobbuffer, size, stream->position);
+#else
+    lseek (stream->handle, stream->position, SEEK_SET);
+    count = read (stream->handle, stream->jobbuffer, size);
+#endif
+    if (count < size)
+    {
+        // treat a short read as the end of the stream
+        stream->failed = true;
+        stream->left = 0;
+        count = count < 0 ? 0 : count;
+    }
+    else
+        stream->left -= count;
+
+    stream->joblength = count;
+    stream->position += count;
+}
+
+#ifdef STREAM_THREAD
+static void* M_StreamThread (void* arg)
+{
+    M_StreamJob (arg);
+    return NULL;
+}
+#endif
+
+//
+// M_StartJob
+// Hands the current buffer to the writer,
+//  or the other one to the reader.
+//
+static void M_StartJob (stream_t* stream)
+{
+    if (stream->writing)
+    {
+        stream->jobbuffer = stream->buffers[stream->current];
+        stream->joblength = stream->pos;
+    }
+    else
+        stream->jobbuffer = stream->buffers[stream->current ^ 1];
+
+#ifdef STREAM_THREAD
+    stream->running =
+        !pthread_create (&stream->thread, NULL, M_StreamThread, stream);
+    if (!stream->running)
+#endif
+        M_StreamJob (stream);
+}
+
+static void M_WaitJob (stream_t* stream)
+{
+#ifdef STREAM_THREAD
+    if (stream->running)
+    {
+        pthread_join (stream->thread, NULL);
+        stream->running = false;
+    }
+#else
+    (void)stream;
+#endif
+}
+
+static stream_t* M_NewStream (int handle, boolean buffered)
+{
+    stream_t*   stream;
+
+    stream = calloc (1, sizeof(*stream));
+    if (!stream)
+        return NULL;
+
+    stream->handle = handle;
+    if (buffered)
+    {
+        stream->buffers[0] = malloc (2*STREAMBUFFERSIZE);
+        if (!stream->buffers[0])
+        {
+            free (stream);
+            return NULL;
+        }
+        stream->buffers[1] = stream->buffers[0] + STREAMBUFFERSIZE;
+    }
+    return stream;
+}
+
+static void M_FreeStream (stream_t* stream)
+{
+    if (stream->handle != -1)
+        free (stream->buffers[0]);
+    free (stream);
+}
+
+
+//
+// M_OpenWriteStream
+//
+stream_t* M_OpenWriteStream (const char* name)
+{
+    stream_t*   stream;
+    int         handle;
+
+    handle = open (name, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+    if (handle == -1)
+        return NULL;
+
+    stream = M_NewStream (handle, true);
+    if (!stream)
+    {
+        close (handle);
+        return NULL;
+    }
+    stream->writing = true;
+    return stream;
+}
+
+//
+// M_StreamWrite
+// A full buffer is handed to the writer, which has
+//  to be done with the one before it.
+//
+void
+M_StreamWrite
+( stream_t*     stream,
+  const void*   data,
+  int           size )
+{
+    const byte* src = data;
+    int         count;
+
+    while (size > 0)
+    {
+        count = STREAMBUFFERSIZE - stream->pos;
+        if (count > size)
+            count = size;
+        memcpy (stream->buffers[stream->current] + stream->pos, src, count);
+        stream->pos += count;
+        src += count;
+        size -= count;
+
+        if (stream->pos == STREAMBUFFERSIZE)
+        {
+            M_WaitJob (stream);
+            M_StartJob (stream);
+            stream->current ^= 1;
+            stream->pos = 0;
+        }
+    }
+}
+
+//
+// M_CloseWriteStream
+//
+boolean M_CloseWriteStream (stream_t* stream)
+{
+    boolean     ok;
+
+    M_WaitJob (stream);
+    if (stream->pos)
+    {
+        M_StartJob (stream);
+        M_WaitJob (stream);
+    }
+    if (close (stream->handle) == -1)
+        stream->failed = true;
+
+    ok = !stream->failed;
+    M_FreeStream (stream);
+    return ok;
+}
+
+
+//
+// M_OpenReadStream
+// The first buffer is read ahead like all the others.
+//
+stream_t*
+M_OpenReadStream
+( int           handle,
+  int           position,
+  int           length )
+{
+    stream_t*   stream;
+
+    stream = M_NewStream (handle, true);
+    if (!stream)
+        return NULL;
+
+    stream->position = position;
+    stream->left = length;
+    stream->current = 1;
+    M_StartJob (stream);
+    return stream;
+}
+
+//
+// M_OpenMemoryStream
+//
+stream_t*
+M_OpenMemoryStream
+( const void*   data,
+  int           length )
+{
+    stream_t*   stream;
+
+    stream = M_NewStream (-1, false);
+    if (!stream)
+        return NULL;
+
+    stream->buffers[0] = (byte*)data;
+    stream->length = length;
+    return stream;
+}
+
+//
+// M_NextBuffer
+// Switches to the buffer that was read ahead
+//  and starts reading the one after it.
+//
+static boolean M_NextBuffer (stream_t* stream)
+{
+    if (!stream->jobbuffer)
+        return false;
+
+    M_WaitJob (stream);
+    stream->jobbuffer = NULL;
+    if (!stream->joblength)
+        return false;
+
+    stream->length = stream->joblength;
+    stream->current ^= 1;
+    stream->pos = 0;
+    if (stream->left)
+        M_StartJob (stream);
+    return true;
+}
+
+//
+// M_StreamRead
+//
+int
+M_StreamRead
+( stream_t*     stream,
+  void*         dest,
+  int           size )
+{
+    byte*       dst = dest;
+    int         count;
+    int         done;
+
+    for (done = 0 ; done < size ; done += count)
+    {
+        count = stream->length - stream->pos;
+        if (!count)
+        {
+            if (!M_NextBuffer (stream))
+                break;
+            continue;
+        }
+        if (count > size - done)
+            count = size - done;
+        memcpy (dst + done, stream->buffers[stream->current] + stream->pos,
+                count);
+        stream->pos += count;
+    }
+
+    return done;
+}
+
+//
+// M_CloseReadStream
+//
+void M_CloseReadStream (stream_t* stream)
+{
+    M_WaitJob (stream);
+    M_FreeStream (stream);
+}
@@ -0,0 +1,50 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Buffered file streams of constant size, written out
+//      and read ahead in the background.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __M_STREAM__
+#define __M_STREAM__
+
+#include "doomtype.h"
+
+typedef struct stream_s stream_t;
+
+// Creates the file, NULL if it can not be opened.
+stream_t*       M_OpenWriteStream (const char* name);
+
+void            M_StreamWrite (stream_t* stream, const void* data, int size);
+
+// Writes out what is left and closes the file.
+// Returns false if any of the writes failed.
+boolean         M_CloseWriteStream (stream_t* stream);
+
+// Reads length bytes from position in an open file,
+//  the handle is left open when the stream is closed.
+stream_t*       M_OpenReadStream (int handle, int position, int length);
+
+// Reads from a block that is already in memory.
+stream_t*       M_OpenMemoryStream (const void* data, int length);
+
+// Returns the number of bytes read, less than size at the end.
+int             M_StreamRead (stream_t* stream, void* dest, int size);
+
+void            M_CloseReadStream (stream_t* stream);
+
+#endif  // __M_STREAM__
@@ -34,7 +34,7 @@
 // CEILINGS
 //
 
-ceiling_t*      activeceilings[MAXCEILINGS];
+ceiling_t*      activeceilings[ACTIVEHASHSIZE];
 
 //
 // T_MoveCeiling
@@ -194,7 +194,7 @@ EV_DoCeiling
         // new door thinker
         rtn = 1;
         ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVSPEC, 0);
-        P_AddThinker (&ceiling->thinker);
+        P_AddThinker (&ceiling->thinker, th_mover);
         sec->specialdata = ceiling;
         ceiling->thinker.function.acp1 = (actionf_p1)T_MoveCeiling;
         ceiling->sector = sec;
@@ -243,35 +243,49 @@ EV_DoCeiling
 //
 void P_AddActiveCeiling(ceiling_t* c)
 {
-    int         i;
-
-    for (i = 0; i < MAXCEILINGS;i++)
-    {
-        if (activeceilings[i] == NULL)
-        {
-            activeceilings[i] = c;
-            return;
-        }
-    }
+    ceiling_t** head;
+
+    head = &activeceilings[ACTIVEHASH(c->tag)];
+    c->activenext = *head;
+    c->activeprev = head;
+    if (*head)
+        (*head)->activeprev = &c->activenext;
+    *head = c;
 }
 
 //
 // Remove a ceiling's thinker
 //
 void P_RemoveActiveCeiling(ceiling_t* c)
+{
+    if (!c->activeprev)
+        return;
+
+    c->sector->specialdata = NULL;
+    P_RemoveThinker (&c->thinker);
+
+    *c->activeprev = c->activenext;
+    if (c->activenext)
+        c->activenext->activeprev = c->activeprev;
+    c->activeprev = NULL;
+}
+
+//
+// P_IsActiveCeiling
+// Used by the savegame code to tell ceilings
+// in stasis from other halted thinkers.
+//
+boolean P_IsActiveCeiling(thinker_t* th)
 {
     int         i;
+    ceiling_t*  c;
 
-    for (i = 0;i < MAXCEILINGS;i++)
-    {
-        if (activeceilings[i] == c)
-        {
-            activeceilings[i]->sector->specialdata = NULL;
-            P_RemoveThinker (&activeceilings[i]->thinker);
-            activeceilings[i] = NULL;
-            break;
-        }
-    }
+    for (i = 0;i < ACTIVEHASHSIZE;i++)
+        for (c = activeceilings[i] ; c ; c = c->activenext)
+            if (&c->thinker == th)
+                return true;
+
+    return false;
 }
 
 //
@@ -279,16 +293,15 @@ void P_RemoveActiveCeiling(ceiling_t* c)
 //
 void P_ActivateInStasisCeiling(line_t* line)
 {
-    int         i;
+    ceiling_t*  c;
 
-    for (i = 0;i < MAXCEILINGS;i++)
+    for (c = activeceilings[ACTIVEHASH(line->tag)] ; c ; c = c->activenext)
     {
-        if (activeceilings[i]
-            && (activeceilings[i]->tag == line->tag)
-            && (activeceilings[i]->direction == 0))
+        if (c->tag == line->tag
+            && c->direction == 0)
         {
-            activeceilings[i]->direction = activeceilings[i]->olddirection;
-            activeceilings[i]->thinker.function.acp1
+            c->direction = c->olddirection;
+            c->thinker.function.acp1
               = (actionf_p1)T_MoveCeiling;
         }
     }
@@ -300,19 +313,18 @@ void P_ActivateInStasisCeiling(line_t* line)
 //
 int     EV_CeilingCrushStop(line_t      *line)
 {
-    int         i;
     int         rtn;
+    ceiling_t*  c;
 
     rtn = 0;
-    for (i = 0;i < MAXCEILINGS;i++)
+    for (c = activeceilings[ACTIVEHASH(line->tag)] ; c ; c = c->activenext)
     {
-        if (activeceilings[i]
-            && (activeceilings[i]->tag == line->tag)
-            && (activeceilings[i]->direction != 0))
+        if (c->tag == line->tag
+            && c->direction != 0)
         {
-            activeceilings[i]->olddirection = activeceilings[i]->direction;
-            activeceilings[i]->thinker.function.acv = (actionf_v)NULL;
-            activeceilings[i]->direction = 0;           // in-stasis
+            c->olddirection = c->direction;
+            c->thinker.function.acv = (actionf_v)NULL;
+            c->direction = 0;           // in-stasis
             rtn = 1;
         }
     }
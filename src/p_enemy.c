@@ -93,7 +93,11 @@ P_RecursiveSound
 {
     int         i;
     line_t*     check;
+    sector_t*   front;
+    sector_t*   back;
     sector_t*   other;
+    fixed_t     top;
+    fixed_t     bottom;
 
     // wake up all monsters in this sector
     if (sec->validcount == validcount
@@ -106,21 +110,30 @@ P_RecursiveSound
     sec->soundtraversed = soundblocks+1;
     sec->soundtarget = soundtarget;
 
-    for (i=0 ;i<sec->linecount ; i++)
+    for (i=0 ;i<sec->soundlinecount ; i++)
     {
-        check = sec->lines[i];
-        if (! (check->flags & ML_TWOSIDED) )
-            continue;
+        check = sec->soundlines[i];
+        front = check->frontsector;
+        back = check->backsector;
 
-        P_LineOpening (check);
+        // Same test as P_LineOpening, but only redone
+        // after one of the sectors has moved.
+        if (check->soundopen < 0)
+        {
+            top = front->ceilingheight < back->ceilingheight ?
+                  front->ceilingheight : back->ceilingheight;
+            bottom = front->floorheight > back->floorheight ?
+                     front->floorheight : back->floorheight;
+            check->soundopen = top - bottom > 0;
+        }
 
-        if (openrange <= 0)
+        if (!check->soundopen)
             continue;   // closed door
 
-        if ( sides[ check->sidenum[0] ].sector == sec)
-            other = sides[ check->sidenum[1] ] .sector;
+        if (front == sec)
+            other = back;
         else
-            other = sides[ check->sidenum[0] ].sector;
+            other = front;
 
         if (check->flags & ML_SOUNDBLOCK)
         {
@@ -132,6 +145,19 @@ P_RecursiveSound
     }
 }
 
+//
+// P_SectorMoved
+// Called when the floor or ceiling of a sector
+// moves, to invalidate the cached sound openings.
+//
+void P_SectorMoved (sector_t* sec)
+{
+    int         i;
+
+    for (i=0 ;i<sec->soundlinecount ; i++)
+        sec->soundlines[i]->soundopen = -1;
+}
+
 //
 // P_NoiseAlert
 // If a monster yells at a player,
@@ -538,11 +564,10 @@ void A_KeenDie (mobj_t* mo)
 
     // scan the remaining thinkers
     // to see if all Keens are dead
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    for (th = thinkerclasscap[th_mobj].cnext ;
+         th != &thinkerclasscap[th_mobj] ;
+         th=th->cnext)
     {
-        if (th->function.acp1 != (actionf_p1)P_MobjThinker)
-            continue;
-
         mo2 = (mobj_t *)th;
         if (mo2 != mo
             && mo2->type == mo->type
@@ -1399,13 +1424,12 @@ A_PainShootSkull
     // count total number of skull currently on the level
     count = 0;
 
-    currentthinker = thinkercap.next;
-    while (currentthinker != &thinkercap)
+    currentthinker = thinkerclasscap[th_mobj].cnext;
+    while (currentthinker != &thinkerclasscap[th_mobj])
     {
-        if (   (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
-            && ((mobj_t *)currentthinker)->type == MT_SKULL)
+        if (((mobj_t *)currentthinker)->type == MT_SKULL)
             count++;
-        currentthinker = currentthinker->next;
+        currentthinker = currentthinker->cnext;
     }
 
     // if there are allready 20 skulls on the level,
@@ -1610,11 +1634,10 @@ void A_BossDeath (mobj_t* mo)
 
     // scan the remaining thinkers to see
     // if all bosses are dead
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    for (th = thinkerclasscap[th_mobj].cnext ;
+         th != &thinkerclasscap[th_mobj] ;
+         th=th->cnext)
     {
-        if (th->function.acp1 != (actionf_p1)P_MobjThinker)
-            continue;
-
         mo2 = (mobj_t *)th;
         if (mo2 != mo
             && mo2->type == mo->type
@@ -1746,14 +1769,10 @@ void A_BrainAwake (mobj_t* mo)
     numbraintargets = 0;
     braintargeton = 0;
 
-    thinker = thinkercap.next;
-    for (thinker = thinkercap.next ;
-         thinker != &thinkercap ;
-         thinker = thinker->next)
+    for (thinker = thinkerclasscap[th_mobj].cnext ;
+         thinker != &thinkerclasscap[th_mobj] ;
+         thinker = thinker->cnext)
     {
-        if (thinker->function.acp1 != (actionf_p1)P_MobjThinker)
-            continue;   // not a mobj
-
         m = (mobj_t *)thinker;
 
         if (m->type == MT_BOSSTARGET )
@@ -49,6 +49,9 @@ T_MovePlane
     boolean     flag;
     fixed_t     lastpos;
 
+    // the openings to the surrounding sectors change
+    P_SectorMoved (sector);
+
     switch(floorOrCeiling)
     {
       case 0:
@@ -271,7 +274,7 @@ EV_DoFloor
         // new floor thinker
         rtn = 1;
         floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
-        P_AddThinker (&floor->thinker);
+        P_AddThinker (&floor->thinker, th_mover);
         sec->specialdata = floor;
         floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
         floor->type = floortype;
@@ -472,7 +475,7 @@ EV_BuildStairs
         // new floor thinker
         rtn = 1;
         floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
-        P_AddThinker (&floor->thinker);
+        P_AddThinker (&floor->thinker, th_mover);
         sec->specialdata = floor;
         floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
         floor->direction = 1;
@@ -527,7 +530,7 @@ EV_BuildStairs
                 secnum = newsecnum;
                 floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
 
-                P_AddThinker (&floor->thinker);
+                P_AddThinker (&floor->thinker, th_mover);
 
                 sec->specialdata = floor;
                 floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
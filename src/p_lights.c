@@ -65,7 +65,7 @@ void P_SpawnFireFlicker (sector_t*      sector)
 
     flick = Z_Malloc ( sizeof(*flick), PU_LEVSPEC, 0);
 
-    P_AddThinker (&flick->thinker);
+    P_AddThinker (&flick->thinker, th_light);
 
     flick->thinker.function.acp1 = (actionf_p1) T_FireFlicker;
     flick->sector = sector;
@@ -114,7 +114,7 @@ void P_SpawnLightFlash (sector_t*       sector)
 
     flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
 
-    P_AddThinker (&flash->thinker);
+    P_AddThinker (&flash->thinker, th_light);
 
     flash->thinker.function.acp1 = (actionf_p1) T_LightFlash;
     flash->sector = sector;
@@ -166,7 +166,7 @@ P_SpawnStrobeFlash
 
     flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
 
-    P_AddThinker (&flash->thinker);
+    P_AddThinker (&flash->thinker, th_light);
 
     flash->sector = sector;
     flash->darktime = fastOrSlow;
@@ -216,26 +216,19 @@ void EV_TurnTagLightsOff(line_t* line)
     int                 min;
     sector_t*           sector;
     sector_t*           tsec;
-    line_t*             templine;
 
-    sector = sectors;
-
-    for (j = 0;j < numsectors; j++, sector++)
+    j = -1;
+    while ((j = P_FindSectorFromLineTag(line,j)) >= 0)
     {
-        if (sector->tag == line->tag)
+        sector = &sectors[j];
+        min = sector->lightlevel;
+        for (i = 0;i < sector->neighbourcount; i++)
         {
-            min = sector->lightlevel;
-            for (i = 0;i < sector->linecount; i++)
-            {
-                templine = sector->lines[i];
-                tsec = getNextSector(templine,sector);
-                if (!tsec)
-                    continue;
-                if (tsec->lightlevel < min)
-                    min = tsec->lightlevel;
-            }
-            sector->lightlevel = min;
+            tsec = sector->neighbours[i];
+            if (tsec->lightlevel < min)
+                min = tsec->lightlevel;
         }
+        sector->lightlevel = min;
     }
 }
 
@@ -251,33 +244,26 @@ EV_LightTurnOn
     int         j;
     sector_t*   sector;
     sector_t*   temp;
-    line_t*     templine;
 
-    sector = sectors;
-
-    for (i=0;i<numsectors;i++, sector++)
+    i = -1;
+    while ((i = P_FindSectorFromLineTag(line,i)) >= 0)
     {
-        if (sector->tag == line->tag)
+        sector = &sectors[i];
+
+        // bright = 0 means to search
+        // for highest light level
+        // surrounding sector
+        if (!bright)
         {
-            // bright = 0 means to search
-            // for highest light level
-            // surrounding sector
-            if (!bright)
+            for (j = 0;j < sector->neighbourcount; j++)
             {
-                for (j = 0;j < sector->linecount; j++)
-                {
-                    templine = sector->lines[j];
-                    temp = getNextSector(templine,sector);
-
-                    if (!temp)
-                        continue;
+                temp = sector->neighbours[j];
 
-                    if (temp->lightlevel > bright)
-                        bright = temp->lightlevel;
-                }
+                if (temp->lightlevel > bright)
+                    bright = temp->lightlevel;
             }
-            sector-> lightlevel = bright;
         }
+        sector-> lightlevel = bright;
     }
 }
 
@@ -317,7 +303,7 @@ void P_SpawnGlowingLight(sector_t*      sector)
 
     g = Z_Malloc( sizeof(*g), PU_LEVSPEC, 0);
 
-    P_AddThinker(&g->thinker);
+    P_AddThinker(&g->thinker, th_light);
 
     g->sector = sector;
     g->minlight = P_FindMinSurroundingLight(sector,sector->lightlevel);
@@ -63,9 +63,13 @@
 // both the head and tail of the thinker list
 extern  thinker_t       thinkercap;
 
+// both the head and tail of the per class thinker lists
+extern  thinker_t       thinkerclasscap[NUMTHCLASSES];
+
 void P_InitThinkers (void);
-void P_AddThinker (thinker_t* thinker);
+void P_AddThinker (thinker_t* thinker, thclass_t tclass);
 void P_RemoveThinker (thinker_t* thinker);
+void P_StoreOldState (void);
 
 //
 // P_PSPR
@@ -115,6 +119,7 @@ void    P_SpawnPlayerMissile (mobj_t* source, mobjtype_t type);
 // P_ENEMY
 //
 void P_NoiseAlert (mobj_t* target, mobj_t* emmiter);
+void P_SectorMoved (sector_t* sec);
 
 //
 // P_MAPUTL
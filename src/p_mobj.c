@@ -511,9 +511,14 @@ P_SpawnMobj
     else
         mobj->z = z;
 
+    mobj->oldx = mobj->x;
+    mobj->oldy = mobj->y;
+    mobj->oldz = mobj->z;
+    mobj->oldangle = mobj->angle;
+
     mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
 
-    P_AddThinker (&mobj->thinker);
+    P_AddThinker (&mobj->thinker, th_mobj);
 
     return mobj;
 }
@@ -272,6 +272,12 @@ typedef struct mobj_s
     // Thing being chased/attacked for tracers.
     struct mobj_s*      tracer;
 
+    // Position at the start of the tic, for render interpolation.
+    fixed_t             oldx;
+    fixed_t             oldy;
+    fixed_t             oldz;
+    angle_t             oldangle;
+
 } mobj_t;
 
 #endif  // __P_MOBJ__
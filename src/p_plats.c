@@ -34,7 +34,7 @@
 // Data.
 #include "sounds.h"
 
-plat_t*         activeplats[MAXPLATS];
+plat_t*         activeplats[ACTIVEHASHSIZE];
 
 //
 // Move a plat up and down
@@ -158,7 +158,7 @@ EV_DoPlat
         // Find lowest & highest floors around sector
         rtn = 1;
         plat = Z_Malloc( sizeof(*plat), PU_LEVSPEC, 0);
-        P_AddThinker(&plat->thinker);
+        P_AddThinker(&plat->thinker, th_mover);
 
         plat->type = type;
         plat->sector = sec;
@@ -242,58 +242,74 @@ EV_DoPlat
 
 void P_ActivateInStasis(int tag)
 {
-    int         i;
+    plat_t*     plat;
 
-    for (i = 0;i < MAXPLATS;i++)
-        if (activeplats[i]
-            && (activeplats[i])->tag == tag
-            && (activeplats[i])->status == in_stasis)
+    for (plat = activeplats[ACTIVEHASH(tag)] ; plat ; plat = plat->activenext)
+        if (plat->tag == tag
+            && plat->status == in_stasis)
         {
-            (activeplats[i])->status = (activeplats[i])->oldstatus;
-            (activeplats[i])->thinker.function.acp1
+            plat->status = plat->oldstatus;
+            plat->thinker.function.acp1
               = (actionf_p1) T_PlatRaise;
         }
 }
 
 void EV_StopPlat(line_t* line)
 {
-    int         j;
+    plat_t*     plat;
 
-    for (j = 0;j < MAXPLATS;j++)
-        if (activeplats[j]
-            && ((activeplats[j])->status != in_stasis)
-            && ((activeplats[j])->tag == line->tag))
+    for (plat = activeplats[ACTIVEHASH(line->tag)] ;
+         plat ;
+         plat = plat->activenext)
+        if (plat->status != in_stasis
+            && plat->tag == line->tag)
         {
-            (activeplats[j])->oldstatus = (activeplats[j])->status;
-            (activeplats[j])->status = in_stasis;
-            (activeplats[j])->thinker.function.acv = (actionf_v)NULL;
+            plat->oldstatus = plat->status;
+            plat->status = in_stasis;
+            plat->thinker.function.acv = (actionf_v)NULL;
         }
 }
 
 void P_AddActivePlat(plat_t* plat)
 {
-    int         i;
-
-    for (i = 0;i < MAXPLATS;i++)
-        if (activeplats[i] == NULL)
-        {
-            activeplats[i] = plat;
-            return;
-        }
-    I_Error ("P_AddActivePlat: no more plats!");
+    plat_t**    head;
+
+    head = &activeplats[ACTIVEHASH(plat->tag)];
+    plat->activenext = *head;
+    plat->activeprev = head;
+    if (*head)
+        (*head)->activeprev = &plat->activenext;
+    *head = plat;
 }
 
 void P_RemoveActivePlat(plat_t* plat)
+{
+    if (!plat->activeprev)
+        I_Error ("P_RemoveActivePlat: can't find plat!");
+
+    plat->sector->specialdata = NULL;
+    P_RemoveThinker(&plat->thinker);
+
+    *plat->activeprev = plat->activenext;
+    if (plat->activenext)
+        plat->activenext->activeprev = plat->activeprev;
+    plat->activeprev = NULL;
+}
+
+//
+// P_IsActivePlat
+// Used by the savegame code to tell plats
+// in stasis from other halted thinkers.
+//
+boolean P_IsActivePlat(thinker_t* th)
 {
     int         i;
-    for (i = 0;i < MAXPLATS;i++)
-        if (plat == activeplats[i])
-        {
-            (activeplats[i])->sector->specialdata = NULL;
-            P_RemoveThinker(&(activeplats[i])->thinker);
-            activeplats[i] = NULL;
+    plat_t*     p;
 
-            return;
-        }
-    I_Error ("P_RemoveActivePlat: can't find plat!");
+    for (i = 0;i < ACTIVEHASHSIZE;i++)
+        for (p = activeplats[i] ; p ; p = p->activenext)
+            if (&p->thinker == th)
+                return true;
+
+    return false;
 }
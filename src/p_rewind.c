@@ -0,0 +1,1078 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Ring of game state snapshots.
+//      Every few tics the level is archived the way a savegame
+//      is, XORed with the last snapshot and compressed into a
+//      fixed arena. The oldest snapshots make way for new ones.
+//
+//-----------------------------------------------------------------------------
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_lz.h"
+#include "m_random.h"
+#include "p_local.h"
+#include "p_saveg.h"
+#include "p_spec.h"
+#include "r_state.h"
+
+#include "p_rewind.h"
+
+// On MC1 the snapshots cost too much time and memory
+//  to be taken unless asked for with -rewind.
+#ifdef MC1
+#define DEFAULT_REWIND_TICS     0
+#define DEFAULT_REWIND_KB       256
+#else
+#define DEFAULT_REWIND_TICS     TICRATE
+#define DEFAULT_REWIND_KB       4096
+#endif
+
+#define MAXSNAPSHOTS            256
+
+// Every so many snapshots one is kept whole, so that
+//  the others can be rebuilt from it.
+#define KEYFRAMEINTERVAL        16
+
+// The most differences P_DiffSnapshots lists for things.
+#define MAXDIFFLINES            16
+
+// Starts every snapshot, before the archived level.
+typedef struct
+{
+    int         leveltime;
+    int         prndindex;
+    int         rndindex;
+    int         episode;
+    int         map;
+
+    // Offsets of the parts of the snapshot.
+    int         players;
+    int         world;
+    int         thinkers;
+    int         specials;
+    int         extras;
+    int         end;
+
+} rewindheader_t;
+
+typedef struct
+{
+    int         tic;
+    int         offset;         // in the arena
+    int         csize;          // compressed
+    int         size;
+    boolean     keyframe;
+
+} snapshot_t;
+
+// Oldest first, the oldest is always a keyframe.
+static snapshot_t snapshots[MAXSNAPSHOTS];
+static int      firstsnap;
+static int      numsnaps;
+
+#define SNAP(i) (&snapshots[(firstsnap + (i)) % MAXSNAPSHOTS])
+
+static byte*    arena;
+static int      arenasize;
+static int      arenahead;
+
+// 0 when there are no snapshots.
+static int      rewindtics;
+static int      sincekey;
+
+// The newest snapshot, which the next one is XORed with.
+static byte*    lastimage;
+static int      lastsize;
+static int      lastcapacity;
+
+static byte*    deltabuffer;
+static int      deltacapacity;
+static byte*    packbuffer;
+static int      packcapacity;
+static byte*    imagebuffer;
+static int      imagecapacity;
+static byte*    otherbuffer;
+static int      othercapacity;
+static byte*    refbuffer;
+static int      refcapacity;
+static byte*    listbuffer;
+static int      listcapacity;
+
+// For the report at the end of the level.
+static int      statsnaps;
+static int      statkeys;
+static int      statdropped;
+static long long stattime;
+static long long statbytes;
+static long long statkeybytes;
+static long long statrawbytes;
+static int      stattics;
+
+//
+// P_InitRewind
+//
+void P_InitRewind (void)
+{
+    int         p;
+    int         kb;
+
+    rewindtics = DEFAULT_REWIND_TICS;
+    p = M_CheckParm ("-rewind");
+    if (p && p < myargc-1)
+        rewindtics = atoi (myargv[p+1]);
+
+    kb = DEFAULT_REWIND_KB;
+    p = M_CheckParm ("-rewindmem");
+    if (p && p < myargc-1)
+        kb = atoi (myargv[p+1]);
+
+    if (rewindtics <= 0 || kb <= 0)
+    {
+        rewindtics = 0;
+        return;
+    }
+
+    arenasize = kb * 1024;
+    arena = malloc (arenasize);
+    if (!arena)
+    {
+        fprintf (stderr, "P_InitRewind: no memory for snapshots\n");
+        rewindtics = 0;
+    }
+}
+
+//
+// P_GrowBuffer
+//
+static void P_GrowBuffer (byte** buffer, int* capacity, int size)
+{
+    if (*capacity >= size)
+        return;
+
+    *buffer = realloc (*buffer, size);
+    if (!*buffer)
+        I_Error ("P_GrowBuffer: couldn't allocate %d bytes", size);
+    *capacity = size;
+}
+
+//
+// P_ClearRewind
+//
+void P_ClearRewind (void)
+{
+    if (statsnaps && devparm)
+    {
+        fprintf (stderr,
+                 "P_ClearRewind: %d snapshots every %d tics, "
+                 "%.1f us each, %.1f us per tic\n",
+                 statsnaps, rewindtics,
+                 (double)stattime / statsnaps,
+                 (double)stattime / stattics);
+        fprintf (stderr,
+                 "P_ClearRewind: %lld bytes per snapshot from %lld, "
+                 "keyframes %lld, %d of %d KB hold %d",
+                 statbytes / statsnaps,
+                 statrawbytes / statsnaps,
+                 statkeys ? statkeybytes / statkeys : 0,
+                 arenahead / 1024,
+                 arenasize / 1024,
+                 numsnaps);
+        if (statdropped)
+            fprintf (stderr, ", %d too big", statdropped);
+        fprintf (stderr, "\n");
+    }
+
+    firstsnap = 0;
+    numsnaps = 0;
+    arenahead = 0;
+    lastsize = 0;
+    sincekey = 0;
+
+    statsnaps = 0;
+    statkeys = 0;
+    statdropped = 0;
+    stattime = 0;
+    statbytes = 0;
+    statkeybytes = 0;
+    statrawbytes = 0;
+    stattics = 0;
+}
+
+//
+// P_PackSnapshot
+// Compresses an image into packbuffer, XORed with the
+//  last one unless it is a keyframe. Returns the size.
+//
+static int P_PackSnapshot (byte* image, int size, boolean keyframe)
+{
+    byte*       src;
+    int         bound;
+    int         i;
+
+    src = image;
+    if (!keyframe)
+    {
+        P_GrowBuffer (&deltabuffer, &deltacapacity, size);
+        for (i=0 ; i<size && i<lastsize ; i++)
+            deltabuffer[i] = image[i] ^ lastimage[i];
+        if (i < size)
+            memcpy (deltabuffer+i, image+i, size-i);
+        src = deltabuffer;
+    }
+
+    bound = size + size/255 + 16;
+    P_GrowBuffer (&packbuffer, &packcapacity, bound);
+    return LZ_Compress (src, size, packbuffer, bound);
+}
+
+//
+// P_DropSnapshot
+// Drops the oldest snapshot and those that are built on it.
+//
+static void P_DropSnapshot (void)
+{
+    do
+    {
+        firstsnap = (firstsnap + 1) % MAXSNAPSHOTS;
+        numsnaps--;
+    } while (numsnaps && !SNAP(0)->keyframe);
+}
+
+//
+// P_AllocSnapshot
+// Makes room for size bytes after the newest snapshot.
+//
+static int P_AllocSnapshot (int size)
+{
+    snapshot_t* s;
+
+    if (numsnaps == MAXSNAPSHOTS)
+        P_DropSnapshot ();
+
+    if (arenahead + size > arenasize)
+    {
+        // Those past the head are the oldest ones.
+        while (numsnaps && SNAP(0)->offset >= arenahead)
+            P_DropSnapshot ();
+        arenahead = 0;
+    }
+
+    while (numsnaps)
+    {
+        s = SNAP(0);
+        if (s->offset >= arenahead + size
+            || s->offset + s->csize <= arenahead)
+            break;
+        P_DropSnapshot ();
+    }
+
+    return arenahead;
+}
+
+//
+// REWIND EXTRAS
+// What a savegame leaves out, but a rewind needs to carry on
+//  the same as before: the plane heights to the fraction, what
+//  the things are after, the order of the thing chains and the
+//  order that the thinkers run in.
+//
+typedef struct
+{
+    mobj_t*     mobj;
+    int         index;
+
+} mobjref_t;
+
+static mobjref_t* mobjrefs;
+static int      nummobjrefs;
+
+#define PADPTR(p)       ((p) + ((4 - ((uintptr_t)(p) & 3)) & 3))
+
+static int P_CompareMobjRefs (const void* a, const void* b)
+{
+    uintptr_t   ma;
+    uintptr_t   mb;
+
+    ma = (uintptr_t)((const mobjref_t *)a)->mobj;
+    mb = (uintptr_t)((const mobjref_t *)b)->mobj;
+    return ma < mb ? -1 : ma > mb;
+}
+
+//
+// P_MobjRef
+// Number of a thing in the thing list plus one, 0 for none.
+//
+static int P_MobjRef (mobj_t* mobj)
+{
+    mobjref_t   key;
+    mobjref_t*  ref;
+
+    if (!mobj)
+        return 0;
+
+    key.mobj = mobj;
+    ref = bsearch (&key, mobjrefs, nummobjrefs, sizeof(*ref),
+                   P_CompareMobjRefs);
+    return ref ? ref->index + 1 : 0;
+}
+
+//
+// P_ArchiveExtras
+//
+static void P_ArchiveExtras (void)
+{
+    thinker_t*  th;
+    mobj_t*     mobj;
+    sector_t*   sec;
+    byte*       order;
+    int*        put;
+    int         numthinkers;
+    int         count;
+    int         i;
+
+    count = 0;
+    for (th = thinkerclasscap[th_mobj].cnext ;
+         th != &thinkerclasscap[th_mobj] ;
+         th = th->cnext)
+        count++;
+
+    numthinkers = 0;
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+        numthinkers++;
+
+    P_GrowBuffer (&refbuffer, &refcapacity, count * sizeof(mobjref_t));
+    mobjrefs = (mobjref_t *)refbuffer;
+    nummobjrefs = count;
+
+    i = 0;
+    for (th = thinkerclasscap[th_mobj].cnext ;
+         th != &thinkerclasscap[th_mobj] ;
+         th = th->cnext, i++)
+    {
+        mobjrefs[i].mobj = (mobj_t *)th;
+        mobjrefs[i].index = i;
+    }
+    qsort (mobjrefs, count, sizeof(*mobjrefs), P_CompareMobjRefs);
+
+    P_SaveReserve (3 + 4*(numsectors*3 + MAXPLAYERS + count*6 + 2)
+                   + numthinkers);
+    save_p = PADPTR(save_p);
+    put = (int *)save_p;
+
+    for (i=0, sec = sectors ; i<numsectors ; i++, sec++)
+    {
+        *put++ = sec->floorheight;
+        *put++ = sec->ceilingheight;
+        *put++ = P_MobjRef (sec->soundtarget);
+    }
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+        *put++ = playeringame[i] ? P_MobjRef (players[i].attacker) : 0;
+
+    *put++ = count;
+    for (th = thinkerclasscap[th_mobj].cnext ;
+         th != &thinkerclasscap[th_mobj] ;
+         th = th->cnext)
+    {
+        mobj = (mobj_t *)th;
+        *put++ = mobj->floorz;
+        *put++ = mobj->ceilingz;
+        *put++ = P_MobjRef (mobj->target);
+        *put++ = P_MobjRef (mobj->tracer);
+        *put++ = mobj->flags & MF_NOSECTOR ? 0 : P_MobjRef (mobj->snext);
+        *put++ = mobj->flags & MF_NOBLOCKMAP ? 0 : P_MobjRef (mobj->bnext);
+    }
+
+    // 1 for a thing, 0 for a special.
+    order = (byte *)(put + 1);
+    numthinkers = 0;
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+    {
+        if (th->function.acp1 == (actionf_p1)P_MobjThinker)
+            order[numthinkers++] = 1;
+        else if (P_IsArchivedSpecial (th))
+            order[numthinkers++] = 0;
+    }
+    *put = numthinkers;
+
+    save_p = order + numthinkers;
+}
+
+//
+// P_RestoreHeights
+// Puts back the plane heights that P_UnArchiveWorld rounds.
+//
+static void P_RestoreHeights (byte* extras)
+{
+    sector_t*   sec;
+    int*        get;
+    int         i;
+
+    get = (int *)extras;
+    for (i=0, sec = sectors ; i<numsectors ; i++, sec++)
+    {
+        sec->floorheight = get[0];
+        sec->ceilingheight = get[1];
+        get += 3;
+    }
+}
+
+//
+// P_UnArchiveExtras
+// Called after the rest of the snapshot is unarchived.
+//
+static void P_UnArchiveExtras (byte* extras)
+{
+    thinker_t*  th;
+    thinker_t*  prev;
+    thinker_t** specials;
+    mobj_t**    mobjs;
+    mobj_t*     mobj;
+    sector_t*   sec;
+    byte*       order;
+    int*        get;
+    int         numspecials;
+    int         numthinkers;
+    int         count;
+    int         blockx;
+    int         blocky;
+    int         i;
+    int         m;
+    int         s;
+
+    count = 0;
+    for (th = thinkerclasscap[th_mobj].cnext ;
+         th != &thinkerclasscap[th_mobj] ;
+         th = th->cnext)
+        count++;
+
+    numspecials = 0;
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+        if (th->function.acp1 != (actionf_p1)P_MobjThinker)
+            numspecials++;
+
+    P_GrowBuffer (&listbuffer, &listcapacity,
+                  (count + 1 + numspecials) * sizeof(void *));
+    mobjs = (mobj_t **)listbuffer;
+    specials = (thinker_t **)(mobjs + count + 1);
+
+    // Refs are one based.
+    mobjs[0] = NULL;
+    i = 1;
+    for (th = thinkerclasscap[th_mobj].cnext ;
+         th != &thinkerclasscap[th_mobj] ;
+         th = th->cnext)
+        mobjs[i++] = (mobj_t *)th;
+
+    i = 0;
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+        if (th->function.acp1 != (actionf_p1)P_MobjThinker)
+            specials[i++] = th;
+
+    get = (int *)extras;
+    for (i=0, sec = sectors ; i<numsectors ; i++, sec++)
+    {
+        sec->soundtarget = mobjs[get[2]];
+        get += 3;
+    }
+
+    for (i=0 ; i<MAXPLAYERS ; i++, get++)
+        if (playeringame[i])
+            players[i].attacker = mobjs[*get];
+
+    if (*get++ != count)
+        I_Error ("P_UnArchiveExtras: %d things, not %d", count, get[-1]);
+
+    for (i=1 ; i<=count ; i++, get += 6)
+    {
+        mobj = mobjs[i];
+        mobj->floorz = get[0];
+        mobj->ceilingz = get[1];
+        mobj->target = mobjs[get[2]];
+        mobj->tracer = mobjs[get[3]];
+        mobj->snext = mobjs[get[4]];
+        mobj->bnext = mobjs[get[5]];
+        mobj->sprev = NULL;
+        mobj->bprev = NULL;
+    }
+
+    // Link the thing chains in the same order as before.
+    for (i=1 ; i<=count ; i++)
+    {
+        mobj = mobjs[i];
+        if (mobj->snext)
+            mobj->snext->sprev = mobj;
+        if (mobj->bnext)
+            mobj->bnext->bprev = mobj;
+    }
+
+    for (i=1 ; i<=count ; i++)
+    {
+        mobj = mobjs[i];
+        if (!(mobj->flags & MF_NOSECTOR) && !mobj->sprev)
+            mobj->subsector->sector->thinglist = mobj;
+
+        if (!(mobj->flags & MF_NOBLOCKMAP) && !mobj->bprev)
+        {
+            blockx = (mobj->x - bmaporgx)>>MAPBLOCKSHIFT;
+            blocky = (mobj->y - bmaporgy)>>MAPBLOCKSHIFT;
+
+            if (blockx>=0 && blockx < bmapwidth
+                && blocky>=0 && blocky < bmapheight)
+                blocklinks[blocky*bmapwidth+blockx] = mobj;
+        }
+    }
+
+    // Put the thinkers back in the order they ran in.
+    numthinkers = *get;
+    order = (byte *)(get + 1);
+    if (numthinkers != count + numspecials)
+        I_Error ("P_UnArchiveExtras: %d thinkers, not %d",
+                 count + numspecials, numthinkers);
+
+    prev = &thinkercap;
+    m = 1;
+    s = 0;
+    for (i=0 ; i<numthinkers ; i++)
+    {
+        th = order[i] ? &mobjs[m++]->thinker : specials[s++];
+        prev->next = th;
+        th->prev = prev;
+        prev = th;
+    }
+    prev->next = &thinkercap;
+    thinkercap.prev = prev;
+}
+
+//
+// P_TakeSnapshot
+//
+static void P_TakeSnapshot (void)
+{
+    rewindheader_t      header;
+    snapshot_t*         s;
+    long long           starttime;
+    byte*               image;
+    boolean             keyframe;
+    int                 size;
+    int                 csize;
+    int                 offset;
+
+    starttime = I_GetTimeUS ();
+
+    header.leveltime = leveltime;
+    header.prndindex = prndindex;
+    header.rndindex = rndindex;
+    header.episode = gameepisode;
+    header.map = gamemap;
+
+    P_SnapshotBegin ();
+    P_SaveReserve (sizeof(header));
+    save_p += sizeof(header);
+
+    P_SaveData (&header.players);
+    P_ArchivePlayers ();
+    P_SaveData (&header.world);
+    P_ArchiveWorld ();
+    P_SaveData (&header.thinkers);
+    P_ArchiveThinkers ();
+    P_SaveData (&header.specials);
+    P_ArchiveSpecials ();
+    P_SaveData (&header.extras);
+    P_ArchiveExtras ();
+
+    image = P_SaveData (&size);
+    header.end = size;
+    memcpy (image, &header, sizeof(header));
+
+    keyframe = !numsnaps || sincekey >= KEYFRAMEINTERVAL-1;
+    while (1)
+    {
+        csize = P_PackSnapshot (image, size, keyframe);
+        if (!csize || csize > arenasize)
+        {
+            // Start again from a keyframe.
+            statdropped++;
+            sincekey = KEYFRAMEINTERVAL;
+            return;
+        }
+
+        offset = P_AllocSnapshot (csize);
+
+        // The snapshot it was XORed with may have made way.
+        if (keyframe || numsnaps)
+            break;
+        keyframe = true;
+    }
+
+    memcpy (arena + offset, packbuffer, csize);
+    arenahead = offset + csize;
+
+    s = SNAP(numsnaps);
+    s->tic = leveltime;
+    s->offset = offset;
+    s->csize = csize;
+    s->size = size;
+    s->keyframe = keyframe;
+    numsnaps++;
+
+    sincekey = keyframe ? 0 : sincekey + 1;
+
+    P_GrowBuffer (&lastimage, &lastcapacity, size);
+    memcpy (lastimage, image, size);
+    lastsize = size;
+
+    statsnaps++;
+    statbytes += csize;
+    statrawbytes += size;
+    if (keyframe)
+    {
+        statkeys++;
+        statkeybytes += csize;
+    }
+    stattime += I_GetTimeUS () - starttime;
+}
+
+//
+// P_UnpackSnapshot
+// Rebuilds snapshot i from the keyframe before it.
+// Returns the size of the image.
+//
+static int
+P_UnpackSnapshot
+( int           i,
+  byte**        image,
+  int*          capacity )
+{
+    snapshot_t* s;
+    int         key;
+    int         size;
+    int         j;
+    int         k;
+
+    for (key = i ; !SNAP(key)->keyframe ; key--)
+        ;
+
+    size = 0;
+    for (j = key ; j <= i ; j++)
+    {
+        s = SNAP(j);
+        P_GrowBuffer (image, capacity, s->size);
+
+        if (s->keyframe)
+        {
+            if (LZ_Decompress (arena + s->offset, s->csize,
+                               *image, s->size) != s->size)
+                I_Error ("P_UnpackSnapshot: bad snapshot at tic %d", s->tic);
+        }
+        else
+        {
+            P_GrowBuffer (&deltabuffer, &deltacapacity, s->size);
+            if (LZ_Decompress (arena + s->offset, s->csize,
+                               deltabuffer, s->size) != s->size)
+                I_Error ("P_UnpackSnapshot: bad snapshot at tic %d", s->tic);
+
+            for (k=0 ; k<s->size && k<size ; k++)
+                (*image)[k] ^= deltabuffer[k];
+            if (k < s->size)
+                memcpy (*image+k, deltabuffer+k, s->size-k);
+        }
+        size = s->size;
+    }
+
+    return size;
+}
+
+//
+// P_RewindCount
+//
+int P_RewindCount (void)
+{
+    return numsnaps;
+}
+
+//
+// P_Rewind
+//
+boolean P_Rewind (int back)
+{
+    rewindheader_t      header;
+    snapshot_t*         s;
+    int                 i;
+    int                 size;
+
+    if (back < 0 || back >= numsnaps)
+        return false;
+
+    i = numsnaps-1 - back;
+    size = P_UnpackSnapshot (i, &imagebuffer, &imagecapacity);
+    memcpy (&header, imagebuffer, sizeof(header));
+
+    // The specials are added back to these.
+    for (i=0 ; i<ACTIVEHASHSIZE ; i++)
+    {
+        activeceilings[i] = NULL;
+        activeplats[i] = NULL;
+    }
+
+    save_p = imagebuffer + header.players;
+    P_UnArchivePlayers ();
+    P_UnArchiveWorld ();
+    P_RestoreHeights (PADPTR(imagebuffer + header.extras));
+    P_UnArchiveThinkers ();
+    P_UnArchiveSpecials ();
+    P_UnArchiveExtras (PADPTR(imagebuffer + header.extras));
+
+    leveltime = header.leveltime;
+    prndindex = header.prndindex;
+    rndindex = header.rndindex;
+
+    // The snapshots after it are of what will not happen now.
+    numsnaps -= back;
+    s = SNAP(numsnaps-1);
+    arenahead = s->offset + s->csize;
+
+    for (sincekey = 0, i = numsnaps-1 ; !SNAP(i)->keyframe ; i--)
+        sincekey++;
+
+    P_GrowBuffer (&lastimage, &lastcapacity, size);
+    memcpy (lastimage, imagebuffer, size);
+    lastsize = size;
+
+    return true;
+}
+
+//
+// P_RewindTicker
+//
+void P_RewindTicker (void)
+{
+    // Demos can't be rewound, and timed ones must not be slowed.
+    if (!rewindtics || netgame || demoplayback || timingdemo)
+        return;
+
+    stattics++;
+    if (leveltime % rewindtics)
+        return;
+
+    // Paused, or just rewound.
+    if (numsnaps && SNAP(numsnaps-1)->tic == leveltime)
+        return;
+
+    P_TakeSnapshot ();
+}
+
+//
+// SNAPSHOT DIFFERENCES
+//
+typedef struct
+{
+    char*       name;
+    int         offset;
+    int         size;
+
+} difffield_t;
+
+// Things are compared in their savegame records.
+#define MOBJFIELD(f)    { #f, SAVETHINKEROFFSET (offsetof(mobj_t, f)), \
+                          sizeof(((mobj_t*)0)->f) }
+#define PLAYERFIELD(f)  { #f, offsetof(player_t, f), \
+                          sizeof(((player_t*)0)->f) }
+
+static difffield_t mobjfields[] =
+{
+    MOBJFIELD(type),
+    MOBJFIELD(x),
+    MOBJFIELD(y),
+    MOBJFIELD(z),
+    MOBJFIELD(angle),
+    MOBJFIELD(momx),
+    MOBJFIELD(momy),
+    MOBJFIELD(momz),
+    MOBJFIELD(state),
+    MOBJFIELD(tics),
+    MOBJFIELD(flags),
+    MOBJFIELD(health),
+    MOBJFIELD(movedir),
+    MOBJFIELD(movecount),
+    MOBJFIELD(reactiontime),
+    MOBJFIELD(threshold),
+    MOBJFIELD(lastlook),
+    { NULL, 0, 0 }
+};
+
+static difffield_t playerfields[] =
+{
+    PLAYERFIELD(playerstate),
+    PLAYERFIELD(cmd),
+    PLAYERFIELD(viewz),
+    PLAYERFIELD(viewheight),
+    PLAYERFIELD(deltaviewheight),
+    PLAYERFIELD(bob),
+    PLAYERFIELD(health),
+    PLAYERFIELD(armorpoints),
+    PLAYERFIELD(armortype),
+    PLAYERFIELD(powers),
+    PLAYERFIELD(cards),
+    PLAYERFIELD(readyweapon),
+    PLAYERFIELD(pendingweapon),
+    PLAYERFIELD(weaponowned),
+    PLAYERFIELD(ammo),
+    PLAYERFIELD(attackdown),
+    PLAYERFIELD(usedown),
+    PLAYERFIELD(refire),
+    PLAYERFIELD(killcount),
+    PLAYERFIELD(itemcount),
+    PLAYERFIELD(secretcount),
+    PLAYERFIELD(damagecount),
+    PLAYERFIELD(bonuscount),
+    PLAYERFIELD(psprites),
+    { NULL, 0, 0 }
+};
+
+static char* sectorfields[] =
+{
+    "floorheight", "ceilingheight", "floorpic", "ceilingpic",
+    "lightlevel", "special", "tag"
+};
+
+//
+// P_DiffFields
+// Lists the fields that differ after label, returns how many.
+//
+static int
+P_DiffFields
+( difffield_t*  fields,
+  byte*         a,
+  byte*         b,
+  char*         label )
+{
+    int         count;
+
+    count = 0;
+    for ( ; fields->name ; fields++)
+    {
+        if (!memcmp (a + fields->offset, b + fields->offset, fields->size))
+            continue;
+
+        if (!count)
+            fprintf (stderr, "  %s:", label);
+        fprintf (stderr, " %s", fields->name);
+        count++;
+    }
+
+    if (count)
+        fprintf (stderr, "\n");
+    return count;
+}
+
+//
+// P_DiffMobjs
+// Things are compared in the order they were spawned in.
+//
+static int P_DiffMobjs (byte* a, byte* b)
+{
+    byte*       ma;
+    byte*       mb;
+    mobjtype_t  type;
+    char        label[32];
+    int         counta;
+    int         countb;
+    int         lines;
+    int         count;
+    int         n;
+
+    count = 0;
+    lines = 0;
+    counta = countb = 0;
+
+    while (*a == tc_mobj || *b == tc_mobj)
+    {
+        ma = mb = NULL;
+        if (*a == tc_mobj)
+        {
+            ma = PADPTR(a+1);
+            a = ma + SAVEMOBJSIZE;
+            counta++;
+        }
+        if (*b == tc_mobj)
+        {
+            mb = PADPTR(b+1);
+            b = mb + SAVEMOBJSIZE;
+            countb++;
+        }
+        if (!ma || !mb)
+            continue;
+
+        if (lines == MAXDIFFLINES)
+        {
+            // Only count the rest.
+            for (n=0 ; mobjfields[n].name ; n++)
+            {
+                if (memcmp (ma + mobjfields[n].offset,
+                            mb + mobjfields[n].offset,
+                            mobjfields[n].size))
+                {
+                    count++;
+                    break;
+                }
+            }
+            continue;
+        }
+
+        memcpy (&type, ma + SAVETHINKEROFFSET (offsetof(mobj_t, type)),
+                sizeof(type));
+        sprintf (label, "thing %d (type %d)", counta-1, type);
+        if (P_DiffFields (mobjfields, ma, mb, label))
+        {
+            count++;
+            lines++;
+        }
+    }
+
+    if (lines == MAXDIFFLINES)
+        fprintf (stderr, "  %d things differ in all\n", count);
+    if (counta != countb)
+    {
+        fprintf (stderr, "  %d things against %d\n", counta, countb);
+        count++;
+    }
+
+    return count;
+}
+
+//
+// P_DiffSnapshots
+//
+int P_DiffSnapshots (int back1, int back2)
+{
+    rewindheader_t      ha;
+    rewindheader_t      hb;
+    byte*               a;
+    byte*               b;
+    byte*               pa;
+    byte*               pb;
+    short*              sa;
+    short*              sb;
+    char                label[32];
+    int                 count;
+    int                 lines;
+    int                 sizea;
+    int                 sizeb;
+    int                 i;
+    int                 j;
+    int                 n;
+
+    if (back1 < 0 || back1 >= numsnaps
+        || back2 < 0 || back2 >= numsnaps)
+        return -1;
+
+    P_UnpackSnapshot (numsnaps-1 - back1, &imagebuffer, &imagecapacity);
+    P_UnpackSnapshot (numsnaps-1 - back2, &otherbuffer, &othercapacity);
+    a = imagebuffer;
+    b = otherbuffer;
+    memcpy (&ha, a, sizeof(ha));
+    memcpy (&hb, b, sizeof(hb));
+
+    fprintf (stderr, "P_DiffSnapshots: tic %d against tic %d\n",
+             ha.leveltime, hb.leveltime);
+
+    count = 0;
+    if (ha.prndindex != hb.prndindex)
+    {
+        fprintf (stderr, "  prndindex: %d, %d\n",
+                 ha.prndindex, hb.prndindex);
+        count++;
+    }
+
+    // players
+    pa = a + ha.players;
+    pb = b + hb.players;
+    for (i=0 ; i<MAXPLAYERS ; i++)
+    {
+        if (!playeringame[i])
+            continue;
+
+        pa = PADPTR(pa);
+        pb = PADPTR(pb);
+        sprintf (label, "player %d", i+1);
+        count += P_DiffFields (playerfields, pa, pb, label);
+        pa += SAVEPLAYERSIZE;
+        pb += SAVEPLAYERSIZE;
+    }
+
+    // sectors, 7 shorts each
+    sa = (short *)(a + ha.world);
+    sb = (short *)(b + hb.world);
+    lines = 0;
+    for (i=0 ; i<numsectors ; i++, sa += 7, sb += 7)
+    {
+        if (!memcmp (sa, sb, 7*sizeof(short)))
+            continue;
+
+        count++;
+        if (lines++ == MAXDIFFLINES)
+            continue;
+
+        fprintf (stderr, "  sector %d:", i);
+        for (j=0 ; j<7 ; j++)
+            if (sa[j] != sb[j])
+                fprintf (stderr, " %s", sectorfields[j]);
+        fprintf (stderr, "\n");
+    }
+    if (lines > MAXDIFFLINES)
+        fprintf (stderr, "  %d sectors differ in all\n", lines);
+
+    // lines and sides
+    n = 0;
+    for ( ; (byte *)sa < a + ha.thinkers ; sa++, sb++)
+        if (*sa != *sb)
+            n++;
+    if (n)
+    {
+        fprintf (stderr, "  lines: %d values differ\n", n);
+        count += n;
+    }
+
+    count += P_DiffMobjs (a + ha.thinkers, b + hb.thinkers);
+
+    // specials
+    sizea = ha.extras - ha.specials;
+    sizeb = hb.extras - hb.specials;
+    n = 0;
+    for (i=0 ; i<sizea && i<sizeb ; i++)
+        if (a[ha.specials + i] != b[hb.specials + i])
+            n++;
+    if (n || sizea != sizeb)
+    {
+        fprintf (stderr, "  specials: %d bytes against %d, %d differ\n",
+                 sizea, sizeb, n);
+        count++;
+    }
+
+    fprintf (stderr, "P_DiffSnapshots: %d differences\n", count);
+    return count;
+}
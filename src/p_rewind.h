@@ -0,0 +1,48 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Ring of game state snapshots, for rewinding
+//      and for finding where two tics differ.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __P_REWIND__
+#define __P_REWIND__
+
+#include "doomtype.h"
+
+// Sets up the snapshot memory, -rewind <tics> and -rewindmem <KB>.
+// Off on MC1 unless -rewind is given.
+void    P_InitRewind (void);
+
+// Forgets the snapshots of the last level and reports on them.
+void    P_ClearRewind (void);
+
+// Called after P_Ticker, takes a snapshot every few tics.
+void    P_RewindTicker (void);
+
+// Snapshots are counted back from the newest, which is 0.
+int     P_RewindCount (void);
+
+// Puts the level back as it was at a snapshot,
+//  false if there is no such snapshot.
+boolean P_Rewind (int back);
+
+// Prints where two snapshots differ to stderr.
+// Returns the number of differences, -1 for no such snapshots.
+int     P_DiffSnapshots (int back1, int back2);
+
+#endif  // __P_REWIND__
@@ -18,18 +18,300 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "i_system.h"
+#include "m_lz.h"
+#include "m_misc.h"
+#include "m_swap.h"
 #include "z_zone.h"
 #include "p_local.h"
+#include "p_saveg.h"
 
 #include <inttypes.h>
 
+#ifndef MC1
+#include <pthread.h>
+#define SAVE_THREAD
+#endif
+
 // State.
 #include "doomstat.h"
 #include "r_state.h"
 
 byte*           save_p;
 
+//
+// SAVEGAME BUFFER
+// The archive functions write through save_p into a buffer that
+//  grows as needed, so there is no limit on the size of a level.
+// P_SaveFile hands the buffer to a thread, which compresses it
+//  and writes the file while the game goes on.
+// A compressed file starts with the description, as the menu
+//  reads it from there, followed by SAVEGAMEMAGIC, the size of
+//  the rest and then the rest, compressed. Old files, which have
+//  the version string after the description, still load.
+//
+#define SAVEGAMEMAGIC           "DSGZ"
+#define SAVEHEADERSIZE          (SAVESTRINGSIZE + 8)
+
+#define SAVEBUFFERSIZE          0x10000
+
+static byte*    savebuffer;
+static int      savebuffersize;
+
+static byte*    snapbuffer;
+static int      snapbuffersize;
+
+// The one save_p is in.
+static byte**   savebase = &savebuffer;
+static int*     savebasesize = &savebuffersize;
+
+// Rewind snapshots keep some thinkers that a 1.10 savegame drops.
+#define SNAPSHOTTING    (savebase == &snapbuffer)
+
+typedef struct
+{
+    char        name[256];
+    byte*       data;
+    int         length;
+
+} savejob_t;
+
+static savejob_t savejob;
+
+#ifdef SAVE_THREAD
+static pthread_t savethread;
+static boolean  savethreadrunning;
+#endif
+
+//
+// P_SaveBegin
+// Starts a new savegame at the start of the buffer.
+//
+void P_SaveBegin (void)
+{
+    P_WaitSave ();
+
+    if (!savebuffer)
+    {
+        savebuffer = malloc (savebuffersize);
+        if (!savebuffer)
+            I_Error ("P_SaveBegin: couldn't allocate %d bytes",
+                     savebuffersize);
+    }
+    savebase = &savebuffer;
+    savebasesize = &savebuffersize;
+    save_p = savebuffer;
+}
+
+//
+// P_SnapshotBegin
+// Starts a rewind snapshot at the start of its own buffer.
+//
+void P_SnapshotBegin (void)
+{
+    if (!snapbuffer)
+    {
+        snapbuffersize = SAVEBUFFERSIZE;
+        snapbuffer = malloc (snapbuffersize);
+        if (!snapbuffer)
+            I_Error ("P_SnapshotBegin: couldn't allocate %d bytes",
+                     snapbuffersize);
+    }
+    savebase = &snapbuffer;
+    savebasesize = &snapbuffersize;
+    save_p = snapbuffer;
+}
+
+//
+// P_SaveData
+// Returns the start of the buffer and how much is in it.
+// The buffer is reused by the next P_SaveBegin or P_SnapshotBegin.
+//
+byte* P_SaveData (int* length)
+{
+    *length = save_p - *savebase;
+    return *savebase;
+}
+
+//
+// P_SaveReserve
+// Makes room for size more bytes at save_p.
+//
+void P_SaveReserve (int size)
+{
+    int         used;
+    int         newsize;
+    byte*       newbuffer;
+
+    used = save_p - *savebase;
+    if (used + size <= *savebasesize)
+        return;
+
+    newsize = *savebasesize;
+    while (newsize < used + size)
+        newsize *= 2;
+
+    newbuffer = realloc (*savebase, newsize);
+    if (!newbuffer)
+        I_Error ("P_SaveReserve: couldn't grow the savegame to %d bytes",
+                 newsize);
+
+    *savebase = newbuffer;
+    *savebasesize = newsize;
+    save_p = newbuffer + used;
+}
+
+//
+// P_WriteSaveJob
+// Compresses and writes out a savegame. Runs on the save thread,
+//  so it only reports to stderr.
+//
+static void P_WriteSaveJob (savejob_t* job)
+{
+    long long   starttime;
+    byte*       out;
+    int         bound;
+    int         csize;
+    int         length;
+
+    starttime = I_GetTimeUS ();
+
+    // Everything after the description is compressed. If that
+    //  doesn't help, the file is written the old way.
+    csize = 0;
+    length = job->length - SAVESTRINGSIZE;
+    bound = length + length/255 + 16;
+    out = malloc (SAVEHEADERSIZE + bound);
+    if (out)
+    {
+        csize = LZ_Compress (job->data + SAVESTRINGSIZE, length,
+                             out + SAVEHEADERSIZE, bound);
+        if (csize && SAVEHEADERSIZE + csize >= job->length)
+            csize = 0;
+    }
+
+    if (csize)
+    {
+        memcpy (out, job->data, SAVESTRINGSIZE);
+        memcpy (out + SAVESTRINGSIZE, SAVEGAMEMAGIC, 4);
+        *(int*)(out + SAVESTRINGSIZE + 4) = LONG(length);
+        if (!M_WriteFile (job->name, out, SAVEHEADERSIZE + csize))
+            fprintf (stderr, "P_SaveFile: couldn't write %s\n", job->name);
+    }
+    else if (!M_WriteFile (job->name, job->data, job->length))
+        fprintf (stderr, "P_SaveFile: couldn't write %s\n", job->name);
+
+    if (devparm)
+        fprintf (stderr, "P_SaveFile: %s, %d bytes, %d on disk, "
+                 "written in %.2f ms\n",
+                 job->name,
+                 job->length,
+                 csize ? SAVEHEADERSIZE + csize : job->length,
+                 (I_GetTimeUS () - starttime) / 1000.0);
+
+    free (out);
+    free (job->data);
+    job->data = NULL;
+}
+
+#ifdef SAVE_THREAD
+static void* P_SaveThread (void* arg)
+{
+    P_WriteSaveJob (arg);
+    return NULL;
+}
+#endif
+
+//
+// P_SaveFile
+// Writes the buffer out to the file, in the background
+//  where possible. Returns the size of the savegame.
+//
+int P_SaveFile (char* name)
+{
+    int         length;
+
+    length = save_p - savebuffer;
+
+    strncpy (savejob.name, name, sizeof(savejob.name)-1);
+    savejob.data = savebuffer;
+    savejob.length = length;
+
+    // The next savegame starts out big enough.
+    savebuffer = NULL;
+    save_p = NULL;
+
+#ifdef SAVE_THREAD
+    savethreadrunning =
+        !pthread_create (&savethread, NULL, P_SaveThread, &savejob);
+    if (!savethreadrunning)
+#endif
+        P_WriteSaveJob (&savejob);
+
+    return length;
+}
+
+//
+// P_WaitSave
+// Waits for the last savegame to be written.
+//
+void P_WaitSave (void)
+{
+#ifdef SAVE_THREAD
+    if (savethreadrunning)
+    {
+        pthread_join (savethread, NULL);
+        savethreadrunning = false;
+    }
+#endif
+
+    if (!savebuffersize)
+        savebuffersize = SAVEBUFFERSIZE;
+}
+
+//
+// P_LoadFile
+// Reads a savegame into a PU_STATIC block, uncompressed.
+// Returns the length.
+//
+int P_LoadFile (char* name, byte** buffer)
+{
+    byte*       file;
+    byte*       buf;
+    int         length;
+    int         size;
+
+    P_WaitSave ();
+
+    length = M_ReadFile (name, &file);
+    if (length < SAVEHEADERSIZE
+        || memcmp (file + SAVESTRINGSIZE, SAVEGAMEMAGIC, 4))
+    {
+        *buffer = file;
+        return length;
+    }
+
+    size = LONG(*(int*)(file + SAVESTRINGSIZE + 4));
+    if (size <= 0)
+        I_Error ("P_LoadFile: bad savegame %s", name);
+
+    // Keep the layout of an old file, description first.
+    buf = Z_Malloc (SAVESTRINGSIZE + size, PU_STATIC, NULL);
+    memcpy (buf, file, SAVESTRINGSIZE);
+    if (LZ_Decompress (file + SAVEHEADERSIZE, length - SAVEHEADERSIZE,
+                       buf + SAVESTRINGSIZE, size) != size)
+        I_Error ("P_LoadFile: bad savegame %s", name);
+
+    Z_Free (file);
+    *buffer = buf;
+    return SAVESTRINGSIZE + size;
+}
+
 // Pads save_p to a 4-byte boundary
 //  so that the load/save works on SGI&Gecko and MRISC32.
 #define PADSAVEP()      save_p += (4 - ((uintptr_t) save_p & 3)) & 3
@@ -39,6 +321,98 @@ byte*           save_p;
 #define IDX_TO_SECTOR(x) ((sector_t *)(x))
 #define PTR_TO_IDX(x) ((intptr_t)(x))
 
+//
+// P_WriteRecord
+// Writes src up to end, the offset of the first field that is not
+//  saved. A thinker gets the 1.10 thinker_t instead of its own.
+//
+static void
+P_WriteRecord
+( const void*   src,
+  boolean       thinker,
+  int           end,
+  int           size )
+{
+    const thinker_t*    th;
+    savethinker_t       header;
+    byte*               start;
+    int                 skip;
+
+    start = save_p;
+    skip = 0;
+    if (thinker)
+    {
+        th = src;
+        header.prev = th->prev;
+        header.next = th->next;
+        header.function = th->function;
+        memcpy (save_p, &header, sizeof(header));
+        save_p += sizeof(header);
+        skip = sizeof(thinker_t);
+    }
+
+    memcpy (save_p, (const byte *)src + skip, end - skip);
+    save_p += end - skip;
+
+    // padding up to the size of the 1.10 struct
+    memset (save_p, 0, start + size - save_p);
+    save_p = start + size;
+}
+
+//
+// P_ReadRecord
+// The fields that are not saved are cleared.
+//
+static void
+P_ReadRecord
+( void*         dest,
+  int           destsize,
+  boolean       thinker,
+  int           end,
+  int           size )
+{
+    thinker_t*          th;
+    savethinker_t       header;
+    byte*               start;
+    int                 skip;
+
+    memset (dest, 0, destsize);
+    start = save_p;
+    skip = 0;
+    if (thinker)
+    {
+        th = dest;
+        memcpy (&header, save_p, sizeof(header));
+        th->function = header.function;
+        save_p += sizeof(header);
+        skip = sizeof(thinker_t);
+    }
+
+    memcpy ((byte *)dest + skip, save_p, end - skip);
+    save_p = start + size;
+}
+
+// Thinkers that are saved whole, apart from the class links.
+#define SAVETHINKERSIZE(type) \
+    SAVEALIGN (SAVETHINKEROFFSET (sizeof(type)), type)
+
+#define WRITETHINKER(src, type) \
+    P_WriteRecord (src, true, sizeof(type), SAVETHINKERSIZE(type))
+#define READTHINKER(dest, type) \
+    P_ReadRecord (dest, sizeof(type), true, sizeof(type), \
+                  SAVETHINKERSIZE(type))
+
+// The movers end with their active list links.
+#define SAVEMOVERSIZE(type) \
+    SAVEALIGN (SAVETHINKEROFFSET (offsetof(type, activenext)), type)
+
+#define WRITEMOVER(src, type) \
+    P_WriteRecord (src, true, offsetof(type, activenext), \
+                   SAVEMOVERSIZE(type))
+#define READMOVER(dest, type) \
+    P_ReadRecord (dest, sizeof(type), true, offsetof(type, activenext), \
+                  SAVEMOVERSIZE(type))
+
 //
 // P_ArchivePlayers
 //
@@ -46,26 +420,27 @@ void P_ArchivePlayers (void)
 {
     int         i;
     int         j;
-    player_t*   dest;
+    player_t    player;
 
     for (i=0 ; i<MAXPLAYERS ; i++)
     {
         if (!playeringame[i])
             continue;
 
+        P_SaveReserve (3 + SAVEPLAYERSIZE);
         PADSAVEP();
 
-        dest = (player_t *)save_p;
-        memcpy (dest,&players[i],sizeof(player_t));
-        save_p += sizeof(player_t);
+        player = players[i];
         for (j=0 ; j<NUMPSPRITES ; j++)
         {
-            if (dest->psprites[j].state)
+            if (player.psprites[j].state)
             {
-                dest->psprites[j].state
-                    = IDX_TO_STATE(dest->psprites[j].state-states);
+                player.psprites[j].state
+                    = IDX_TO_STATE(player.psprites[j].state-states);
             }
         }
+        P_WriteRecord (&player, false, offsetof(player_t, oldviewz),
+                       SAVEPLAYERSIZE);
     }
 }
 
@@ -84,8 +459,9 @@ void P_UnArchivePlayers (void)
 
         PADSAVEP();
 
-        memcpy (&players[i],save_p, sizeof(player_t));
-        save_p += sizeof(player_t);
+        P_ReadRecord (&players[i], sizeof(player_t), false,
+                      offsetof(player_t, oldviewz), SAVEPLAYERSIZE);
+        players[i].oldviewz = players[i].viewz;
 
         // will be set when unarc thinker
         players[i].mo = NULL;
@@ -103,6 +479,7 @@ void P_UnArchivePlayers (void)
     }
 }
 
+
 //
 // P_ArchiveWorld
 //
@@ -115,6 +492,8 @@ void P_ArchiveWorld (void)
     side_t*             si;
     short*              put;
 
+    // 7 shorts per sector, up to 13 per line.
+    P_SaveReserve ((numsectors*7 + numlines*13) * sizeof(short));
     put = (short *)save_p;
 
     // do sectors
@@ -187,6 +566,7 @@ void P_UnArchiveWorld (void)
         li->flags = *get++;
         li->special = *get++;
         li->tag = *get++;
+        li->soundopen = -1;
         for (j=0 ; j<2 ; j++)
         {
             if (li->sidenum[j] == -1)
@@ -205,12 +585,6 @@ void P_UnArchiveWorld (void)
 //
 // Thinkers
 //
-typedef enum
-{
-    tc_end,
-    tc_mobj
-
-} thinkerclass_t;
 
 //
 // P_ArchiveThinkers
@@ -218,29 +592,27 @@ typedef enum
 void P_ArchiveThinkers (void)
 {
     thinker_t*          th;
-    mobj_t*             mobj;
+    mobj_t              mobj;
 
-    // save off the current thinkers
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    // save off the current mobjs
+    for (th = thinkerclasscap[th_mobj].cnext ;
+         th != &thinkerclasscap[th_mobj] ;
+         th=th->cnext)
     {
-        if (th->function.acp1 == (actionf_p1)P_MobjThinker)
-        {
-            *save_p++ = tc_mobj;
-            PADSAVEP();
-            mobj = (mobj_t *)save_p;
-            memcpy (mobj, th, sizeof(*mobj));
-            save_p += sizeof(*mobj);
-            mobj->state = (state_t *)(mobj->state - states);
+        P_SaveReserve (4 + SAVEMOBJSIZE);
+        *save_p++ = tc_mobj;
+        PADSAVEP();
+        mobj = *(mobj_t *)th;
+        mobj.state = (state_t *)(mobj.state - states);
 
-            if (mobj->player)
-                mobj->player = (player_t *)((mobj->player-players) + 1);
-            continue;
-        }
+        if (mobj.player)
+            mobj.player = (player_t *)((mobj.player-players) + 1);
 
-        // I_Error ("P_ArchiveThinkers: Unknown thinker function");
+        P_WriteRecord (&mobj, true, offsetof(mobj_t, oldx), SAVEMOBJSIZE);
     }
 
     // add a terminating marker
+    P_SaveReserve (1);
     *save_p++ = tc_end;
 }
 
@@ -254,17 +626,21 @@ void P_UnArchiveThinkers (void)
     thinker_t*          next;
     mobj_t*             mobj;
 
-    // remove all the current thinkers
+    // remove all the current mobjs
+    currentthinker = thinkerclasscap[th_mobj].cnext;
+    while (currentthinker != &thinkerclasscap[th_mobj])
+    {
+        next = currentthinker->cnext;
+        P_RemoveMobj ((mobj_t *)currentthinker);
+        currentthinker = next;
+    }
+
+    // ...and free all the thinkers
     currentthinker = thinkercap.next;
     while (currentthinker != &thinkercap)
     {
         next = currentthinker->next;
-
-        if (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
-            P_RemoveMobj ((mobj_t *)currentthinker);
-        else
-            Z_Free (currentthinker);
-
+        Z_Free (currentthinker);
         currentthinker = next;
     }
     P_InitThinkers ();
@@ -281,10 +657,13 @@ void P_UnArchiveThinkers (void)
           case tc_mobj:
             PADSAVEP();
             mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
-            memcpy (mobj, save_p, sizeof(*mobj));
-            save_p += sizeof(*mobj);
+            P_ReadRecord (mobj, sizeof(*mobj), true,
+                          offsetof(mobj_t, oldx), SAVEMOBJSIZE);
             mobj->state = &states[PTR_TO_IDX(mobj->state)];
             mobj->target = NULL;
+            // 1.10 kept the saved tracer, which points into the
+            // memory of the game that saved it.
+            mobj->tracer = NULL;
             if (mobj->player)
             {
                 mobj->player = &players[PTR_TO_IDX(mobj->player)-1];
@@ -294,8 +673,12 @@ void P_UnArchiveThinkers (void)
             mobj->info = &mobjinfo[mobj->type];
             mobj->floorz = mobj->subsector->sector->floorheight;
             mobj->ceilingz = mobj->subsector->sector->ceilingheight;
+            mobj->oldx = mobj->x;
+            mobj->oldy = mobj->y;
+            mobj->oldz = mobj->z;
+            mobj->oldangle = mobj->angle;
             mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
-            P_AddThinker (&mobj->thinker);
+            P_AddThinker (&mobj->thinker, th_mobj);
             break;
 
           default:
@@ -318,10 +701,45 @@ enum
     tc_flash,
     tc_strobe,
     tc_glow,
-    tc_endspecials
+    tc_endspecials,
+    tc_fireflicker      // rewind snapshots only, 1.10 does not know it
 
 } specials_e;
 
+// For the room that a special takes up.
+typedef union
+{
+    ceiling_t           ceiling;
+    vldoor_t            door;
+    floormove_t         floor;
+    plat_t              plat;
+    lightflash_t        flash;
+    strobe_t            strobe;
+    glow_t              glow;
+    fireflicker_t       flicker;
+
+} anyspecial_t;
+
+//
+// P_IsArchivedSpecial
+// True for the thinkers that P_ArchiveSpecials saves
+// in a rewind snapshot.
+//
+boolean P_IsArchivedSpecial (thinker_t* th)
+{
+    if (th->function.acv == (actionf_v)NULL)
+        return P_IsActiveCeiling (th) || P_IsActivePlat (th);
+
+    return th->function.acp1 == (actionf_p1)T_MoveCeiling
+        || th->function.acp1 == (actionf_p1)T_VerticalDoor
+        || th->function.acp1 == (actionf_p1)T_MoveFloor
+        || th->function.acp1 == (actionf_p1)T_PlatRaise
+        || th->function.acp1 == (actionf_p1)T_LightFlash
+        || th->function.acp1 == (actionf_p1)T_StrobeFlash
+        || th->function.acp1 == (actionf_p1)T_Glow
+        || th->function.acp1 == (actionf_p1)T_FireFlicker;
+}
+
 //
 // Things to handle:
 //
@@ -333,35 +751,39 @@ enum
 // T_Glow, (glow_t: sector_t *),
 // T_PlatRaise, (plat_t: sector_t *), - active list
 //
+// Rewind snapshots also keep plats in stasis and T_FireFlicker,
+// in the order they run in. Savegames drop them, as 1.10 does,
+// so that 1.10 can still load them.
+//
 void P_ArchiveSpecials (void)
 {
     thinker_t*          th;
-    ceiling_t*          ceiling;
-    vldoor_t*           door;
-    floormove_t*        floor;
-    plat_t*             plat;
-    lightflash_t*       flash;
-    strobe_t*           strobe;
-    glow_t*             glow;
-    int                 i;
+    anyspecial_t        special;
 
     // save off the current thinkers
     for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
     {
+        P_SaveReserve (4 + sizeof(anyspecial_t));
+
         if (th->function.acv == (actionf_v)NULL)
         {
-            for (i = 0; i < MAXCEILINGS;i++)
-                if (activeceilings[i] == (ceiling_t *)th)
-                    break;
-
-            if (i<MAXCEILINGS)
+            if (P_IsActiveCeiling(th))
             {
                 *save_p++ = tc_ceiling;
                 PADSAVEP();
-                ceiling = (ceiling_t *)save_p;
-                memcpy (ceiling, th, sizeof(*ceiling));
-                save_p += sizeof(*ceiling);
-                ceiling->sector = IDX_TO_SECTOR(ceiling->sector - sectors);
+                memcpy (&special, th, sizeof(ceiling_t));
+                special.ceiling.sector =
+                    IDX_TO_SECTOR(special.ceiling.sector - sectors);
+                WRITEMOVER (&special, ceiling_t);
+            }
+            else if (SNAPSHOTTING && P_IsActivePlat(th))
+            {
+                *save_p++ = tc_plat;
+                PADSAVEP();
+                memcpy (&special, th, sizeof(plat_t));
+                special.plat.sector =
+                    IDX_TO_SECTOR(special.plat.sector - sectors);
+                WRITEMOVER (&special, plat_t);
             }
             continue;
         }
@@ -370,10 +792,10 @@ void P_ArchiveSpecials (void)
         {
             *save_p++ = tc_ceiling;
             PADSAVEP();
-            ceiling = (ceiling_t *)save_p;
-            memcpy (ceiling, th, sizeof(*ceiling));
-            save_p += sizeof(*ceiling);
-            ceiling->sector = IDX_TO_SECTOR(ceiling->sector - sectors);
+            memcpy (&special, th, sizeof(ceiling_t));
+            special.ceiling.sector =
+                IDX_TO_SECTOR(special.ceiling.sector - sectors);
+            WRITEMOVER (&special, ceiling_t);
             continue;
         }
 
@@ -381,10 +803,10 @@ void P_ArchiveSpecials (void)
         {
             *save_p++ = tc_door;
             PADSAVEP();
-            door = (vldoor_t *)save_p;
-            memcpy (door, th, sizeof(*door));
-            save_p += sizeof(*door);
-            door->sector = IDX_TO_SECTOR(door->sector - sectors);
+            memcpy (&special, th, sizeof(vldoor_t));
+            special.door.sector =
+                IDX_TO_SECTOR(special.door.sector - sectors);
+            WRITETHINKER (&special, vldoor_t);
             continue;
         }
 
@@ -392,10 +814,10 @@ void P_ArchiveSpecials (void)
         {
             *save_p++ = tc_floor;
             PADSAVEP();
-            floor = (floormove_t *)save_p;
-            memcpy (floor, th, sizeof(*floor));
-            save_p += sizeof(*floor);
-            floor->sector = IDX_TO_SECTOR(floor->sector - sectors);
+            memcpy (&special, th, sizeof(floormove_t));
+            special.floor.sector =
+                IDX_TO_SECTOR(special.floor.sector - sectors);
+            WRITETHINKER (&special, floormove_t);
             continue;
         }
 
@@ -403,10 +825,10 @@ void P_ArchiveSpecials (void)
         {
             *save_p++ = tc_plat;
             PADSAVEP();
-            plat = (plat_t *)save_p;
-            memcpy (plat, th, sizeof(*plat));
-            save_p += sizeof(*plat);
-            plat->sector = IDX_TO_SECTOR(plat->sector - sectors);
+            memcpy (&special, th, sizeof(plat_t));
+            special.plat.sector =
+                IDX_TO_SECTOR(special.plat.sector - sectors);
+            WRITEMOVER (&special, plat_t);
             continue;
         }
 
@@ -414,10 +836,10 @@ void P_ArchiveSpecials (void)
         {
             *save_p++ = tc_flash;
             PADSAVEP();
-            flash = (lightflash_t *)save_p;
-            memcpy (flash, th, sizeof(*flash));
-            save_p += sizeof(*flash);
-            flash->sector = IDX_TO_SECTOR(flash->sector - sectors);
+            memcpy (&special, th, sizeof(lightflash_t));
+            special.flash.sector =
+                IDX_TO_SECTOR(special.flash.sector - sectors);
+            WRITETHINKER (&special, lightflash_t);
             continue;
         }
 
@@ -425,10 +847,10 @@ void P_ArchiveSpecials (void)
         {
             *save_p++ = tc_strobe;
             PADSAVEP();
-            strobe = (strobe_t *)save_p;
-            memcpy (strobe, th, sizeof(*strobe));
-            save_p += sizeof(*strobe);
-            strobe->sector = IDX_TO_SECTOR(strobe->sector - sectors);
+            memcpy (&special, th, sizeof(strobe_t));
+            special.strobe.sector =
+                IDX_TO_SECTOR(special.strobe.sector - sectors);
+            WRITETHINKER (&special, strobe_t);
             continue;
         }
 
@@ -436,15 +858,28 @@ void P_ArchiveSpecials (void)
         {
             *save_p++ = tc_glow;
             PADSAVEP();
-            glow = (glow_t *)save_p;
-            memcpy (glow, th, sizeof(*glow));
-            save_p += sizeof(*glow);
-            glow->sector = IDX_TO_SECTOR(glow->sector - sectors);
+            memcpy (&special, th, sizeof(glow_t));
+            special.glow.sector =
+                IDX_TO_SECTOR(special.glow.sector - sectors);
+            WRITETHINKER (&special, glow_t);
+            continue;
+        }
+
+        if (SNAPSHOTTING
+            && th->function.acp1 == (actionf_p1)T_FireFlicker)
+        {
+            *save_p++ = tc_fireflicker;
+            PADSAVEP();
+            memcpy (&special, th, sizeof(fireflicker_t));
+            special.flicker.sector =
+                IDX_TO_SECTOR(special.flicker.sector - sectors);
+            WRITETHINKER (&special, fireflicker_t);
             continue;
         }
     }
 
     // add a terminating marker
+    P_SaveReserve (1);
     *save_p++ = tc_endspecials;
 
 }
@@ -462,6 +897,7 @@ void P_UnArchiveSpecials (void)
     lightflash_t*       flash;
     strobe_t*           strobe;
     glow_t*             glow;
+    fireflicker_t*      flicker;
 
     // read in saved thinkers
     while (1)
@@ -475,83 +911,85 @@ void P_UnArchiveSpecials (void)
           case tc_ceiling:
             PADSAVEP();
             ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVEL, NULL);
-            memcpy (ceiling, save_p, sizeof(*ceiling));
-            save_p += sizeof(*ceiling);
+            READMOVER (ceiling, ceiling_t);
             ceiling->sector = &sectors[PTR_TO_IDX(ceiling->sector)];
             ceiling->sector->specialdata = ceiling;
 
             if (ceiling->thinker.function.acp1)
                 ceiling->thinker.function.acp1 = (actionf_p1)T_MoveCeiling;
 
-            P_AddThinker (&ceiling->thinker);
+            P_AddThinker (&ceiling->thinker, th_mover);
             P_AddActiveCeiling(ceiling);
             break;
 
           case tc_door:
             PADSAVEP();
             door = Z_Malloc (sizeof(*door), PU_LEVEL, NULL);
-            memcpy (door, save_p, sizeof(*door));
-            save_p += sizeof(*door);
+            READTHINKER (door, vldoor_t);
             door->sector = &sectors[PTR_TO_IDX(door->sector)];
             door->sector->specialdata = door;
             door->thinker.function.acp1 = (actionf_p1)T_VerticalDoor;
-            P_AddThinker (&door->thinker);
+            P_AddThinker (&door->thinker, th_mover);
             break;
 
           case tc_floor:
             PADSAVEP();
             floor = Z_Malloc (sizeof(*floor), PU_LEVEL, NULL);
-            memcpy (floor, save_p, sizeof(*floor));
-            save_p += sizeof(*floor);
+            READTHINKER (floor, floormove_t);
             floor->sector = &sectors[PTR_TO_IDX(floor->sector)];
             floor->sector->specialdata = floor;
             floor->thinker.function.acp1 = (actionf_p1)T_MoveFloor;
-            P_AddThinker (&floor->thinker);
+            P_AddThinker (&floor->thinker, th_mover);
             break;
 
           case tc_plat:
             PADSAVEP();
             plat = Z_Malloc (sizeof(*plat), PU_LEVEL, NULL);
-            memcpy (plat, save_p, sizeof(*plat));
-            save_p += sizeof(*plat);
+            READMOVER (plat, plat_t);
             plat->sector = &sectors[PTR_TO_IDX(plat->sector)];
             plat->sector->specialdata = plat;
 
             if (plat->thinker.function.acp1)
                 plat->thinker.function.acp1 = (actionf_p1)T_PlatRaise;
 
-            P_AddThinker (&plat->thinker);
+            P_AddThinker (&plat->thinker, th_mover);
             P_AddActivePlat(plat);
             break;
 
           case tc_flash:
             PADSAVEP();
             flash = Z_Malloc (sizeof(*flash), PU_LEVEL, NULL);
-            memcpy (flash, save_p, sizeof(*flash));
-            save_p += sizeof(*flash);
+            READTHINKER (flash, lightflash_t);
             flash->sector = &sectors[PTR_TO_IDX(flash->sector)];
             flash->thinker.function.acp1 = (actionf_p1)T_LightFlash;
-            P_AddThinker (&flash->thinker);
+            P_AddThinker (&flash->thinker, th_light);
             break;
 
           case tc_strobe:
             PADSAVEP();
             strobe = Z_Malloc (sizeof(*strobe), PU_LEVEL, NULL);
-            memcpy (strobe, save_p, sizeof(*strobe));
-            save_p += sizeof(*strobe);
+            READTHINKER (strobe, strobe_t);
             strobe->sector = &sectors[PTR_TO_IDX(strobe->sector)];
             strobe->thinker.function.acp1 = (actionf_p1)T_StrobeFlash;
-            P_AddThinker (&strobe->thinker);
+            P_AddThinker (&strobe->thinker, th_light);
             break;
 
           case tc_glow:
             PADSAVEP();
             glow = Z_Malloc (sizeof(*glow), PU_LEVEL, NULL);
-            memcpy (glow, save_p, sizeof(*glow));
-            save_p += sizeof(*glow);
+            READTHINKER (glow, glow_t);
             glow->sector = &sectors[PTR_TO_IDX(glow->sector)];
             glow->thinker.function.acp1 = (actionf_p1)T_Glow;
-            P_AddThinker (&glow->thinker);
+            P_AddThinker (&glow->thinker, th_light);
+            break;
+
+          case tc_fireflicker:
+            PADSAVEP();
+            flicker = Z_Malloc (sizeof(*flicker), PU_LEVEL, NULL);
+            READTHINKER (flicker, fireflicker_t);
+            flicker->sector = &sectors[PTR_TO_IDX(flicker->sector)];
+            flicker->thinker.function.acp1 = (actionf_p1)T_FireFlicker;
+            P_AddThinker (&flicker->thinker, th_light);
             break;
 
           default:
@@ -21,6 +21,9 @@
 #ifndef __P_SAVEG__
 #define __P_SAVEG__
 
+#include "doomtype.h"
+#include "d_think.h"
+
 // Persistent storage/archiving.
 // These are the load / save game routines.
 void P_ArchivePlayers (void);
@@ -32,6 +35,61 @@ void P_UnArchiveThinkers (void);
 void P_ArchiveSpecials (void);
 void P_UnArchiveSpecials (void);
 
+// The other halted thinkers are not saved.
+boolean P_IsArchivedSpecial (thinker_t* th);
+
 extern byte*            save_p;
 
+// Thinkers and players are saved as they were laid out in version
+//  1.10, so the fields that are only used at run time are left out:
+//  the class links of thinker_t, the interpolation fields at the end
+//  of mobj_t and player_t and the active list links of the movers.
+
+// The thinker_t of version 1.10, at the start of each thinker record.
+typedef struct
+{
+    struct thinker_s*   prev;
+    struct thinker_s*   next;
+    think_t             function;
+
+} savethinker_t;
+
+#define SAVEALIGN(size, type) \
+    (((size) + _Alignof(type)-1) & ~(_Alignof(type)-1))
+
+// Where a field at offset in a thinker is in its record.
+#define SAVETHINKEROFFSET(offset) \
+    ((int)(offset) - (int)sizeof(thinker_t) + (int)sizeof(savethinker_t))
+
+// Sizes of the records, they need p_mobj.h and d_player.h.
+#define SAVEMOBJSIZE \
+    SAVEALIGN (SAVETHINKEROFFSET (offsetof (mobj_t, oldx)), mobj_t)
+#define SAVEPLAYERSIZE \
+    SAVEALIGN ((int)offsetof (player_t, oldviewz), player_t)
+
+// Marks each thinker in P_ArchiveThinkers.
+typedef enum
+{
+    tc_end,
+    tc_mobj
+
+} thinkerclass_t;
+
+// Description at the start of a savegame.
+#define SAVESTRINGSIZE  24
+
+// The savegame buffer that save_p writes into.
+void    P_SaveBegin (void);
+
+// Or the one for rewind snapshots, which doesn't wait
+//  for the last savegame to be written.
+void    P_SnapshotBegin (void);
+void    P_SaveReserve (int size);
+byte*   P_SaveData (int* length);
+int     P_SaveFile (char* name);
+void    P_WaitSave (void);
+
+// Reads a savegame, compressed or not.
+int     P_LoadFile (char* name, byte** buffer);
+
 #endif  // __P_SAVEG__
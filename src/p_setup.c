@@ -19,10 +19,19 @@
 //
 //-----------------------------------------------------------------------------
 
+#define _POSIX_C_SOURCE 200809L  // Required to get strnlen()
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "z_zone.h"
 
 #include "m_swap.h"
 #include "m_bbox.h"
+#include "m_misc.h"
 
 #include "g_game.h"
 
@@ -31,12 +40,15 @@
 
 #include "doomdef.h"
 #include "p_local.h"
+#include "p_rewind.h"
 
 #include "s_sound.h"
 
 #include "doomstat.h"
+#include "dstrings.h"
 
 void    P_SpawnMapThing (mapthing_t*    mthing);
+void    P_SpawnPlayer (mapthing_t*      mthing);
 
 //
 // MAP related Lookup tables.
@@ -223,6 +235,8 @@ void P_LoadSectors (int lump)
     {
         ss->floorheight = INT_TO_FIXED (SHORT (ms->floorheight));
         ss->ceilingheight = INT_TO_FIXED (SHORT (ms->ceilingheight));
+        ss->oldfloorheight = ss->floorheight;
+        ss->oldceilingheight = ss->ceilingheight;
         ss->floorpic = R_FlatNumForName(ms->floorpic);
         ss->ceilingpic = R_FlatNumForName(ms->ceilingpic);
         ss->lightlevel = SHORT(ms->lightlevel);
@@ -469,6 +483,9 @@ void P_LoadBlockMap (int lump)
 void P_GroupLines (void)
 {
     line_t**            linebuffer;
+    line_t**            soundbuffer;
+    sector_t**          neighbourbuffer;
+    sector_t*           other;
     int                 i;
     int                 j;
     int                 total;
@@ -492,6 +509,7 @@ void P_GroupLines (void)
     total = 0;
     for (i=0 ; i<numlines ; i++, li++)
     {
+        li->soundopen = -1;
         total++;
         li->frontsector->linecount++;
 
@@ -503,7 +521,10 @@ void P_GroupLines (void)
     }
 
     // build line tables for each sector
+    // (there are never more neighbours than lines)
     linebuffer = Z_Malloc (total*sizeof(linebuffer), PU_LEVEL, 0);
+    neighbourbuffer = Z_Malloc (total*sizeof(neighbourbuffer), PU_LEVEL, 0);
+    soundbuffer = Z_Malloc (total*sizeof(soundbuffer), PU_LEVEL, 0);
     sector = sectors;
     for (i=0 ; i<numsectors ; i++, sector++)
     {
@@ -522,6 +543,31 @@ void P_GroupLines (void)
         if (linebuffer - sector->lines != sector->linecount)
             I_Error ("P_GroupLines: miscounted");
 
+        // build the neighbour table, with each
+        // adjoining sector only listed once
+        sector->neighbours = neighbourbuffer;
+        validcount++;
+        for (j=0 ; j<sector->linecount ; j++)
+        {
+            other = getNextSector (sector->lines[j], sector);
+            if (!other || other->validcount == validcount)
+                continue;
+            other->validcount = validcount;
+            *neighbourbuffer++ = other;
+        }
+        sector->neighbourcount = neighbourbuffer - sector->neighbours;
+
+        // build the sound graph, the lines that
+        // P_RecursiveSound may flood through
+        sector->soundlines = soundbuffer;
+        for (j=0 ; j<sector->linecount ; j++)
+        {
+            li = sector->lines[j];
+            if ((li->flags & ML_TWOSIDED) && li->sidenum[1] != -1)
+                *soundbuffer++ = li;
+        }
+        sector->soundlinecount = soundbuffer - sector->soundlines;
+
         // set the degenmobj_t to the middle of the bounding box
         sector->soundorg.x = (bbox[BOXRIGHT]+bbox[BOXLEFT])/2;
         sector->soundorg.y = (bbox[BOXTOP]+bbox[BOXBOTTOM])/2;
@@ -547,55 +593,954 @@ void P_GroupLines (void)
 }
 
 //
-// P_SetupLevel
+// LEVEL CACHE
+// The map structures of a level, as they are after P_GroupLines,
+//  are written to a file, so that the next time the level can be
+//  loaded with a single read.
+// Pointers are stored as index+1 into the array that they point
+//  into, with 0 for NULL, and are fixed up after loading.
+// The file depends on the struct layout of this build and on the
+//  WAD files (W_Checksum), and is rewritten if either changes.
 //
-void
-P_SetupLevel
-( int           episode,
-  int           map,
-  int           playermask,
-  skill_t       skill)
+#define LEVELCACHEVERSION       1
+
+typedef struct
+{
+    char        id[4];          // "DLVC"
+    int         version;
+    unsigned    checksum;
+    char        mapname[8];
+    int         size;           // of the whole file
+
+    // Layout of this build.
+    int         pointersize;
+    int         sectorsize;
+    int         sidesize;
+    int         linesize;
+    int         segsize;
+
+    // Array sizes, in the order that the arrays are stored.
+    int         numvertexes;
+    int         numsectors;
+    int         numsides;
+    int         numlines;
+    int         numsubsectors;
+    int         numnodes;
+    int         numsegs;
+    int         numlinerefs;    // sector->lines
+    int         numneighbours;  // sector->neighbours
+    int         numsoundlines;  // sector->soundlines
+    int         blockmapsize;   // in shorts
+    int         rejectsize;
+
+} levelcache_t;
+
+enum
+{
+    LC_VERTEXES,
+    LC_SECTORS,
+    LC_SIDES,
+    LC_LINES,
+    LC_SUBSECTORS,
+    LC_NODES,
+    LC_SEGS,
+    LC_LINEREFS,
+    LC_NEIGHBOURS,
+    LC_SOUNDLINES,
+    LC_BLOCKMAP,
+    LC_REJECT,
+    NUMLCARRAYS
+};
+
+#define LC_INDEX(p, base) \
+    ((p) ? (void*)(uintptr_t)((p) - (base) + 1) : NULL)
+#define LC_RELOC(p, base, count) \
+    ((p) = P_LevelCachePointer ((uintptr_t)(p), (base), \
+                                sizeof(*(base)), (count)))
+
+boolean         levelcache;
+
+// Cleared by P_LevelCachePointer when an index is out of range.
+static boolean  levelcachevalid;
+
+//
+// P_LevelCachePointer
+// Turns an index+1 into a pointer into an array of count elements.
+//
+static void*
+P_LevelCachePointer
+( uintptr_t     index,
+  void*         base,
+  size_t        size,
+  int           count )
 {
+    if (!index)
+        return NULL;
+    if (index > (uintptr_t)count)
+    {
+        levelcachevalid = false;
+        return NULL;
+    }
+    return (byte*)base + (index-1)*size;
+}
+
+//
+// P_CheckLevelCacheRange
+// The sector arrays start at an index+1, which must leave
+//  room for count elements.
+//
+static void P_CheckLevelCacheRange (void* p, int count, int total)
+{
+    uintptr_t   index = (uintptr_t)p;
+
+    if (count < 0
+        || (!index && count)
+        || (index && index-1 + (uintptr_t)count > (uintptr_t)total))
+        levelcachevalid = false;
+}
+
+//
+// P_LevelCacheLayout
+// Finds the file offset of each array, returns the file size,
+//  or -1 if a count is negative or the file would be too large.
+//
+static int P_LevelCacheLayout (levelcache_t* lc, int* offsets)
+{
+    long long   sizes[NUMLCARRAYS];
+    long long   pos;
     int         i;
-    char        lumpname[9];
-    int         lumpnum;
 
-    // UNUSED.
-    (void)playermask;
-    (void)skill;
+    sizes[LC_VERTEXES] = lc->numvertexes * (long long)sizeof(vertex_t);
+    sizes[LC_SECTORS] = lc->numsectors * (long long)sizeof(sector_t);
+    sizes[LC_SIDES] = lc->numsides * (long long)sizeof(side_t);
+    sizes[LC_LINES] = lc->numlines * (long long)sizeof(line_t);
+    sizes[LC_SUBSECTORS] = lc->numsubsectors * (long long)sizeof(subsector_t);
+    sizes[LC_NODES] = lc->numnodes * (long long)sizeof(node_t);
+    sizes[LC_SEGS] = lc->numsegs * (long long)sizeof(seg_t);
+    sizes[LC_LINEREFS] = lc->numlinerefs * (long long)sizeof(line_t*);
+    sizes[LC_NEIGHBOURS] = lc->numneighbours * (long long)sizeof(sector_t*);
+    sizes[LC_SOUNDLINES] = lc->numsoundlines * (long long)sizeof(line_t*);
+    sizes[LC_BLOCKMAP] = lc->blockmapsize * (long long)sizeof(short);
+    sizes[LC_REJECT] = lc->rejectsize;
+
+    // Keep every array 8 byte aligned.
+    pos = (sizeof(levelcache_t) + 7) & ~7;
+    for (i=0 ; i<NUMLCARRAYS ; i++)
+    {
+        if (sizes[i] < 0)
+            return -1;
+        offsets[i] = (int)pos;
+        pos = (pos + sizes[i] + 7) & ~7;
+        if (pos > MAXINT)
+            return -1;
+    }
+    return (int)pos;
+}
+
+//
+// P_InitLevelCacheHeader
+//
+static void
+P_InitLevelCacheHeader
+( levelcache_t* lc,
+  char*         mapname,
+  unsigned      checksum )
+{
+    memset (lc, 0, sizeof(*lc));
+    memcpy (lc->id, "DLVC", 4);
+    lc->version = LEVELCACHEVERSION;
+    lc->checksum = checksum;
+    memcpy (lc->mapname, mapname, strnlen (mapname, sizeof(lc->mapname)));
+    lc->pointersize = sizeof(void*);
+    lc->sectorsize = sizeof(sector_t);
+    lc->sidesize = sizeof(side_t);
+    lc->linesize = sizeof(line_t);
+    lc->segsize = sizeof(seg_t);
+}
+
+//
+// P_BuildLevelImage
+// Copies the level structures into one malloced buffer,
+//  with the pointers turned into indices. Returns NULL
+//  if there is no level or no memory.
+//
+static byte*
+P_BuildLevelImage
+( char*         mapname,
+  unsigned      checksum,
+  int           blockmapsize,
+  int           rejectsize )
+{
+    levelcache_t        lc;
+    int                 offsets[NUMLCARRAYS];
+    byte*               buf;
+    int                 i;
+    int                 j;
+    sector_t*           sec;
+    side_t*             sd;
+    line_t*             ld;
+    subsector_t*        ss;
+    seg_t*              seg;
+    line_t**            lref;
+    sector_t**          nref;
+    line_t**            sref;
+
+    if (!numsectors)
+        return NULL;
+
+    P_InitLevelCacheHeader (&lc, mapname, checksum);
+    lc.numvertexes = numvertexes;
+    lc.numsectors = numsectors;
+    lc.numsides = numsides;
+    lc.numlines = numlines;
+    lc.numsubsectors = numsubsectors;
+    lc.numnodes = numnodes;
+    lc.numsegs = numsegs;
+    for (i=0 ; i<numsectors ; i++)
+    {
+        lc.numlinerefs += sectors[i].linecount;
+        lc.numneighbours += sectors[i].neighbourcount;
+        lc.numsoundlines += sectors[i].soundlinecount;
+    }
+    lc.blockmapsize = blockmapsize;
+    lc.rejectsize = rejectsize;
+    lc.size = P_LevelCacheLayout (&lc, offsets);
+
+    buf = malloc (lc.size);
+    if (!buf)
+        return NULL;
+    memset (buf, 0, lc.size);
+    memcpy (buf, &lc, sizeof(lc));
+    memcpy (buf+offsets[LC_VERTEXES], vertexes, numvertexes*sizeof(vertex_t));
+    memcpy (buf+offsets[LC_SECTORS], sectors, numsectors*sizeof(sector_t));
+    memcpy (buf+offsets[LC_SIDES], sides, numsides*sizeof(side_t));
+    memcpy (buf+offsets[LC_LINES], lines, numlines*sizeof(line_t));
+    memcpy (buf+offsets[LC_SUBSECTORS], subsectors,
+            numsubsectors*sizeof(subsector_t));
+    memcpy (buf+offsets[LC_NODES], nodes, numnodes*sizeof(node_t));
+    memcpy (buf+offsets[LC_SEGS], segs, numsegs*sizeof(seg_t));
+    memcpy (buf+offsets[LC_LINEREFS], sectors[0].lines,
+            lc.numlinerefs*sizeof(line_t*));
+    memcpy (buf+offsets[LC_NEIGHBOURS], sectors[0].neighbours,
+            lc.numneighbours*sizeof(sector_t*));
+    memcpy (buf+offsets[LC_SOUNDLINES], sectors[0].soundlines,
+            lc.numsoundlines*sizeof(line_t*));
+    memcpy (buf+offsets[LC_BLOCKMAP], blockmaplump,
+            blockmapsize*sizeof(short));
+    memcpy (buf+offsets[LC_REJECT], rejectmatrix, rejectsize);
+
+    // Turn the pointers of the copy into indices,
+    // and clear the run time state.
+    sec = (sector_t*)(buf+offsets[LC_SECTORS]);
+    for (i=0 ; i<numsectors ; i++, sec++)
+    {
+        sec->soundtarget = NULL;
+        sec->thinglist = NULL;
+        sec->specialdata = NULL;
+        sec->validcount = 0;
+        memset (&sec->soundorg.thinker, 0, sizeof(thinker_t));
+        sec->lines = LC_INDEX (sec->lines, sectors[0].lines);
+        sec->neighbours = LC_INDEX (sec->neighbours, sectors[0].neighbours);
+        sec->soundlines = LC_INDEX (sec->soundlines, sectors[0].soundlines);
+    }
+
+    sd = (side_t*)(buf+offsets[LC_SIDES]);
+    for (i=0 ; i<numsides ; i++, sd++)
+        sd->sector = LC_INDEX (sd->sector, sectors);
+
+    ld = (line_t*)(buf+offsets[LC_LINES]);
+    for (i=0 ; i<numlines ; i++, ld++)
+    {
+        ld->v1 = LC_INDEX (ld->v1, vertexes);
+        ld->v2 = LC_INDEX (ld->v2, vertexes);
+        ld->frontsector = LC_INDEX (ld->frontsector, sectors);
+        ld->backsector = LC_INDEX (ld->backsector, sectors);
+        ld->validcount = 0;
+        ld->specialdata = NULL;
+    }
+
+    ss = (subsector_t*)(buf+offsets[LC_SUBSECTORS]);
+    for (i=0 ; i<numsubsectors ; i++, ss++)
+        ss->sector = LC_INDEX (ss->sector, sectors);
+
+    seg = (seg_t*)(buf+offsets[LC_SEGS]);
+    for (i=0 ; i<numsegs ; i++, seg++)
+    {
+        seg->v1 = LC_INDEX (seg->v1, vertexes);
+        seg->v2 = LC_INDEX (seg->v2, vertexes);
+        seg->sidedef = LC_INDEX (seg->sidedef, sides);
+        seg->linedef = LC_INDEX (seg->linedef, lines);
+        seg->frontsector = LC_INDEX (seg->frontsector, sectors);
+        seg->backsector = LC_INDEX (seg->backsector, sectors);
+    }
+
+    lref = (line_t**)(buf+offsets[LC_LINEREFS]);
+    for (j=0 ; j<lc.numlinerefs ; j++)
+        lref[j] = LC_INDEX (lref[j], lines);
+    nref = (sector_t**)(buf+offsets[LC_NEIGHBOURS]);
+    for (j=0 ; j<lc.numneighbours ; j++)
+        nref[j] = LC_INDEX (nref[j], sectors);
+    sref = (line_t**)(buf+offsets[LC_SOUNDLINES]);
+    for (j=0 ; j<lc.numsoundlines ; j++)
+        sref[j] = LC_INDEX (sref[j], lines);
+
+    return buf;
+}
+
+//
+// P_SaveLevelCache
+// Called after P_GroupLines on the slow path.
+//
+static void
+P_SaveLevelCache
+( char*         filename,
+  char*         mapname,
+  unsigned      checksum,
+  int           blockmapsize,
+  int           rejectsize )
+{
+    byte*       buf;
+
+    buf = P_BuildLevelImage (mapname, checksum, blockmapsize, rejectsize);
+    if (!buf)
+        return;
+
+    if (!M_WriteFile (filename, buf, ((levelcache_t*)buf)->size))
+        fprintf (stderr, "P_SaveLevelCache: couldn't write %s\n", filename);
+
+    free (buf);
+}
+
+//
+// P_InstallLevelImage
+// Makes a level image in a PU_LEVEL block the current level,
+//  as P_LoadBlockMap to P_GroupLines would. Returns false if
+//  an index is out of range, and the level must then be loaded
+//  from the WAD.
+//
+static boolean P_InstallLevelImage (byte* buf)
+{
+    levelcache_t*       file;
+    int                 offsets[NUMLCARRAYS];
+    int                 count;
+    int                 i;
+    sector_t*           sec;
+    line_t*             ld;
+    seg_t*              seg;
+    line_t**            linerefs;
+    sector_t**          neighbours;
+    line_t**            soundlines;
+
+    file = (levelcache_t*)buf;
+    P_LevelCacheLayout (file, offsets);
+
+    numvertexes = file->numvertexes;
+    numsectors = file->numsectors;
+    numsides = file->numsides;
+    numlines = file->numlines;
+    numsubsectors = file->numsubsectors;
+    numnodes = file->numnodes;
+    numsegs = file->numsegs;
+    vertexes = (vertex_t*)(buf+offsets[LC_VERTEXES]);
+    sectors = (sector_t*)(buf+offsets[LC_SECTORS]);
+    sides = (side_t*)(buf+offsets[LC_SIDES]);
+    lines = (line_t*)(buf+offsets[LC_LINES]);
+    subsectors = (subsector_t*)(buf+offsets[LC_SUBSECTORS]);
+    nodes = (node_t*)(buf+offsets[LC_NODES]);
+    segs = (seg_t*)(buf+offsets[LC_SEGS]);
+    linerefs = (line_t**)(buf+offsets[LC_LINEREFS]);
+    neighbours = (sector_t**)(buf+offsets[LC_NEIGHBOURS]);
+    soundlines = (line_t**)(buf+offsets[LC_SOUNDLINES]);
+    blockmaplump = (short*)(buf+offsets[LC_BLOCKMAP]);
+    rejectmatrix = buf+offsets[LC_REJECT];
+
+    // Fix up the pointers, checking every index.
+    levelcachevalid = true;
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+    {
+        P_CheckLevelCacheRange (sec->lines, sec->linecount,
+                                file->numlinerefs);
+        P_CheckLevelCacheRange (sec->neighbours, sec->neighbourcount,
+                                file->numneighbours);
+        P_CheckLevelCacheRange (sec->soundlines, sec->soundlinecount,
+                                file->numsoundlines);
+        LC_RELOC (sec->lines, linerefs, file->numlinerefs);
+        LC_RELOC (sec->neighbours, neighbours, file->numneighbours);
+        LC_RELOC (sec->soundlines, soundlines, file->numsoundlines);
+    }
+    for (i=0 ; i<numsides ; i++)
+        LC_RELOC (sides[i].sector, sectors, numsectors);
+    for (i=0, ld=lines ; i<numlines ; i++, ld++)
+    {
+        LC_RELOC (ld->v1, vertexes, numvertexes);
+        LC_RELOC (ld->v2, vertexes, numvertexes);
+        LC_RELOC (ld->frontsector, sectors, numsectors);
+        LC_RELOC (ld->backsector, sectors, numsectors);
+    }
+    for (i=0 ; i<numsubsectors ; i++)
+        LC_RELOC (subsectors[i].sector, sectors, numsectors);
+    for (i=0, seg=segs ; i<numsegs ; i++, seg++)
+    {
+        LC_RELOC (seg->v1, vertexes, numvertexes);
+        LC_RELOC (seg->v2, vertexes, numvertexes);
+        LC_RELOC (seg->sidedef, sides, numsides);
+        LC_RELOC (seg->linedef, lines, numlines);
+        LC_RELOC (seg->frontsector, sectors, numsectors);
+        LC_RELOC (seg->backsector, sectors, numsectors);
+    }
+    for (i=0 ; i<file->numlinerefs ; i++)
+        LC_RELOC (linerefs[i], lines, numlines);
+    for (i=0 ; i<file->numneighbours ; i++)
+        LC_RELOC (neighbours[i], sectors, numsectors);
+    for (i=0 ; i<file->numsoundlines ; i++)
+        LC_RELOC (soundlines[i], lines, numlines);
+
+    // The blockmap header and its offset table must fit.
+    if (file->blockmapsize < 4
+        || blockmaplump[2] < 0
+        || blockmaplump[3] < 0
+        || 4 + blockmaplump[2]*blockmaplump[3] > file->blockmapsize)
+        levelcachevalid = false;
+
+    if (!levelcachevalid)
+        return false;
+
+    // As in P_LoadBlockMap.
+    blockmap = blockmaplump+4;
+    bmaporgx = INT_TO_FIXED (blockmaplump[0]);
+    bmaporgy = INT_TO_FIXED (blockmaplump[1]);
+    bmapwidth = blockmaplump[2];
+    bmapheight = blockmaplump[3];
+    count = sizeof(*blocklinks)* bmapwidth*bmapheight;
+    blocklinks = Z_Malloc (count,PU_LEVEL, 0);
+    memset (blocklinks, 0, count);
+    return true;
+}
+
+//
+// P_LoadLevelCache
+// Replaces everything from P_LoadBlockMap to P_GroupLines.
+// Returns false if there is no valid cache file.
+//
+static boolean
+P_LoadLevelCache
+( char*         filename,
+  char*         mapname,
+  unsigned      checksum )
+{
+    levelcache_t        lc;
+    levelcache_t*       file;
+    int                 offsets[NUMLCARRAYS];
+    FILE*               f;
+    long                size;
+    byte*               buf;
+    int                 count;
+
+    f = fopen (filename, "rb");
+    if (!f)
+        return false;
+    fseek (f, 0, SEEK_END);
+    size = ftell (f);
+    fseek (f, 0, SEEK_SET);
+    if (size < (long)sizeof(levelcache_t) || size > MAXINT)
+    {
+        fclose (f);
+        return false;
+    }
+
+    buf = Z_Malloc (size, PU_LEVEL, 0);
+    count = fread (buf, 1, size, f);
+    fclose (f);
+
+    // Check that the file is for this build, WAD and map.
+    file = (levelcache_t*)buf;
+    P_InitLevelCacheHeader (&lc, mapname, checksum);
+    if (count != size
+        || memcmp (file->id, lc.id, 4)
+        || file->version != lc.version
+        || file->checksum != lc.checksum
+        || strncmp (file->mapname, lc.mapname, 8)
+        || file->pointersize != lc.pointersize
+        || file->sectorsize != lc.sectorsize
+        || file->sidesize != lc.sidesize
+        || file->linesize != lc.linesize
+        || file->segsize != lc.segsize
+        || file->size != count
+        || P_LevelCacheLayout (file, offsets) != count)
+    {
+        Z_Free (buf);
+        return false;
+    }
+
+    if (!P_InstallLevelImage (buf))
+    {
+        fprintf (stderr, "P_LoadLevelCache: %s is corrupt\n", filename);
+        Z_Free (buf);
+        return false;
+    }
+    return true;
+}
+
+//
+// LEVEL SNAPSHOT
+// The state right after P_SetupLevel is kept in memory, so that
+//  restarting the same level, e.g. after dying, does not have to
+//  load and spawn it again. The snapshot is a level image as
+//  above, followed by the thinkers, with indices for pointers.
+//  Restoring it takes one memcpy for the level and one for each
+//  thinker, and then the pointers are fixed up.
+// Things are spawned with P_Random, so a restored level is not
+//  exactly a reloaded one. Demos and net games always reload.
+//
+typedef struct
+{
+    int         episode;
+    int         map;
+    skill_t     skill;
+    boolean     nomonsters;
+    boolean     fastparm;
+    unsigned    checksum;
+
+    int         imagesize;
+    int         numthinkers;
+    int         numblocklinks;
+
+    int         totalkills;
+    int         totalitems;
+    int         totalsecret;
+    int         numdmstarts;
+    mapthing_t  dmstarts[MAX_DM_STARTS];
+    mapthing_t  starts[MAXPLAYERS];
+    int         playermo[MAXPLAYERS];   // thinker index + 1
+
+} levelsnap_t;
+
+// The thinkers that P_SetupLevel can leave behind.
+typedef struct
+{
+    actionf_p1  function;
+    int         size;
+    thclass_t   tclass;
+    int         tag;
+    int         sector;         // offset of the sector_t*, mobjs: -1
+
+} snapthinker_t;
+
+static const snapthinker_t snapthinkers[] =
+{
+    { (actionf_p1)P_MobjThinker, sizeof(mobj_t), th_mobj, PU_LEVEL, -1 },
+    { (actionf_p1)T_FireFlicker, sizeof(fireflicker_t), th_light, PU_LEVSPEC,
+      offsetof(fireflicker_t, sector) },
+    { (actionf_p1)T_LightFlash, sizeof(lightflash_t), th_light, PU_LEVSPEC,
+      offsetof(lightflash_t, sector) },
+    { (actionf_p1)T_StrobeFlash, sizeof(strobe_t), th_light, PU_LEVSPEC,
+      offsetof(strobe_t, sector) },
+    { (actionf_p1)T_Glow, sizeof(glow_t), th_light, PU_LEVSPEC,
+      offsetof(glow_t, sector) },
+    { (actionf_p1)T_VerticalDoor, sizeof(vldoor_t), th_mover, PU_LEVSPEC,
+      offsetof(vldoor_t, sector) }
+};
+
+#define NUMSNAPTHINKERS (int)(sizeof(snapthinkers)/sizeof(*snapthinkers))
+
+// Every part of the snapshot is 8 byte aligned. A thinker
+//  is stored as its type, followed by the thinker itself.
+#define SNAP_ALIGN(size)        (((size) + 7) & ~7)
+#define SNAP_RECORD(type)       (8 + SNAP_ALIGN(snapthinkers[type].size))
+
+#define SNAP_RELOC(p, table) \
+    ((p) = (p) ? (void*)(table)[(uintptr_t)(p) - 1] : NULL)
+
+typedef struct
+{
+    uintptr_t   address;
+    int         index;
+
+} snapref_t;
+
+boolean         nolevelsnapshot;
+
+static byte*    snapshot;
+
+// Thinkers sorted by address, for P_SnapIndex.
+static snapref_t* snaprefs;
+static int      numsnaprefs;
+static boolean  snapfailed;
+
+//
+// P_SnapThinkerType
+// Returns -1 for a thinker that can not be in a snapshot.
+//
+static int P_SnapThinkerType (thinker_t* th)
+{
+    int         i;
+
+    for (i=0 ; i<NUMSNAPTHINKERS ; i++)
+        if (th->function.acp1 == snapthinkers[i].function)
+            return i;
+    return -1;
+}
+
+static int P_CompareSnapRefs (const void* a, const void* b)
+{
+    uintptr_t   x = ((const snapref_t*)a)->address;
+    uintptr_t   y = ((const snapref_t*)b)->address;
+
+    return x < y ? -1 : x > y;
+}
+
+//
+// P_SnapIndex
+// Turns a thinker pointer into its index + 1.
+//
+static void* P_SnapIndex (void* th)
+{
+    snapref_t   key;
+    snapref_t*  ref;
+
+    if (!th)
+        return NULL;
+
+    key.address = (uintptr_t)th;
+    ref = bsearch (&key, snaprefs, numsnaprefs, sizeof(*snaprefs),
+                   P_CompareSnapRefs);
+    if (!ref)
+    {
+        // Not in the thinker list, don't keep a snapshot.
+        snapfailed = true;
+        return NULL;
+    }
+    return (void*)(uintptr_t)(ref->index + 1);
+}
+
+//
+// P_DropSnapshot
+//
+void P_DropSnapshot (void)
+{
+    free (snapshot);
+    snapshot = NULL;
+}
+
+//
+// P_SnapshotAllowed
+//
+static boolean P_SnapshotAllowed (unsigned checksum)
+{
+    return !nolevelsnapshot
+        && checksum
+        && !netgame
+        && !deathmatch
+        && !demoplayback
+        && !demorecording;
+}
+
+//
+// P_WriteSnapshot
+// Fills in everything after the header and the image.
+//
+static void P_WriteSnapshot (levelsnap_t* snap, byte* pos)
+{
+    thinker_t*  th;
+    thinker_t*  copy;
+    mobj_t*     mo;
+    sector_t**  sp;
+    int*        ip;
+    int         type;
+    int         i;
 
-    totalkills = totalitems = totalsecret = wminfo.maxfrags = 0;
-    wminfo.partime = 180;
     for (i=0 ; i<MAXPLAYERS ; i++)
+        if (playeringame[i])
+            snap->playermo[i] = (int)(uintptr_t)P_SnapIndex (players[i].mo);
+
+    // The links into the thinkers, which the image leaves out.
+    ip = (int*)pos;
+    for (i=0 ; i<numsectors ; i++)
     {
-        players[i].killcount = players[i].secretcount
-            = players[i].itemcount = 0;
+        *ip++ = (int)(uintptr_t)P_SnapIndex (sectors[i].thinglist);
+        *ip++ = (int)(uintptr_t)P_SnapIndex (sectors[i].specialdata);
     }
+    pos += SNAP_ALIGN(numsectors*2*sizeof(int));
 
-    // Initial height of PointOfView
-    // will be set by player think.
-    players[consoleplayer].viewz = 1;
+    ip = (int*)pos;
+    for (i=0 ; i<snap->numblocklinks ; i++)
+        *ip++ = (int)(uintptr_t)P_SnapIndex (blocklinks[i]);
+    pos += SNAP_ALIGN(snap->numblocklinks*sizeof(int));
 
-    // Make sure all sounds are stopped before Z_FreeTags.
-    S_Start ();
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+    {
+        if (th->function.acv == (actionf_v)(-1))
+            continue;
 
-#if 0 // UNUSED
-    if (debugfile)
+        type = P_SnapThinkerType (th);
+        *(int*)pos = type;
+        copy = (thinker_t*)(pos + 8);
+        memcpy (copy, th, snapthinkers[type].size);
+        pos += SNAP_RECORD(type);
+
+        // The lists are rebuilt by P_AddThinker.
+        copy->prev = copy->next = copy->cprev = copy->cnext = NULL;
+
+        if (snapthinkers[type].sector == -1)
+        {
+            mo = (mobj_t*)copy;
+            mo->snext = P_SnapIndex (mo->snext);
+            mo->sprev = P_SnapIndex (mo->sprev);
+            mo->bnext = P_SnapIndex (mo->bnext);
+            mo->bprev = P_SnapIndex (mo->bprev);
+            mo->target = P_SnapIndex (mo->target);
+            mo->tracer = P_SnapIndex (mo->tracer);
+            mo->subsector = LC_INDEX (mo->subsector, subsectors);
+        }
+        else
+        {
+            sp = (sector_t**)((byte*)copy + snapthinkers[type].sector);
+            *sp = LC_INDEX (*sp, sectors);
+        }
+    }
+}
+
+//
+// P_SaveSnapshot
+// Called at the end of P_SetupLevel on the slow path.
+//
+static void
+P_SaveSnapshot
+( int           episode,
+  int           map,
+  skill_t       skill,
+  char*         mapname,
+  unsigned      checksum,
+  int           blockmapsize,
+  int           rejectsize )
+{
+    levelsnap_t*        snap;
+    byte*               image;
+    thinker_t*          th;
+    int                 imagesize;
+    int                 numthinkers;
+    int                 thinkersize;
+    int                 size;
+    int                 type;
+
+    P_DropSnapshot ();
+
+    if (!P_SnapshotAllowed (checksum))
+        return;
+
+    numthinkers = 0;
+    thinkersize = 0;
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
     {
-        Z_FreeTags (PU_LEVEL, MAXINT);
-        Z_FileDumpHeap (debugfile);
+        if (th->function.acv == (actionf_v)(-1))
+            continue;
+        type = P_SnapThinkerType (th);
+        if (type == -1)
+            return;
+        numthinkers++;
+        thinkersize += SNAP_RECORD(type);
+    }
+
+    image = P_BuildLevelImage (mapname, checksum, blockmapsize, rejectsize);
+    if (!image)
+        return;
+    imagesize = ((levelcache_t*)image)->size;
+
+    size = SNAP_ALIGN(sizeof(levelsnap_t))
+        + SNAP_ALIGN(imagesize)
+        + SNAP_ALIGN(numsectors*2*sizeof(int))
+        + SNAP_ALIGN(bmapwidth*bmapheight*sizeof(int))
+        + thinkersize;
+
+    snapshot = malloc (size);
+    snaprefs = malloc ((numthinkers+1)*sizeof(*snaprefs));
+    if (!snapshot || !snaprefs)
+    {
+        free (snapshot);
+        snapshot = NULL;
     }
     else
-#endif
-        Z_FreeTags (PU_LEVEL, PU_PURGELEVEL-1);
+    {
+        numsnaprefs = 0;
+        for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+        {
+            if (th->function.acv == (actionf_v)(-1))
+                continue;
+            snaprefs[numsnaprefs].address = (uintptr_t)th;
+            snaprefs[numsnaprefs].index = numsnaprefs;
+            numsnaprefs++;
+        }
+        qsort (snaprefs, numsnaprefs, sizeof(*snaprefs), P_CompareSnapRefs);
+
+        memset (snapshot, 0, size);
+        snap = (levelsnap_t*)snapshot;
+        snap->episode = episode;
+        snap->map = map;
+        snap->skill = skill;
+        snap->nomonsters = nomonsters;
+        snap->fastparm = fastparm;
+        snap->checksum = checksum;
+        snap->imagesize = imagesize;
+        snap->numthinkers = numthinkers;
+        snap->numblocklinks = bmapwidth*bmapheight;
+        snap->totalkills = totalkills;
+        snap->totalitems = totalitems;
+        snap->totalsecret = totalsecret;
+        snap->numdmstarts = deathmatch_p - deathmatchstarts;
+        memcpy (snap->dmstarts, deathmatchstarts, sizeof(snap->dmstarts));
+        memcpy (snap->starts, playerstarts, sizeof(snap->starts));
+        memcpy (snapshot + SNAP_ALIGN(sizeof(levelsnap_t)), image, imagesize);
+
+        snapfailed = false;
+        P_WriteSnapshot (snap, snapshot + SNAP_ALIGN(sizeof(levelsnap_t))
+                         + SNAP_ALIGN(imagesize));
+        if (snapfailed)
+        {
+            free (snapshot);
+            snapshot = NULL;
+        }
+    }
 
-    // UNUSED W_Profile ();
-    P_InitThinkers ();
+    free (snaprefs);
+    snaprefs = NULL;
+    free (image);
+}
 
-    // if working with a devlopment map, reload it
-    W_Reload ();
+//
+// P_RestoreSnapshot
+// Replaces P_SetupLevel from loading the map through
+//  P_SpawnSpecials. Returns false if there is no snapshot
+//  of this level.
+//
+static boolean
+P_RestoreSnapshot
+( int           episode,
+  int           map,
+  skill_t       skill,
+  unsigned      checksum )
+{
+    levelsnap_t*        snap;
+    byte*               pos;
+    byte*               buf;
+    thinker_t**         table;
+    thinker_t*          th;
+    mobj_t*             mo;
+    sector_t**          sp;
+    int*                sectorlinks;
+    int*                blocklinkrefs;
+    int                 type;
+    int                 i;
 
-    // find map name
+    snap = (levelsnap_t*)snapshot;
+    if (!snap
+        || !P_SnapshotAllowed (checksum)
+        || snap->episode != episode
+        || snap->map != map
+        || snap->skill != skill
+        || snap->nomonsters != nomonsters
+        || snap->fastparm != fastparm
+        || snap->checksum != checksum)
+        return false;
+
+    table = malloc ((snap->numthinkers+1)*sizeof(*table));
+    if (!table)
+        return false;
+
+    pos = snapshot + SNAP_ALIGN(sizeof(levelsnap_t));
+    buf = Z_Malloc (snap->imagesize, PU_LEVEL, 0);
+    memcpy (buf, pos, snap->imagesize);
+    P_InstallLevelImage (buf);
+    pos += SNAP_ALIGN(snap->imagesize);
+
+    sectorlinks = (int*)pos;
+    pos += SNAP_ALIGN(numsectors*2*sizeof(int));
+    blocklinkrefs = (int*)pos;
+    pos += SNAP_ALIGN(snap->numblocklinks*sizeof(int));
+
+    // Bring back the thinkers, in the same order.
+    for (i=0 ; i<snap->numthinkers ; i++)
+    {
+        type = *(int*)pos;
+        th = Z_Malloc (snapthinkers[type].size, snapthinkers[type].tag, NULL);
+        memcpy (th, pos + 8, snapthinkers[type].size);
+        P_AddThinker (th, snapthinkers[type].tclass);
+        table[i] = th;
+        pos += SNAP_RECORD(type);
+    }
+
+    for (i=0 ; i<snap->numthinkers ; i++)
+    {
+        th = table[i];
+        type = P_SnapThinkerType (th);
+        if (snapthinkers[type].sector == -1)
+        {
+            mo = (mobj_t*)th;
+            SNAP_RELOC (mo->snext, table);
+            SNAP_RELOC (mo->sprev, table);
+            SNAP_RELOC (mo->bnext, table);
+            SNAP_RELOC (mo->bprev, table);
+            SNAP_RELOC (mo->target, table);
+            SNAP_RELOC (mo->tracer, table);
+            LC_RELOC (mo->subsector, subsectors, numsubsectors);
+        }
+        else
+        {
+            sp = (sector_t**)((byte*)th + snapthinkers[type].sector);
+            LC_RELOC (*sp, sectors, numsectors);
+        }
+    }
+
+    for (i=0 ; i<numsectors ; i++)
+    {
+        sectors[i].thinglist = (mobj_t*)(uintptr_t)sectorlinks[i*2];
+        SNAP_RELOC (sectors[i].thinglist, table);
+        sectors[i].specialdata = (void*)(uintptr_t)sectorlinks[i*2+1];
+        SNAP_RELOC (sectors[i].specialdata, table);
+    }
+
+    for (i=0 ; i<snap->numblocklinks ; i++)
+    {
+        blocklinks[i] = (mobj_t*)(uintptr_t)blocklinkrefs[i];
+        SNAP_RELOC (blocklinks[i], table);
+    }
+
+    totalkills = snap->totalkills;
+    totalitems = snap->totalitems;
+    totalsecret = snap->totalsecret;
+    memcpy (deathmatchstarts, snap->dmstarts, sizeof(snap->dmstarts));
+    deathmatch_p = deathmatchstarts + snap->numdmstarts;
+    memcpy (playerstarts, snap->starts, sizeof(snap->starts));
+    bodyqueslot = 0;
+    iquehead = iquetail = 0;
+
+    // The players are spawned again, so that they come back
+    //  the way P_SpawnPlayer makes them, e.g. after dying.
+    for (i=0 ; i<MAXPLAYERS ; i++)
+    {
+        if (!playeringame[i] || !snap->playermo[i])
+            continue;
+        P_RemoveMobj ((mobj_t*)table[snap->playermo[i]-1]);
+        P_SpawnPlayer (&playerstarts[i]);
+    }
+
+    free (table);
+
+    levelTimer = false;
+    P_InitSpecialLists ();
+
+    return true;
+}
+
+//
+// P_MapLumpName
+// Returns false if there can be no such map.
+//
+boolean
+P_MapLumpName
+( int           episode,
+  int           map,
+  char*         lumpname )
+{
     if ( gamemode == commercial)
     {
         if (map >= 0 && map<10)
@@ -603,7 +1548,7 @@ P_SetupLevel
         else if (map >= 0 && map<100000)
             sprintf (lumpname,"map%i", map);
         else
-            I_Error ("P_SetupLevel: invalid map number: %d", map);
+            return false;
     }
     else
     {
@@ -613,24 +1558,64 @@ P_SetupLevel
         lumpname[3] = '0' + map;
         lumpname[4] = 0;
     }
+    return true;
+}
 
-    lumpnum = W_GetNumForName (lumpname);
-
-    leveltime = 0;
-
-    // note: most of this ordering is important
-    P_LoadBlockMap (lumpnum+ML_BLOCKMAP);
-    P_LoadVertexes (lumpnum+ML_VERTEXES);
-    P_LoadSectors (lumpnum+ML_SECTORS);
-    P_LoadSideDefs (lumpnum+ML_SIDEDEFS);
+//
+// P_LoadLevel
+// The slow path of P_SetupLevel, from the map lumps
+//  or the level cache.
+//
+static void
+P_LoadLevel
+( int           episode,
+  int           map,
+  skill_t       skill,
+  char*         lumpname,
+  int           lumpnum,
+  unsigned      checksum )
+{
+    int         i;
+    char        cachename[32];
+    unsigned    cachesum;
+    boolean     cached;
+    long long   starttime;
+
+    // try the level cache first
+    starttime = I_GetTimeUS ();
+    cachesum = levelcache ? checksum : 0;
+    sprintf (cachename, LEVELCACHENAME"%s.lvc", lumpname);
+    cached = cachesum && P_LoadLevelCache (cachename, lumpname, cachesum);
+
+    if (!cached)
+    {
+        // note: most of this ordering is important
+        P_LoadBlockMap (lumpnum+ML_BLOCKMAP);
+        P_LoadVertexes (lumpnum+ML_VERTEXES);
+        P_LoadSectors (lumpnum+ML_SECTORS);
+        P_LoadSideDefs (lumpnum+ML_SIDEDEFS);
+
+        P_LoadLineDefs (lumpnum+ML_LINEDEFS);
+        P_LoadSubsectors (lumpnum+ML_SSECTORS);
+        P_LoadNodes (lumpnum+ML_NODES);
+        P_LoadSegs (lumpnum+ML_SEGS);
+
+        rejectmatrix = W_CacheLumpNum (lumpnum+ML_REJECT,PU_LEVEL);
+        P_GroupLines ();
+
+        if (cachesum)
+            P_SaveLevelCache (cachename, lumpname, cachesum,
+                              W_LumpLength (lumpnum+ML_BLOCKMAP)/2,
+                              W_LumpLength (lumpnum+ML_REJECT));
+    }
 
-    P_LoadLineDefs (lumpnum+ML_LINEDEFS);
-    P_LoadSubsectors (lumpnum+ML_SSECTORS);
-    P_LoadNodes (lumpnum+ML_NODES);
-    P_LoadSegs (lumpnum+ML_SEGS);
+    if (devparm)
+        fprintf (stderr, "P_SetupLevel: %s %s in %.2f ms\n",
+                 lumpname,
+                 cached ? "loaded from cache" : "parsed",
+                 (I_GetTimeUS () - starttime) / 1000.0);
 
-    rejectmatrix = W_CacheLumpNum (lumpnum+ML_REJECT,PU_LEVEL);
-    P_GroupLines ();
+    P_InitTagLists ();
 
     bodyqueslot = 0;
     deathmatch_p = deathmatchstarts;
@@ -657,10 +1642,97 @@ P_SetupLevel
     // build subsector connect matrix
     //  UNUSED P_ConnectSubsectors ();
 
+    // keep it for a restart
+    P_SaveSnapshot (episode, map, skill, lumpname, checksum,
+                    W_LumpLength (lumpnum+ML_BLOCKMAP)/2,
+                    W_LumpLength (lumpnum+ML_REJECT));
+}
+
+//
+// P_SetupLevel
+//
+void
+P_SetupLevel
+( int           episode,
+  int           map,
+  int           playermask,
+  skill_t       skill)
+{
+    int         i;
+    char        lumpname[9];
+    int         lumpnum;
+    unsigned    checksum;
+    boolean     restored;
+    long long   setuptime;
+
+    // UNUSED.
+    (void)playermask;
+
+    P_ClearRewind ();
+
+    totalkills = totalitems = totalsecret = wminfo.maxfrags = 0;
+    wminfo.partime = 180;
+    for (i=0 ; i<MAXPLAYERS ; i++)
+    {
+        players[i].killcount = players[i].secretcount
+            = players[i].itemcount = 0;
+    }
+
+    // Initial height of PointOfView
+    // will be set by player think.
+    players[consoleplayer].viewz = 1;
+
+    // Make sure all sounds are stopped before Z_FreeTags.
+    S_Start ();
+
+    // Hand over whatever the intermission has read ahead.
+    W_FinishPrefetch ();
+
+#if 0 // UNUSED
+    if (debugfile)
+    {
+        Z_FreeTags (PU_LEVEL, MAXINT);
+        Z_FileDumpHeap (debugfile);
+    }
+    else
+#endif
+        Z_FreeTags (PU_LEVEL, PU_PURGELEVEL-1);
+
+    // UNUSED W_Profile ();
+    P_InitThinkers ();
+
+    // if working with a devlopment map, reload it
+    W_Reload ();
+
+    // find map name
+    if (!P_MapLumpName (episode, map, lumpname))
+        I_Error ("P_SetupLevel: invalid map number: %d", map);
+
+    lumpnum = W_GetNumForName (lumpname);
+
+    leveltime = 0;
+
+    // restarting the same level?
+    setuptime = I_GetTimeUS ();
+    checksum = W_Checksum ();
+    restored = P_RestoreSnapshot (episode, map, skill, checksum);
+    if (restored)
+        P_InitTagLists ();
+    else
+        P_LoadLevel (episode, map, skill, lumpname, lumpnum, checksum);
+
+    fprintf (stderr, "P_SetupLevel: %s set up in %.2f ms%s\n",
+             lumpname,
+             (I_GetTimeUS () - setuptime) / 1000.0,
+             restored ? " from the snapshot" : "");
+
     // preload graphics
     if (precache)
         R_PrecacheLevel ();
 
+    // preload the sounds of the things
+    S_PrecacheLevel ();
+
     //printf ("free memory: 0x%x\n", Z_FreeMemory());
 
 }
@@ -21,6 +21,23 @@
 #ifndef __P_SETUP__
 #define __P_SETUP__
 
+// Set by -levelcache, keep parsed levels in doomlvl*.lvc files
+// in the current directory and load them from there.
+extern boolean levelcache;
+
+// Set by -nosnapshot, always load levels again on a restart.
+extern boolean nolevelsnapshot;
+
+// Forget the level snapshot, so the next level is loaded.
+void P_DropSnapshot (void);
+
+// The lump name of a map, lumpname must hold 9 chars.
+boolean
+P_MapLumpName
+( int           episode,
+  int           map,
+  char*         lumpname );
+
 // NOT called by W_Ticker. Fixme.
 void
 P_SetupLevel
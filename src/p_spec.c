@@ -246,17 +246,12 @@ getNextSector
 fixed_t P_FindLowestFloorSurrounding(sector_t* sec)
 {
     int                 i;
-    line_t*             check;
     sector_t*           other;
     fixed_t             floor = sec->floorheight;
 
-    for (i=0 ;i < sec->linecount ; i++)
+    for (i=0 ;i < sec->neighbourcount ; i++)
     {
-        check = sec->lines[i];
-        other = getNextSector(check,sec);
-
-        if (!other)
-            continue;
+        other = sec->neighbours[i];
 
         if (other->floorheight < floor)
             floor = other->floorheight;
@@ -271,17 +266,12 @@ fixed_t P_FindLowestFloorSurrounding(sector_t* sec)
 fixed_t P_FindHighestFloorSurrounding(sector_t *sec)
 {
     int                 i;
-    line_t*             check;
     sector_t*           other;
     fixed_t             floor = -500*FRACUNIT;
 
-    for (i=0 ;i < sec->linecount ; i++)
+    for (i=0 ;i < sec->neighbourcount ; i++)
     {
-        check = sec->lines[i];
-        other = getNextSector(check,sec);
-
-        if (!other)
-            continue;
+        other = sec->neighbours[i];
 
         if (other->floorheight > floor)
             floor = other->floorheight;
@@ -292,57 +282,34 @@ fixed_t P_FindHighestFloorSurrounding(sector_t *sec)
 //
 // P_FindNextHighestFloor
 // FIND NEXT HIGHEST FLOOR IN SURROUNDING SECTORS
-// Note: this should be doable w/o a fixed array.
-
-// 20 adjoining sectors max!
-#define MAX_ADJOINING_SECTORS           20
-
+//
 fixed_t
 P_FindNextHighestFloor
 ( sector_t*     sec,
   int           currentheight )
 {
     int                 i;
-    int                 h;
-    int                 min;
-    line_t*             check;
     sector_t*           other;
-    fixed_t             height = currentheight;
-
-    fixed_t             heightlist[MAX_ADJOINING_SECTORS];
+    fixed_t             height = MAXINT;
+    boolean             found = false;
 
-    for (i=0, h=0 ;i < sec->linecount ; i++)
+    // Find the lowest floor above the current height.
+    for (i=0 ;i < sec->neighbourcount ; i++)
     {
-        check = sec->lines[i];
-        other = getNextSector(check,sec);
-
-        if (!other)
-            continue;
-
-        if (other->floorheight > height)
-            heightlist[h++] = other->floorheight;
+        other = sec->neighbours[i];
 
-        // Check for overflow. Exit.
-        if ( h >= MAX_ADJOINING_SECTORS )
+        if (other->floorheight > currentheight
+            && other->floorheight <= height)
         {
-            fprintf( stderr,
-                     "Sector with more than 20 adjoining sectors\n" );
-            break;
+            height = other->floorheight;
+            found = true;
         }
     }
 
-    // Find lowest height in list
-    if (!h)
+    if (!found)
         return currentheight;
 
-    min = heightlist[0];
-
-    // Range checking?
-    for (i = 1;i < h;i++)
-        if (heightlist[i] < min)
-            min = heightlist[i];
-
-    return min;
+    return height;
 }
 
 //
@@ -352,17 +319,12 @@ fixed_t
 P_FindLowestCeilingSurrounding(sector_t* sec)
 {
     int                 i;
-    line_t*             check;
     sector_t*           other;
     fixed_t             height = MAXINT;
 
-    for (i=0 ;i < sec->linecount ; i++)
+    for (i=0 ;i < sec->neighbourcount ; i++)
     {
-        check = sec->lines[i];
-        other = getNextSector(check,sec);
-
-        if (!other)
-            continue;
+        other = sec->neighbours[i];
 
         if (other->ceilingheight < height)
             height = other->ceilingheight;
@@ -376,17 +338,12 @@ P_FindLowestCeilingSurrounding(sector_t* sec)
 fixed_t P_FindHighestCeilingSurrounding(sector_t* sec)
 {
     int         i;
-    line_t*     check;
     sector_t*   other;
     fixed_t     height = 0;
 
-    for (i=0 ;i < sec->linecount ; i++)
+    for (i=0 ;i < sec->neighbourcount ; i++)
     {
-        check = sec->lines[i];
-        other = getNextSector(check,sec);
-
-        if (!other)
-            continue;
+        other = sec->neighbours[i];
 
         if (other->ceilingheight > height)
             height = other->ceilingheight;
@@ -394,6 +351,30 @@ fixed_t P_FindHighestCeilingSurrounding(sector_t* sec)
     return height;
 }
 
+//
+// P_InitTagLists
+// Hash the sectors by tag, so that the sectors
+// that a line tag refers to can be found without
+// scanning all sectors. Called at level setup.
+//
+void P_InitTagLists (void)
+{
+    int         i;
+    int         j;
+
+    for (i=0 ; i<numsectors ; i++)
+        sectors[i].firsttag = -1;
+
+    // Insert in reverse order, so that each chain
+    // is sorted by increasing sector number.
+    for (i=numsectors-1 ; i>=0 ; i--)
+    {
+        j = (unsigned)sectors[i].tag % (unsigned)numsectors;
+        sectors[i].nexttag = sectors[j].firsttag;
+        sectors[j].firsttag = i;
+    }
+}
+
 //
 // RETURN NEXT SECTOR # THAT LINE TAG REFERS TO
 //
@@ -404,11 +385,19 @@ P_FindSectorFromLineTag
 {
     int i;
 
-    for (i=start+1;i<numsectors;i++)
-        if (sectors[i].tag == line->tag)
-            return i;
+    // EV_BuildStairs passes a stair step as start, which can
+    // have another tag. Then walk the line's chain from the
+    // head, which is sorted, and skip to the first sector
+    // after start, as the old linear scan did.
+    if (start >= 0 && sectors[start].tag == line->tag)
+        i = sectors[start].nexttag;
+    else
+        i = sectors[(unsigned)line->tag % (unsigned)numsectors].firsttag;
+
+    while (i >= 0 && (sectors[i].tag != line->tag || i <= start))
+        i = sectors[i].nexttag;
 
-    return -1;
+    return i;
 }
 
 //
@@ -421,17 +410,12 @@ P_FindMinSurroundingLight
 {
     int         i;
     int         min;
-    line_t*     line;
     sector_t*   check;
 
     min = max;
-    for (i=0 ; i < sector->linecount ; i++)
+    for (i=0 ; i < sector->neighbourcount ; i++)
     {
-        line = sector->lines[i];
-        check = getNextSector(line,sector);
-
-        if (!check)
-            continue;
+        check = sector->neighbours[i];
 
         if (check->lightlevel < min)
             min = check->lightlevel;
@@ -1140,7 +1124,7 @@ int EV_DoDonut(line_t*  line)
 
             //  Spawn rising slime
             floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
-            P_AddThinker (&floor->thinker);
+            P_AddThinker (&floor->thinker, th_mover);
             s2->specialdata = floor;
             floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
             floor->type = donutRaise;
@@ -1154,7 +1138,7 @@ int EV_DoDonut(line_t*  line)
 
             //  Spawn lowering donut-hole
             floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
-            P_AddThinker (&floor->thinker);
+            P_AddThinker (&floor->thinker, th_mover);
             s1->specialdata = floor;
             floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
             floor->type = lowerFloor;
@@ -1277,6 +1261,21 @@ void P_SpawnSpecials (void)
         }
     }
 
+    P_InitSpecialLists ();
+
+    // UNUSED: no horizonal sliders.
+    //  P_InitSlidingDoorFrames();
+}
+
+//
+// P_InitSpecialLists
+// Finds the line effects and clears the active specials.
+// Also used when a level is restored from a snapshot.
+//
+void P_InitSpecialLists (void)
+{
+    int         i;
+
     //  Init line EFFECTs
     numlinespecials = 0;
     for (i = 0;i < numlines; i++)
@@ -1292,15 +1291,12 @@ void P_SpawnSpecials (void)
     }
 
     //  Init other misc stuff
-    for (i = 0;i < MAXCEILINGS;i++)
+    for (i = 0;i < ACTIVEHASHSIZE;i++)
+    {
         activeceilings[i] = NULL;
-
-    for (i = 0;i < MAXPLATS;i++)
         activeplats[i] = NULL;
+    }
 
     for (i = 0;i < MAXBUTTONS;i++)
         memset(&buttonlist[i],0,sizeof(button_t));
-
-    // UNUSED: no horizonal sliders.
-    //  P_InitSlidingDoorFrames();
 }
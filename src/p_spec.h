@@ -38,6 +38,7 @@ void    P_InitPicAnims (void);
 
 // at map load
 void    P_SpawnSpecials (void);
+void    P_InitSpecialLists (void);
 
 // every tic
 void    P_UpdateSpecials (void);
@@ -90,6 +91,8 @@ P_FindNextHighestFloor
 fixed_t P_FindLowestCeilingSurrounding(sector_t* sec);
 fixed_t P_FindHighestCeilingSurrounding(sector_t* sec);
 
+void    P_InitTagLists (void);
+
 int
 P_FindSectorFromLineTag
 ( line_t*       line,
@@ -162,6 +165,7 @@ typedef struct
 #define FASTDARK                        15
 #define SLOWDARK                        35
 
+void    T_FireFlicker (fireflicker_t* flick);
 void    P_SpawnFireFlicker (sector_t* sector);
 void    T_LightFlash (lightflash_t* flash);
 void    P_SpawnLightFlash (sector_t* sector);
@@ -253,7 +257,7 @@ typedef enum
 
 } plattype_e;
 
-typedef struct
+typedef struct plat_s
 {
     thinker_t   thinker;
     sector_t*   sector;
@@ -268,13 +272,22 @@ typedef struct
     int         tag;
     plattype_e  type;
 
+    // Links in the active plats list of the tag hash.
+    // activeprev is NULL when not in the list.
+    struct plat_s*      activenext;
+    struct plat_s**     activeprev;
+
 } plat_t;
 
 #define PLATWAIT                3
 #define PLATSPEED               FRACUNIT
-#define MAXPLATS                30
 
-extern plat_t*  activeplats[MAXPLATS];
+// Active plats and ceilings are kept in lists
+// hashed by tag, for stasis toggling.
+#define ACTIVEHASHSIZE          64
+#define ACTIVEHASH(tag)         ((unsigned)(tag) % ACTIVEHASHSIZE)
+
+extern plat_t*  activeplats[ACTIVEHASHSIZE];
 
 void    T_PlatRaise(plat_t*     plat);
 
@@ -286,6 +299,7 @@ EV_DoPlat
 
 void    P_AddActivePlat(plat_t* plat);
 void    P_RemoveActivePlat(plat_t* plat);
+boolean P_IsActivePlat(thinker_t* th);
 void    EV_StopPlat(line_t* line);
 void    P_ActivateInStasis(int tag);
 
@@ -436,7 +450,7 @@ typedef enum
 
 } ceiling_e;
 
-typedef struct
+typedef struct ceiling_s
 {
     thinker_t   thinker;
     ceiling_e   type;
@@ -453,13 +467,17 @@ typedef struct
     int         tag;
     int         olddirection;
 
+    // Links in the active ceilings list of the tag hash.
+    // activeprev is NULL when not in the list.
+    struct ceiling_s*   activenext;
+    struct ceiling_s**  activeprev;
+
 } ceiling_t;
 
 #define CEILSPEED               FRACUNIT
 #define CEILWAIT                150
-#define MAXCEILINGS             30
 
-extern ceiling_t*       activeceilings[MAXCEILINGS];
+extern ceiling_t*       activeceilings[ACTIVEHASHSIZE];
 
 int
 EV_DoCeiling
@@ -469,6 +487,7 @@ EV_DoCeiling
 void    T_MoveCeiling (ceiling_t* ceiling);
 void    P_AddActiveCeiling(ceiling_t* c);
 void    P_RemoveActiveCeiling(ceiling_t* c);
+boolean P_IsActiveCeiling(thinker_t* th);
 int     EV_CeilingCrushStop(line_t* line);
 void    P_ActivateInStasisCeiling(line_t* line);
 
@@ -0,0 +1,288 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Sync traces. After every level tic the playsim random
+//      index, the players, the things and the sectors are
+//      hashed, one text line per tic:
+//
+//          gametic rng players things sectors
+//
+//      A trace written with -synctrace from a good build is
+//      checked with -synccheck, typically while playing the
+//      demo headlessly with -skiptic.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_random.h"
+#include "p_local.h"
+#include "r_state.h"
+
+#include "p_sync.h"
+
+static FILE*    tracefile;
+static FILE*    checkfile;
+static char*    checkname;
+
+static int      synctics;
+static long long synctime;              // of the first tic
+
+static const char* syncparts[] =
+{
+    "rng", "players", "things", "sectors"
+};
+
+#define NUMSYNCPARTS    4
+
+//
+// P_InitSync
+//
+void P_InitSync (void)
+{
+    int         p;
+
+    p = M_CheckParm ("-synctrace");
+    if (p && p < myargc-1)
+    {
+        tracefile = fopen (myargv[p+1], "w");
+        if (!tracefile)
+            I_Error ("P_InitSync: couldn't create %s", myargv[p+1]);
+    }
+
+    p = M_CheckParm ("-synccheck");
+    if (p && p < myargc-1)
+    {
+        checkname = myargv[p+1];
+        checkfile = fopen (checkname, "r");
+        if (!checkfile)
+            I_Error ("P_InitSync: couldn't open %s", checkname);
+    }
+}
+
+//
+// P_HashInt
+// FNV-1a, a byte at a time so that it does not depend on endianness.
+//
+static unsigned P_HashInt (unsigned hash, int value)
+{
+    int         i;
+
+    for (i=0 ; i<4 ; i++)
+    {
+        hash = (hash ^ (value & 0xff)) * 16777619u;
+        value >>= 8;
+    }
+    return hash;
+}
+
+#define HASHINIT        2166136261u
+
+static unsigned P_HashPlayers (void)
+{
+    unsigned    hash = HASHINIT;
+    player_t*   player;
+    pspdef_t*   psp;
+    int         i;
+    int         j;
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+    {
+        if (!playeringame[i])
+            continue;
+
+        player = &players[i];
+        hash = P_HashInt (hash, i);
+        hash = P_HashInt (hash, player->playerstate);
+        hash = P_HashInt (hash, player->viewz);
+        hash = P_HashInt (hash, player->viewheight);
+        hash = P_HashInt (hash, player->deltaviewheight);
+        hash = P_HashInt (hash, player->bob);
+        hash = P_HashInt (hash, player->health);
+        hash = P_HashInt (hash, player->armorpoints);
+        hash = P_HashInt (hash, player->armortype);
+        for (j=0 ; j<NUMPOWERS ; j++)
+            hash = P_HashInt (hash, player->powers[j]);
+        for (j=0 ; j<NUMCARDS ; j++)
+            hash = P_HashInt (hash, player->cards[j]);
+        hash = P_HashInt (hash, player->backpack);
+        for (j=0 ; j<MAXPLAYERS ; j++)
+            hash = P_HashInt (hash, player->frags[j]);
+        hash = P_HashInt (hash, player->readyweapon);
+        hash = P_HashInt (hash, player->pendingweapon);
+        for (j=0 ; j<NUMWEAPONS ; j++)
+            hash = P_HashInt (hash, player->weaponowned[j]);
+        for (j=0 ; j<NUMAMMO ; j++)
+        {
+            hash = P_HashInt (hash, player->ammo[j]);
+            hash = P_HashInt (hash, player->maxammo[j]);
+        }
+        hash = P_HashInt (hash, player->attackdown);
+        hash = P_HashInt (hash, player->usedown);
+        hash = P_HashInt (hash, player->cheats);
+        hash = P_HashInt (hash, player->refire);
+        hash = P_HashInt (hash, player->killcount);
+        hash = P_HashInt (hash, player->itemcount);
+        hash = P_HashInt (hash, player->secretcount);
+        hash = P_HashInt (hash, player->damagecount);
+        hash = P_HashInt (hash, player->bonuscount);
+        hash = P_HashInt (hash, player->extralight);
+        hash = P_HashInt (hash, player->fixedcolormap);
+        for (j=0, psp=player->psprites ; j<NUMPSPRITES ; j++, psp++)
+        {
+            hash = P_HashInt (hash, psp->state ? psp->state - states : -1);
+            hash = P_HashInt (hash, psp->tics);
+            hash = P_HashInt (hash, psp->sx);
+            hash = P_HashInt (hash, psp->sy);
+        }
+    }
+    return hash;
+}
+
+static unsigned P_HashThings (void)
+{
+    unsigned    hash = HASHINIT;
+    thinker_t*  th;
+    mobj_t*     mo;
+
+    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    {
+        if (th->function.acp1 != (actionf_p1)P_MobjThinker)
+            continue;
+
+        mo = (mobj_t*)th;
+        hash = P_HashInt (hash, mo->type);
+        hash = P_HashInt (hash, mo->x);
+        hash = P_HashInt (hash, mo->y);
+        hash = P_HashInt (hash, mo->z);
+        hash = P_HashInt (hash, mo->angle);
+        hash = P_HashInt (hash, mo->momx);
+        hash = P_HashInt (hash, mo->momy);
+        hash = P_HashInt (hash, mo->momz);
+        hash = P_HashInt (hash, mo->floorz);
+        hash = P_HashInt (hash, mo->ceilingz);
+        hash = P_HashInt (hash, mo->state - states);
+        hash = P_HashInt (hash, mo->tics);
+        hash = P_HashInt (hash, mo->flags);
+        hash = P_HashInt (hash, mo->health);
+        hash = P_HashInt (hash, mo->movedir);
+        hash = P_HashInt (hash, mo->movecount);
+        hash = P_HashInt (hash, mo->reactiontime);
+        hash = P_HashInt (hash, mo->threshold);
+        hash = P_HashInt (hash, mo->lastlook);
+        hash = P_HashInt (hash, mo->target ? (int)mo->target->type : -1);
+    }
+    return hash;
+}
+
+static unsigned P_HashSectors (void)
+{
+    unsigned    hash = HASHINIT;
+    sector_t*   sec;
+    int         i;
+
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+    {
+        hash = P_HashInt (hash, sec->floorheight);
+        hash = P_HashInt (hash, sec->ceilingheight);
+        hash = P_HashInt (hash, sec->floorpic);
+        hash = P_HashInt (hash, sec->ceilingpic);
+        hash = P_HashInt (hash, sec->lightlevel);
+        hash = P_HashInt (hash, sec->special);
+        hash = P_HashInt (hash, sec->soundtraversed);
+        hash = P_HashInt (hash, sec->specialdata != NULL);
+    }
+    return hash;
+}
+
+//
+// P_SyncTicker
+//
+void P_SyncTicker (void)
+{
+    unsigned    hashes[NUMSYNCPARTS];
+    unsigned    expected[NUMSYNCPARTS];
+    int         tic;
+    int         i;
+
+    if (!tracefile && !checkfile)
+        return;
+
+    if (!synctics++)
+        synctime = I_GetTimeUS ();
+
+    // Only the playsim index: M_Random also runs for the menus,
+    // the status bar and the screen wipes, which may differ
+    // between builds without a desync.
+    hashes[0] = P_HashInt (HASHINIT, prndindex);
+    hashes[1] = P_HashPlayers ();
+    hashes[2] = P_HashThings ();
+    hashes[3] = P_HashSectors ();
+
+    if (tracefile)
+        fprintf (tracefile, "%i %08x %08x %08x %08x\n", gametic,
+                 hashes[0], hashes[1], hashes[2], hashes[3]);
+
+    if (!checkfile)
+        return;
+
+    if (fscanf (checkfile, "%i %x %x %x %x", &tic,
+                &expected[0], &expected[1], &expected[2], &expected[3]) != 5)
+        I_Error ("P_SyncTicker: %s ends before tic %i", checkname, gametic);
+
+    if (tic != gametic)
+        I_Error ("P_SyncTicker: tic %i in %s, but the game is at tic %i",
+                 tic, checkname, gametic);
+
+    for (i=0 ; i<NUMSYNCPARTS ; i++)
+    {
+        if (hashes[i] != expected[i])
+            I_Error ("P_SyncTicker: %s differ at tic %i (%08x, not %08x)",
+                     syncparts[i], gametic, hashes[i], expected[i]);
+    }
+}
+
+//
+// P_CloseSync
+//
+void P_CloseSync (void)
+{
+    long long   time;
+    int         tic;
+
+    if (!tracefile && !checkfile)
+        return;
+
+    time = I_GetTimeUS () - synctime;
+    fprintf (stderr, "P_CloseSync: %s %i tics, %lli tics/s\n",
+             checkfile ? "checked" : "traced", synctics,
+             time > 0 ? synctics*1000000LL/time : 0);
+
+    // a run that ends early must not pass
+    if (checkfile && fscanf (checkfile, "%i", &tic) == 1)
+        I_Error ("P_CloseSync: %s goes on to tic %i, which was not played",
+                 checkname, tic);
+
+    if (tracefile)
+        fclose (tracefile);
+    if (checkfile)
+        fclose (checkfile);
+    tracefile = checkfile = NULL;
+}
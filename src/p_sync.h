@@ -0,0 +1,34 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Per tic hashes of the game state, written to a trace
+//      or checked against one to catch demo desyncs.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __P_SYNC__
+#define __P_SYNC__
+
+// Opens -synctrace <file> for writing or -synccheck <file>.
+void    P_InitSync (void);
+
+// Called after P_Ticker, I_Error on the first tic that differs.
+void    P_SyncTicker (void);
+
+// Reports how many tics were traced and how fast.
+void    P_CloseSync (void);
+
+#endif  // __P_SYNC__
@@ -37,35 +37,69 @@ int     leveltime;
 // Both the head and tail of the thinker list.
 thinker_t       thinkercap;
 
+// Both the head and tail of the per class thinker lists.
+// The order within a class list is the same as in thinkercap.
+thinker_t       thinkerclasscap[NUMTHCLASSES];
+
+// The gametic that the old positions in mobjs, players and sectors
+// were stored at, -1 if they are not valid.
+int             oldstatetic = -1;
+
 //
 // P_InitThinkers
 //
 void P_InitThinkers (void)
 {
+    int         i;
+
     thinkercap.prev = thinkercap.next  = &thinkercap;
+    oldstatetic = -1;
+
+    for (i=0 ; i<NUMTHCLASSES ; i++)
+        thinkerclasscap[i].cprev = thinkerclasscap[i].cnext = &thinkerclasscap[i];
 }
 
 //
 // P_AddThinker
-// Adds a new thinker at the end of the list.
+// Adds a new thinker at the end of the list,
+// and at the end of the list of its class.
 //
-void P_AddThinker (thinker_t* thinker)
+void P_AddThinker (thinker_t* thinker, thclass_t tclass)
 {
+    thinker_t*  cap;
+
     thinkercap.prev->next = thinker;
     thinker->next = &thinkercap;
     thinker->prev = thinkercap.prev;
     thinkercap.prev = thinker;
+
+    cap = &thinkerclasscap[tclass];
+    cap->cprev->cnext = thinker;
+    thinker->cnext = cap;
+    thinker->cprev = cap->cprev;
+    cap->cprev = thinker;
 }
 
 //
 // P_RemoveThinker
 // Deallocation is lazy -- it will not actually be freed
-// until its thinking turn comes up.
+// until its thinking turn comes up. It is taken out of
+// its class list right away though, so class scans never
+// see removed thinkers. Its own links are left alone,
+// so a scan that removes the current thinker can still
+// go on to the next one.
 //
 void P_RemoveThinker (thinker_t* thinker)
 {
+  // already removed, its neighbours may have moved on
+  if (thinker->function.acv == (actionf_v)(-1))
+      return;
+
   // FIXME: NOP.
   thinker->function.acv = (actionf_v)(-1);
+
+  thinker->cnext->cprev = thinker->cprev;
+  thinker->cprev->cnext = thinker->cnext;
 }
 
 //
@@ -104,6 +138,40 @@ void P_RunThinkers (void)
     }
 }
 
+//
+// P_StoreOldState
+// Remembers where everything is at the start of the tic,
+// so the renderer can draw views in between tics.
+//
+void P_StoreOldState (void)
+{
+    thinker_t*  th;
+    mobj_t*     mo;
+    sector_t*   sec;
+    int         i;
+
+    for (th = thinkerclasscap[th_mobj].cnext ; th != &thinkerclasscap[th_mobj] ; th=th->cnext)
+    {
+        mo = (mobj_t *)th;
+        mo->oldx = mo->x;
+        mo->oldy = mo->y;
+        mo->oldz = mo->z;
+        mo->oldangle = mo->angle;
+    }
+
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+    {
+        sec->oldfloorheight = sec->floorheight;
+        sec->oldceilingheight = sec->ceilingheight;
+    }
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+        if (playeringame[i])
+            players[i].oldviewz = players[i].viewz;
+
+    oldstatetic = gametic;
+}
+
 //
 // P_Ticker
 //
@@ -125,6 +193,8 @@ void P_Ticker (void)
         return;
     }
 
+    P_StoreOldState ();
+
     for (i=0 ; i<MAXPLAYERS ; i++)
         if (playeringame[i])
             P_PlayerThink (&players[i]);
@@ -26,4 +26,8 @@
 // Carries out all thinking of monsters and players.
 void P_Ticker (void);
 
+// The gametic when P_Ticker last stored the old positions
+// of things and planes, -1 if they are not valid.
+extern int oldstatetic;
+
 #endif  // __P_TICK__
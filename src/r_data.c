@@ -780,10 +780,11 @@ void R_PrecacheLevel (void)
     spritepresent = malloc(numsprites);
     memset (spritepresent,0, numsprites);
 
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    for (th = thinkerclasscap[th_mobj].cnext ;
+         th != &thinkerclasscap[th_mobj] ;
+         th=th->cnext)
     {
-        if (th->function.acp1 == (actionf_p1)P_MobjThinker)
-            spritepresent[((mobj_t *)th)->sprite] = 1;
+        spritepresent[((mobj_t *)th)->sprite] = 1;
     }
 
     spritememory = 0;
@@ -809,3 +810,150 @@ void R_PrecacheLevel (void)
     free(flatpresent);
 }
 
+
+//
+// R_PrefetchLevel
+// Starts reading a level in the background, e.g. during the
+//  intermission before it. The map lumps are read first, then
+//  R_UpdatePrefetch goes through them for the graphics.
+//
+static int      prefetchmap = -1;
+
+void R_PrefetchLevel (int maplump)
+{
+    int         lumps[ML_BLOCKMAP];
+    int         i;
+
+    for (i=0 ; i<ML_BLOCKMAP ; i++)
+        lumps[i] = maplump + ML_THINGS + i;
+
+    W_StartPrefetch (lumps, ML_BLOCKMAP);
+    prefetchmap = maplump;
+}
+
+//
+// R_UpdatePrefetch
+// Once the map lumps are in, queues the flats, wall patches
+//  and sprites that R_PrecacheLevel will want for the level.
+//  The sky texture depends on the level, it is left out.
+//
+void R_UpdatePrefetch (void)
+{
+    char*               want;
+    int*                lumps;
+    int                 count;
+
+    int                 i;
+    int                 j;
+    int                 k;
+    int                 n;
+    int                 lump;
+    char                name[9];
+
+    mapsector_t*        ms;
+    mapsidedef_t*       msd;
+    mapthing_t*         mt;
+    texture_t*          texture;
+    spriteframe_t*      sf;
+
+    W_UpdatePrefetch ();
+
+    if (prefetchmap == -1 || !W_PrefetchDone ())
+        return;
+
+    lump = prefetchmap;
+    prefetchmap = -1;
+
+    want = malloc (numlumps + numtextures + numsprites);
+    lumps = malloc (numlumps*sizeof(*lumps));
+    if (!want || !lumps)
+    {
+        free (want);
+        free (lumps);
+        return;
+    }
+    memset (want, 0, numlumps + numtextures + numsprites);
+
+    // Each map lump is used up before the next one is cached,
+    //  which may purge it.
+    name[8] = 0;
+    n = W_LumpLength (lump+ML_SECTORS) / sizeof(mapsector_t);
+    ms = W_CacheLumpNum (lump+ML_SECTORS, PU_CACHE);
+    for (i=0 ; i<n ; i++)
+    {
+        memcpy (name, ms[i].floorpic, 8);
+        j = W_CheckNumForName (name);
+        if (j >= firstflat && j < firstflat+numflats)
+            want[j] = 1;
+        memcpy (name, ms[i].ceilingpic, 8);
+        j = W_CheckNumForName (name);
+        if (j >= firstflat && j < firstflat+numflats)
+            want[j] = 1;
+    }
+
+    n = W_LumpLength (lump+ML_SIDEDEFS) / sizeof(mapsidedef_t);
+    msd = W_CacheLumpNum (lump+ML_SIDEDEFS, PU_CACHE);
+    for (i=0 ; i<n ; i++)
+    {
+        for (k=0 ; k<3 ; k++)
+        {
+            memcpy (name, k == 0 ? msd[i].toptexture
+                    : k == 1 ? msd[i].midtexture
+                    : msd[i].bottomtexture, 8);
+            j = R_CheckTextureNumForName (name);
+            if (j > 0)
+                want[numlumps + j] = 1;
+        }
+    }
+
+    n = W_LumpLength (lump+ML_THINGS) / sizeof(mapthing_t);
+    mt = W_CacheLumpNum (lump+ML_THINGS, PU_CACHE);
+    want[numlumps + numtextures + states[mobjinfo[MT_PLAYER].spawnstate].sprite] = 1;
+    for (i=0 ; i<n ; i++)
+    {
+        for (j=0 ; j<NUMMOBJTYPES ; j++)
+        {
+            if (mobjinfo[j].doomednum == SHORT(mt[i].type))
+            {
+                want[numlumps + numtextures
+                     + states[mobjinfo[j].spawnstate].sprite] = 1;
+                break;
+            }
+        }
+    }
+
+    for (i=0 ; i<numtextures ; i++)
+    {
+        if (!want[numlumps + i])
+            continue;
+
+        texture = textures[i];
+        for (j=0 ; j<texture->patchcount ; j++)
+            want[texture->patches[j].patch] = 1;
+    }
+
+    for (i=0 ; i<numsprites ; i++)
+    {
+        if (!want[numlumps + numtextures + i])
+            continue;
+
+        for (j=0 ; j<sprites[i].numframes ; j++)
+        {
+            sf = &sprites[i].spriteframes[j];
+            for (k=0 ; k<8 ; k++)
+                want[firstspritelump + sf->lump[k]] = 1;
+        }
+    }
+
+    count = 0;
+    for (i=0 ; i<numlumps ; i++)
+    {
+        if (want[i])
+            lumps[count++] = i;
+    }
+
+    W_StartPrefetch (lumps, count);
+
+    free (lumps);
+    free (want);
+}
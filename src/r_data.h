@@ -35,6 +35,10 @@ R_GetColumn
 void R_InitData (void);
 void R_PrecacheLevel (void);
 
+// Background reading of the next level.
+void R_PrefetchLevel (int maplump);
+void R_UpdatePrefetch (void);
+
 // Retrieval.
 // Floor/ceiling opaque texture tiles,
 // lookup by name. For animation?
@@ -82,16 +82,26 @@ typedef struct
 // The SECTORS record, at runtime.
 // Stores things/mobjs.
 //
-typedef struct
+typedef struct sector_s
 {
     fixed_t     floorheight;
     fixed_t     ceilingheight;
+
+    // Heights at the start of the tic, for render interpolation.
+    fixed_t     oldfloorheight;
+    fixed_t     oldceilingheight;
     short       floorpic;
     short       ceilingpic;
     short       lightlevel;
     short       special;
     short       tag;
 
+    // Sector numbers of the tag hash chains, -1 terminated.
+    // firsttag is the head of the chain for the tags that hash
+    //  to this sector number, nexttag links sectors in a chain.
+    int         firsttag;
+    int         nexttag;
+
     // 0 = untraversed, 1,2 = sndlines -1
     int         soundtraversed;
 
@@ -116,6 +126,14 @@ typedef struct
     int                 linecount;
     struct line_s**     lines;  // [linecount] size
 
+    // Unique sectors across the two sided lines.
+    int                 neighbourcount;
+    struct sector_s**   neighbours;     // [neighbourcount] size
+
+    // Two sided lines that sound can flood through.
+    int                 soundlinecount;
+    struct line_s**     soundlines;     // [soundlinecount] size
+
 } sector_t;
 
 //
@@ -187,6 +205,10 @@ typedef struct line_s
     // if == validcount, already checked
     int         validcount;
 
+    // Cached (openrange > 0) for sound flooding,
+    //  -1 when a sector on either side has moved.
+    int         soundopen;
+
     // thinker_t for reversable actions
     void*       specialdata;
 } line_t;
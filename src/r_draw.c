@@ -672,6 +672,18 @@ R_VideoErase
   //  a 32bit CPU, as GNU GCC/Linux libc did
   //  at one point.
     memcpy (screens[0]+ofs, screens[1]+ofs, count);
+
+    if (count > 0)
+    {
+        int     x = ofs % SCREENWIDTH;
+        int     y = ofs / SCREENWIDTH;
+
+        if (x + count <= SCREENWIDTH)
+            V_MarkRect (x, y, count, 1);
+        else
+            V_MarkRect (0, y, SCREENWIDTH,
+                        (ofs + count - 1) / SCREENWIDTH - y + 1);
+    }
 }
 
 //
@@ -679,12 +691,6 @@ R_VideoErase
 // Draws the border around the view
 //  for different size windows?
 //
-void
-V_MarkRect
-( int           x,
-  int           y,
-  int           width,
-  int           height );
 
 void R_DrawViewBorder (void)
 {
@@ -23,13 +23,18 @@
 #include <stdlib.h>
 
 #include "doomdef.h"
+#include "doomstat.h"
 #include "d_net.h"
 
 #include "m_bbox.h"
 
+#include "p_tick.h"
+
 #include "r_local.h"
 #include "r_sky.h"
 
+#include "z_zone.h"
+
 #include "st_stuff.h"
 
 // Fineangles in the SCREENWIDTH wide window.
@@ -68,6 +73,13 @@ fixed_t                 viewsin;
 
 player_t*               viewplayer;
 
+// How far between the old and the current game state the view
+// is drawn. FRACUNIT draws the current state.
+fixed_t                 interpfrac = FRACUNIT;
+
+// The real sector heights while interpolated ones are drawn.
+static fixed_t*         realheights;
+
 //
 // precalculated math tables
 //
@@ -102,6 +114,71 @@ int                     extralight;
 
 void (*colfunc) (void);
 
+//
+// R_Interpolate
+// Returns the value at interpfrac between old and cur.
+//
+fixed_t
+R_Interpolate
+( fixed_t       old,
+  fixed_t       cur )
+{
+    if (interpfrac == FRACUNIT)
+        return cur;
+    return old + FixedMul (cur - old, interpfrac);
+}
+
+angle_t
+R_InterpolateAngle
+( angle_t       old,
+  angle_t       cur )
+{
+    if (interpfrac == FRACUNIT)
+        return cur;
+    // take the short way around
+    return old + (angle_t)FixedMul ((int)(cur - old), interpfrac);
+}
+
+//
+// R_InterpolateSectors
+// Moves the floors and ceilings to where they are
+// at interpfrac, remembering where they really are.
+//
+static void R_InterpolateSectors (void)
+{
+    sector_t*   sec;
+    fixed_t*    real;
+    int         i;
+
+    if (!realheights)
+        Z_Malloc (numsectors*2*sizeof(*realheights), PU_LEVEL, &realheights);
+
+    real = realheights;
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+    {
+        *real++ = sec->floorheight;
+        *real++ = sec->ceilingheight;
+        sec->floorheight = R_Interpolate (sec->oldfloorheight,
+                                          sec->floorheight);
+        sec->ceilingheight = R_Interpolate (sec->oldceilingheight,
+                                            sec->ceilingheight);
+    }
+}
+
+static void R_RestoreSectors (void)
+{
+    sector_t*   sec;
+    fixed_t*    real;
+    int         i;
+
+    real = realheights;
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+    {
+        sec->floorheight = *real++;
+        sec->ceilingheight = *real++;
+    }
+}
+
 //
 // R_AddPointToBox
 // Expand a given bbox
@@ -710,12 +787,13 @@ void R_SetupFrame (player_t* player)
     int         i;
 
     viewplayer = player;
-    viewx = player->mo->x;
-    viewy = player->mo->y;
-    viewangle = player->mo->angle + viewangleoffset;
+    viewx = R_Interpolate (player->mo->oldx, player->mo->x);
+    viewy = R_Interpolate (player->mo->oldy, player->mo->y);
+    viewangle = R_InterpolateAngle (player->mo->oldangle, player->mo->angle)
+              + viewangleoffset;
     extralight = player->extralight;
 
-    viewz = player->viewz;
+    viewz = R_Interpolate (player->oldviewz, player->viewz);
 
     viewsin = finesine[viewangle>>ANGLETOFINESHIFT];
     viewcos = finecosine[viewangle>>ANGLETOFINESHIFT];
@@ -745,6 +823,12 @@ void R_SetupFrame (player_t* player)
 //
 void R_RenderPlayerView (player_t* player)
 {
+    // the old state is only good for the tic that was run last
+    if (oldstatetic != gametic-1)
+        interpfrac = FRACUNIT;
+    if (interpfrac != FRACUNIT)
+        R_InterpolateSectors ();
+
     R_SetupFrame (player);
 
     // Clear buffers.
@@ -769,6 +853,9 @@ void R_RenderPlayerView (player_t* player)
 
     R_DrawMasked ();
 
+    if (interpfrac != FRACUNIT)
+        R_RestoreSectors ();
+
     // Check for new console commands.
     NetUpdate ();
 }
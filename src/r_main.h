@@ -113,6 +113,20 @@ R_PointToDist
 
 fixed_t R_ScaleFromGlobalAngle (angle_t visangle);
 
+// Interpolation between the state at the start of the tic
+// and the current state, for drawing in between tics.
+extern fixed_t          interpfrac;
+
+fixed_t
+R_Interpolate
+( fixed_t       old,
+  fixed_t       cur );
+
+angle_t
+R_InterpolateAngle
+( angle_t       old,
+  angle_t       cur );
+
 subsector_t*
 R_PointInSubsector
 ( fixed_t       x,
@@ -420,6 +420,11 @@ R_DrawVisSprite
 //
 void R_ProjectSprite (mobj_t* thing)
 {
+    fixed_t             thingx;
+    fixed_t             thingy;
+    fixed_t             thingz;
+    angle_t             thingangle;
+
     fixed_t             tr_x;
     fixed_t             tr_y;
 
@@ -448,9 +453,15 @@ void R_ProjectSprite (mobj_t* thing)
     angle_t             ang;
     fixed_t             iscale;
 
+    // where it is at this point between tics
+    thingx = R_Interpolate (thing->oldx, thing->x);
+    thingy = R_Interpolate (thing->oldy, thing->y);
+    thingz = R_Interpolate (thing->oldz, thing->z);
+    thingangle = R_InterpolateAngle (thing->oldangle, thing->angle);
+
     // transform the origin point
-    tr_x = thing->x - viewx;
-    tr_y = thing->y - viewy;
+    tr_x = thingx - viewx;
+    tr_y = thingy - viewy;
 
     gxt = FixedMul(tr_x,viewcos);
     gyt = -FixedMul(tr_y,viewsin);
@@ -488,8 +499,8 @@ void R_ProjectSprite (mobj_t* thing)
     if (sprframe->rotate)
     {
         // choose a different rotation based on player view
-        ang = R_PointToAngle (thing->x, thing->y);
-        rot = (ang-thing->angle+(unsigned)(ANG45/2)*9)>>29;
+        ang = R_PointToAngle (thingx, thingy);
+        rot = (ang-thingangle+(unsigned)(ANG45/2)*9)>>29;
         lump = sprframe->lump[rot];
         flip = (boolean)sprframe->flip[rot];
     }
@@ -519,10 +530,10 @@ void R_ProjectSprite (mobj_t* thing)
     vis = R_NewVisSprite ();
     vis->mobjflags = thing->flags;
     vis->scale = xscale;
-    vis->gx = thing->x;
-    vis->gy = thing->y;
-    vis->gz = thing->z;
-    vis->gzt = thing->z + spritetopoffset[lump];
+    vis->gx = thingx;
+    vis->gy = thingy;
+    vis->gz = thingz;
+    vis->gzt = thingz + spritetopoffset[lump];
     vis->texturemid = vis->gzt - viewz;
     vis->x1 = x1 < 0 ? 0 : x1;
     vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;
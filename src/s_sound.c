@@ -19,6 +19,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "i_system.h"
 #include "i_sound.h"
@@ -86,6 +87,10 @@ static boolean          mus_paused;
 // music currently being played
 static musicinfo_t*     mus_playing = NULL;
 
+// the last music change while seeking, made when it ends
+static int              mus_pending;
+static boolean          mus_pendinglooping;
+
 // following is set by the defaults code in M_misc:
 // number of channels available
 int                     numChannels;
@@ -194,6 +199,35 @@ void S_Start(void)
   nextcleanup = 15;
 }
 
+//
+// S_PrecacheLevel
+// Loads the sounds that the things on the level can make,
+//  so they are ready when first played.
+//
+void S_PrecacheLevel(void)
+{
+  boolean       sfxpresent[NUMSFX];
+  thinker_t*    th;
+  mobjinfo_t*   info;
+  int           i;
+
+  memset (sfxpresent,0,sizeof(sfxpresent));
+
+  for (th = thinkerclasscap[th_mobj].cnext ; th != &thinkerclasscap[th_mobj] ; th=th->cnext)
+  {
+    info = ((mobj_t *)th)->info;
+    sfxpresent[info->seesound] = true;
+    sfxpresent[info->attacksound] = true;
+    sfxpresent[info->painsound] = true;
+    sfxpresent[info->deathsound] = true;
+    sfxpresent[info->activesound] = true;
+  }
+
+  for (i=1 ; i<NUMSFX ; i++)
+    if (sfxpresent[i])
+      I_PrecacheSound(i);
+}
+
 void
 S_StartSoundAtVolume
 ( void*         origin_p,
@@ -219,6 +253,10 @@ S_StartSoundAtVolume
   if (sfx_id < 1 || sfx_id > NUMSFX)
     I_Error("Bad sfx #: %d", sfx_id);
 
+  // nothing is heard while seeking
+  if (gametic < seektic)
+    return;
+
   sfx = &S_sfx[sfx_id];
 
   // Initialize sound parameters
@@ -378,6 +416,14 @@ void S_UpdateSounds(void* listener_p)
 
     mobj_t*     listener = (mobj_t*)listener_p;
 
+    // a seek has ended
+    if (mus_pending)
+    {
+        cnum = mus_pending;
+        mus_pending = 0;
+        S_ChangeMusic (cnum, mus_pendinglooping);
+    }
+
     for (cnum=0 ; cnum<numChannels ; cnum++)
     {
         c = &channels[cnum];
@@ -483,6 +529,13 @@ S_ChangeMusic
     else
         music = &S_music[musicnum];
 
+    if (gametic < seektic)
+    {
+        mus_pending = musicnum;
+        mus_pendinglooping = looping;
+        return;
+    }
+
     if (mus_playing == music)
         return;
 
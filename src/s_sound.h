@@ -38,6 +38,12 @@ S_Init
 //
 void S_Start(void);
 
+//
+// Per level startup code, after the things are spawned.
+// Loads the sounds that they can make.
+//
+void S_PrecacheLevel(void);
+
 //
 // Start sound for thing at <origin>
 //  using <sound_id> from sounds.h
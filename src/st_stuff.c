@@ -38,6 +38,7 @@
 
 #include "p_local.h"
 #include "p_inter.h"
+#include "p_rewind.h"
 
 #include "am_map.h"
 #include "m_cheat.h"
@@ -442,6 +443,18 @@ unsigned char   cheat_mypos_seq[] =
     0xb2, 0x26, 0xb6, 0xba, 0x2a, 0xf6, 0xea, 0xff      // idmypos
 };
 
+// rewind to a snapshot, 00 for the newest
+unsigned char   cheat_rewind_seq[] =
+{
+    0xb2, 0x26, 0x6a, 0xee, 0x26, 1, 0, 0, 0xff         // idrwd##
+};
+
+// list where two snapshots differ
+unsigned char   cheat_diff_seq[] =
+{
+    0xb2, 0x26, 0x26, 0xb2, 0x66, 0x66, 1, 0, 0, 0, 0, 0xff  // iddiff####
+};
+
 // Now what?
 cheatseq_t      cheat_mus = { cheat_mus_seq, 0 };
 cheatseq_t      cheat_god = { cheat_god_seq, 0 };
@@ -464,6 +477,8 @@ cheatseq_t      cheat_powerup[7] =
 cheatseq_t      cheat_choppers = { cheat_choppers_seq, 0 };
 cheatseq_t      cheat_clev = { cheat_clev_seq, 0 };
 cheatseq_t      cheat_mypos = { cheat_mypos_seq, 0 };
+cheatseq_t      cheat_rewind = { cheat_rewind_seq, 0 };
+cheatseq_t      cheat_diff = { cheat_diff_seq, 0 };
 
 //
 extern char*    mapnames[];
@@ -657,6 +672,29 @@ ST_Responder (event_t* ev)
                 players[consoleplayer].mo->y);
         plyr->message = buf;
       }
+      // 'rwd' rewinds to a snapshot
+      else if (cht_CheckCheat(&cheat_rewind, ev->data1))
+      {
+        char            buf[3];
+
+        cht_GetParam(&cheat_rewind, buf);
+        G_Rewind ((buf[0] - '0')*10 + buf[1] - '0');
+      }
+      // 'diff' lists where two snapshots differ
+      else if (cht_CheckCheat(&cheat_diff, ev->data1))
+      {
+        char            buf[5];
+        int             back1;
+        int             back2;
+
+        cht_GetParam(&cheat_diff, buf);
+        back1 = (buf[0] - '0')*10 + buf[1] - '0';
+        back2 = (buf[2] - '0')*10 + buf[3] - '0';
+        if (P_DiffSnapshots (back1, back2) < 0)
+          plyr->message = STSTR_NOREWIND;
+        else
+          plyr->message = STSTR_DIFF;
+      }
     }
 
     // 'clev' change-level cheat
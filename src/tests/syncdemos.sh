@@ -0,0 +1,92 @@
+#!/bin/sh
+#
+# Plays every demo in a list headlessly and checks it against its
+# sync trace. Each demo is then played twice in one process, which
+# must give the same trace twice.
+#
+# Usage: syncdemos.sh [-write] mc1doom waddir list
+#
+# -write writes the traces instead, with a known good build.
+#
+# Exits with 77, which ctest reports as skipped, when no IWAD
+# directory is given, or when a demo has no trace. Such a demo is
+# still played twice.
+
+WRITE=0
+if [ "$1" = "-write" ] ; then
+    WRITE=1
+    shift
+fi
+
+EXE_FILE="$1"
+WAD_DIR="$2"
+LIST_FILE="$3"
+
+if [ -z "${WAD_DIR}" ] ; then
+    echo "No IWAD configured (DOOM_WADDIR with a HEADLESS build), skipped."
+    exit 77
+fi
+
+LIST_DIR=$( cd -- "$( dirname -- "${LIST_FILE}" )" && pwd )
+cd "${LIST_DIR}" || exit 1
+
+# Keep the demo runs away from the user's .doomrc.
+HOME=$( mktemp -d ) || exit 1
+export HOME
+export DOOMWADDIR="${WAD_DIR}"
+
+FAILED=0
+MISSING=0
+while read -r DEMO TRACE ARGS ; do
+    case "${DEMO}" in
+        ""|\#*) continue ;;
+    esac
+
+    if [ ${WRITE} -ne 0 ] ; then
+        MODE=-synctrace
+        echo "${DEMO}: writing ${TRACE}"
+    elif [ -f "${TRACE}" ] ; then
+        MODE=-synccheck
+    else
+        MODE=
+        echo "${DEMO}: no trace ${TRACE}, not checked"
+        MISSING=1
+    fi
+
+    # shellcheck disable=SC2086
+    if [ -n "${MODE}" ] &&
+       ! "${EXE_FILE}" -playdemo "${DEMO}" -skiptic 999999 ${MODE} "${TRACE}" ${ARGS} < /dev/null ; then
+        echo "${DEMO}: FAILED"
+        FAILED=1
+        continue
+    fi
+
+    # Played twice in one process, the demo must give the same
+    # trace twice: nothing may carry over from the first game,
+    # such as a snapshot of the level.
+    TWICE="${HOME}/twice.trc"
+    # shellcheck disable=SC2086
+    if ! "${EXE_FILE}" -playdemo "${DEMO}" "${DEMO}" -skiptic 999999 -synctrace "${TWICE}" ${ARGS} < /dev/null ; then
+        echo "${DEMO}: FAILED when played twice"
+        FAILED=1
+        continue
+    fi
+    TICS=$( wc -l < "${TWICE}" )
+    HALF=$(( TICS / 2 ))
+    head -n "${HALF}" "${TWICE}" | cut -d ' ' -f 2- > "${HOME}/first.trc"
+    tail -n "${HALF}" "${TWICE}" | cut -d ' ' -f 2- > "${HOME}/second.trc"
+    if [ $(( TICS % 2 )) -ne 0 ] || ! cmp -s "${HOME}/first.trc" "${HOME}/second.trc" ; then
+        echo "${DEMO}: FAILED, the second playback differs"
+        FAILED=1
+    fi
+done < "${LIST_FILE}"
+
+rm -rf "${HOME}"
+if [ ${FAILED} -ne 0 ] ; then
+    exit 1
+fi
+if [ ${MISSING} -ne 0 ] ; then
+    echo "Some demos have no trace, skipped."
+    exit 77
+fi
+exit 0
@@ -0,0 +1,326 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Plays a scripted demo in a synthetic one sector room, so
+//      the playsim can be checked without an IWAD. Every tic goes
+//      through P_SyncTicker, so the run is compared with a trace:
+//
+//          synctest -synccheck synctest.trc
+//
+//      When the playsim changes on purpose, the trace is written
+//      again with -synctrace.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomdef.h"
+#include "d_event.h"
+#include "doomstat.h"
+#include "z_zone.h"
+#include "m_argv.h"
+#include "m_bbox.h"
+#include "m_random.h"
+#include "p_local.h"
+#include "p_spec.h"
+#include "p_sync.h"
+#include "p_tick.h"
+#include "r_state.h"
+
+// Sound is not part of the playsim.
+void S_StartSound (void* origin, int sound_id) { (void)origin; (void)sound_id; }
+void S_StopSound (void* origin) { (void)origin; }
+void S_ChangeMusic (int musicnum, int looping) { (void)musicnum; (void)looping; }
+void S_StartMusic (int music_id) { (void)music_id; }
+void S_Init (int sfxVolume, int musicVolume) { (void)sfxVolume; (void)musicVolume; }
+void S_SetMusicVolume (int volume) { (void)volume; }
+void S_SetSfxVolume (int volume) { (void)volume; }
+void S_UpdateSounds (void* listener) { (void)listener; }
+void S_Start (void) {}
+void S_PauseSound (void) {}
+void S_ResumeSound (void) {}
+void S_PrecacheLevel (void) {}
+
+int     snd_SfxVolume;
+int     snd_MusicVolume;
+int     numChannels;
+
+void G_PlayerReborn (int player);
+
+#define ROOMSIZE        256
+
+// The room, then the stair sectors.
+#define NUMROOMSECTORS  7
+
+static vertex_t         roomvertexes[4];
+static line_t           roomlines[4];
+static line_t*          roomlinelist[4];
+static side_t           roomsides[4];
+static sector_t         roomsectors[NUMROOMSECTORS];
+static subsector_t      roomsubsector;
+static byte             roomreject[1];
+
+// 2x2 blocks, each with the list 0: 0 1 2 3 -1.
+static short            roomblockmap[4+4+6] =
+{
+    0, 0, 2, 2,
+    8, 8, 8, 8,
+    0, 0, 1, 2, 3, -1
+};
+
+static line_t           stairlines[3];
+static line_t*          stairlinelist[3];
+
+//
+// BuildStairs
+// Sectors 1 to 6, off the map. 1, 2 and 5 are tagged 2 and
+// start stairs: 1 raises the steps 3 and 4, 5 raises 6, and
+// 2 has no steps. Vanilla goes on after the last step of a
+// stair, so 2 is skipped.
+//
+static void BuildStairs (void)
+{
+    static const int    steps[3][2] = { { 1, 3 }, { 3, 4 }, { 5, 6 } };
+    sector_t*           sec;
+    line_t*             ld;
+    int                 i;
+
+    for (i=1 ; i<NUMROOMSECTORS ; i++)
+    {
+        sec = &roomsectors[i];
+        sec->floorheight = 0;
+        sec->ceilingheight = 128*FRACUNIT;
+        sec->lightlevel = 160;
+        sec->tag = (i == 1 || i == 2 || i == 5) ? 2 : 0;
+
+        // Off the map, so the movers check no things. The
+        // stairs leave floormove_t crush unset, as vanilla.
+        sec->blockbox[BOXTOP] = sec->blockbox[BOXRIGHT] = -1;
+    }
+
+    // Two sided lines from each step to the next one.
+    for (i=0 ; i<3 ; i++)
+    {
+        ld = &stairlines[i];
+        ld->flags = ML_TWOSIDED;
+        ld->frontsector = &roomsectors[steps[i][0]];
+        ld->backsector = &roomsectors[steps[i][1]];
+        ld->sidenum[0] = ld->sidenum[1] = -1;
+
+        stairlinelist[i] = ld;
+        sec = ld->frontsector;
+        sec->lines = &stairlinelist[i];
+        sec->linecount = 1;
+    }
+}
+
+//
+// BuildRoom
+// A square, closed sector without any nodes or segs.
+//
+static void BuildRoom (void)
+{
+    static const int    corner[5] = { 0, 3, 2, 1, 0 };
+    line_t*             ld;
+    int                 i;
+
+    for (i=0 ; i<4 ; i++)
+    {
+        roomvertexes[i].x = (i == 1 || i == 2) ? ROOMSIZE*FRACUNIT : 0;
+        roomvertexes[i].y = (i >= 2) ? ROOMSIZE*FRACUNIT : 0;
+    }
+    vertexes = roomvertexes;
+    numvertexes = 4;
+
+    roomsectors[0].floorheight = 0;
+    roomsectors[0].ceilingheight = 128*FRACUNIT;
+    roomsectors[0].lightlevel = 160;
+    roomsectors[0].tag = 1;
+    roomsectors[0].linecount = 4;
+    roomsectors[0].lines = roomlinelist;
+    roomsectors[0].blockbox[BOXTOP] = 1;
+    roomsectors[0].blockbox[BOXRIGHT] = 1;
+    roomsectors[0].soundorg.x = ROOMSIZE/2*FRACUNIT;
+    roomsectors[0].soundorg.y = ROOMSIZE/2*FRACUNIT;
+    sectors = roomsectors;
+    numsectors = NUMROOMSECTORS;
+
+    // One sided lines with the room on their right.
+    for (i=0 ; i<4 ; i++)
+    {
+        ld = &roomlines[i];
+        ld->v1 = &roomvertexes[corner[i]];
+        ld->v2 = &roomvertexes[corner[i+1]];
+        ld->dx = ld->v2->x - ld->v1->x;
+        ld->dy = ld->v2->y - ld->v1->y;
+        ld->flags = ML_BLOCKING;
+        ld->tag = 1;
+        ld->sidenum[0] = i;
+        ld->sidenum[1] = -1;
+        ld->frontsector = &roomsectors[0];
+        ld->backsector = NULL;
+        ld->slopetype = ld->dx ? ST_HORIZONTAL : ST_VERTICAL;
+        M_ClearBox (ld->bbox);
+        M_AddToBox (ld->bbox, ld->v1->x, ld->v1->y);
+        M_AddToBox (ld->bbox, ld->v2->x, ld->v2->y);
+
+        roomsides[i].sector = &roomsectors[0];
+        roomlinelist[i] = ld;
+    }
+    lines = roomlines;
+    numlines = 4;
+    sides = roomsides;
+    numsides = 4;
+
+    roomsubsector.sector = &roomsectors[0];
+    subsectors = &roomsubsector;
+    numsubsectors = 1;
+    numnodes = 0;
+    numsegs = 0;
+
+    blockmaplump = roomblockmap;
+    blockmap = roomblockmap+4;
+    bmaporgx = bmaporgy = 0;
+    bmapwidth = bmapheight = 2;
+    blocklinks = Z_Malloc (4*sizeof(*blocklinks), PU_STATIC, NULL);
+    memset (blocklinks, 0, 4*sizeof(*blocklinks));
+    rejectmatrix = roomreject;
+
+    BuildStairs ();
+
+    P_InitThinkers ();
+    P_InitTagLists ();
+    P_InitSpecialLists ();
+}
+
+//
+// SpawnThings
+// The player with god mode, some monsters, barrels and pickups,
+// a crushing ceiling, two light effects and the stairs.
+//
+static void SpawnThings (void)
+{
+    static const struct { int x, y; mobjtype_t type; } things[] =
+    {
+        { 200,  60, MT_POSSESSED },
+        { 220, 220, MT_SHOTGUY },
+        {  60, 210, MT_TROOP },
+        { 120, 150, MT_BARREL },
+        { 180, 190, MT_BARREL },
+        {  40, 150, MT_CLIP },
+        { 100, 190, MT_MISC11 },        // medikit
+    };
+    player_t*   player = &players[0];
+    mobj_t*     mo;
+    line_t      trigger;
+    unsigned    i;
+
+    playeringame[0] = true;
+    consoleplayer = displayplayer = 0;
+    player->playerstate = PST_REBORN;
+    G_PlayerReborn (0);
+
+    mo = P_SpawnMobj (64*FRACUNIT, 64*FRACUNIT, ONFLOORZ, MT_PLAYER);
+    mo->player = player;
+    mo->health = player->health;
+    player->mo = mo;
+    player->viewheight = VIEWHEIGHT;
+    player->cheats |= CF_GODMODE;
+    P_SetupPsprites (player);
+
+    for (i=0 ; i<sizeof(things)/sizeof(things[0]) ; i++)
+        P_SpawnMobj (things[i].x*FRACUNIT, things[i].y*FRACUNIT,
+                     ONFLOORZ, things[i].type);
+
+    P_SpawnGlowingLight (&roomsectors[0]);
+    P_SpawnFireFlicker (&roomsectors[0]);
+
+    memset (&trigger, 0, sizeof(trigger));
+    trigger.tag = 1;
+    EV_DoCeiling (&trigger, silentCrushAndRaise);
+
+    trigger.tag = 2;
+    EV_BuildStairs (&trigger, build8);
+}
+
+//
+// The demo, as runs of ticcmds.
+//
+typedef struct
+{
+    int         tics;
+    signed char forwardmove;
+    signed char sidemove;
+    short       angleturn;
+    byte        buttons;
+} demorun_t;
+
+static const demorun_t demo[] =
+{
+    { 35,  25,   0,     0, 0 },
+    { 20,   0,   0,   640, BT_ATTACK },
+    { 35,  50,  24,     0, 0 },
+    { 30,   0,   0,  -320, BT_ATTACK },
+    { 20, -25, -40,     0, BT_USE },
+    { 50,  50,   0,   200, BT_ATTACK },
+    { 10,   0,   0,     0, BT_CHANGE | (wp_fist<<BT_WEAPONSHIFT) },
+    { 40,  50,  40,  -500, BT_ATTACK },
+    { 30, -50,   0,  1000, 0 },
+    { 60,  25, -24,     0, BT_ATTACK },
+    { 70,  40,  10,   300, BT_ATTACK },
+};
+
+int main (int argc, char** argv)
+{
+    ticcmd_t*   cmd = &players[0].cmd;
+    unsigned    run;
+    int         i;
+
+    myargc = argc;
+    myargv = argv;
+
+    Z_Init ();
+    BuildRoom ();
+
+    gamestate = GS_LEVEL;
+    gameskill = sk_medium;
+    gameepisode = 1;
+    gamemap = 1;
+    leveltime = 0;
+    M_ClearRandom ();
+    SpawnThings ();
+
+    P_InitSync ();
+    for (run=0 ; run<sizeof(demo)/sizeof(demo[0]) ; run++)
+    {
+        for (i=0 ; i<demo[run].tics ; i++)
+        {
+            memset (cmd, 0, sizeof(*cmd));
+            cmd->forwardmove = demo[run].forwardmove;
+            cmd->sidemove = demo[run].sidemove;
+            cmd->angleturn = demo[run].angleturn;
+            cmd->buttons = demo[run].buttons;
+
+            P_Ticker ();
+            P_SyncTicker ();
+            gametic++;
+        }
+    }
+    P_CloseSync ();
+
+    return 0;
+}
@@ -0,0 +1,225 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Converts an IWAD or PWAD into a compressed CWAD, see w_wad.h.
+//      Every lump is checked to decompress to the original data,
+//      and the compression ratio and decompression speed are shown.
+//
+//      Usage: wadpack in.wad out.wad
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "m_lz.h"
+
+// Lumps smaller than this are always stored as is.
+#define MINCOMPRESS     32
+
+typedef struct
+{
+    int         filepos;
+    int         size;
+    int         csize;
+    char        name[8];
+} lump_t;
+
+static int getlong (const byte* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+static void putlong (byte* p, int x)
+{
+    p[0] = (byte)x;
+    p[1] = (byte)(x >> 8);
+    p[2] = (byte)(x >> 16);
+    p[3] = (byte)(x >> 24);
+}
+
+static byte* readfile (const char* name, long* size)
+{
+    FILE* f = fopen (name, "rb");
+    if (!f)
+        return NULL;
+    fseek (f, 0, SEEK_END);
+    *size = ftell (f);
+    fseek (f, 0, SEEK_SET);
+    byte* data = malloc (*size > 0 ? *size : 1);
+    if (data && fread (data, 1, *size, f) != (size_t)*size)
+    {
+        free (data);
+        data = NULL;
+    }
+    fclose (f);
+    return data;
+}
+
+int main (int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        fprintf (stderr, "Usage: %s in.wad out.wad\n", argv[0]);
+        return 1;
+    }
+
+    long wadsize;
+    byte* wad = readfile (argv[1], &wadsize);
+    if (!wad)
+    {
+        fprintf (stderr, "Couldn't read %s\n", argv[1]);
+        return 1;
+    }
+    if (wadsize < 12 || (memcmp (wad, "IWAD", 4) && memcmp (wad, "PWAD", 4)))
+    {
+        fprintf (stderr, "%s is not an IWAD or PWAD\n", argv[1]);
+        return 1;
+    }
+
+    int numlumps = getlong (&wad[4]);
+    int infotableofs = getlong (&wad[8]);
+    if (numlumps < 0 || infotableofs < 12 ||
+        (long)infotableofs + numlumps * 16L > wadsize)
+    {
+        fprintf (stderr, "%s has a bad directory\n", argv[1]);
+        return 1;
+    }
+
+    // Lumps may share data, so the output is sized from the sum
+    // of the lump sizes rather than from the input. A lump never
+    // takes more than its size, and a directory entry 20 bytes.
+    long rawbytes = 0;
+    int maxsize = 0;
+    for (int i = 0; i < numlumps; i++)
+    {
+        const byte* entry = &wad[infotableofs + i * 16];
+        int filepos = getlong (&entry[0]);
+        int size = getlong (&entry[4]);
+        if (size < 0 || filepos < 0 || (long)filepos + size > wadsize)
+        {
+            fprintf (stderr, "Lump %d is outside of %s\n", i, argv[1]);
+            return 1;
+        }
+        rawbytes += size;
+        if (size > maxsize)
+            maxsize = size;
+    }
+    long outsize = 12 + rawbytes + numlumps * 20L;
+    if (outsize > 0x7fffffffL)
+    {
+        fprintf (stderr, "%s is too large for a CWAD\n", argv[1]);
+        return 1;
+    }
+
+    lump_t* lumps = calloc (numlumps ? numlumps : 1, sizeof (lump_t));
+    byte* out = malloc (outsize);
+    byte* check = malloc (maxsize + 1);
+    if (!lumps || !out || !check)
+    {
+        fprintf (stderr, "Out of memory\n");
+        return 1;
+    }
+    long peakmemory = wadsize + outsize + maxsize + 1
+                      + (numlumps ? numlumps : 1) * (long)sizeof (lump_t);
+
+    // Lump data goes first, and the directory last, as in a WAD.
+    long outpos = 12;
+    double compresstime = 0.0;
+    double decompresstime = 0.0;
+    int numcompressed = 0;
+    for (int i = 0; i < numlumps; i++)
+    {
+        const byte* entry = &wad[infotableofs + i * 16];
+        lump_t* l = &lumps[i];
+        int filepos = getlong (&entry[0]);
+        l->size = getlong (&entry[4]);
+        memcpy (l->name, &entry[8], 8);
+        const byte* data = &wad[filepos];
+
+        l->filepos = (int)outpos;
+        l->csize = 0;
+        if (l->size >= MINCOMPRESS)
+        {
+            clock_t start = clock ();
+            l->csize =
+                LZ_Compress (data, l->size, &out[outpos], l->size - 1);
+            compresstime += (double)(clock () - start) / CLOCKS_PER_SEC;
+        }
+
+        if (l->csize > 0)
+        {
+            clock_t start = clock ();
+            int size =
+                LZ_Decompress (&out[outpos], l->csize, check, l->size);
+            decompresstime += (double)(clock () - start) / CLOCKS_PER_SEC;
+            if (size != l->size || memcmp (check, data, l->size))
+            {
+                fprintf (stderr, "Lump %.8s failed to decompress\n",
+                         l->name);
+                return 1;
+            }
+            numcompressed++;
+        }
+        else
+        {
+            // Not worth it, store as is.
+            memcpy (&out[outpos], data, l->size);
+            l->csize = l->size;
+        }
+        outpos += l->csize;
+    }
+
+    memcpy (&out[0], "CWAD", 4);
+    putlong (&out[4], numlumps);
+    putlong (&out[8], (int)outpos);
+    for (int i = 0; i < numlumps; i++)
+    {
+        putlong (&out[outpos], lumps[i].filepos);
+        putlong (&out[outpos + 4], lumps[i].size);
+        putlong (&out[outpos + 8], lumps[i].csize);
+        memcpy (&out[outpos + 12], lumps[i].name, 8);
+        outpos += 20;
+    }
+
+    FILE* f = fopen (argv[2], "wb");
+    if (!f || fwrite (out, 1, outpos, f) != (size_t)outpos)
+    {
+        fprintf (stderr, "Couldn't write %s\n", argv[2]);
+        return 1;
+    }
+    fclose (f);
+
+    printf ("%s: %d lumps, %d compressed\n", argv[2], numlumps, numcompressed);
+    printf ("  file size: %ld -> %ld bytes (%.1f%%)\n",
+            wadsize,
+            outpos,
+            wadsize ? 100.0 * outpos / wadsize : 0.0);
+    printf ("  lump data: %ld bytes\n", rawbytes);
+    printf ("  compress: %.1f ms, decompress: %.1f ms (%.1f MB/s)\n",
+            compresstime * 1000.0,
+            decompresstime * 1000.0,
+            decompresstime > 0.0 ? rawbytes / decompresstime / 1e6 : 0.0);
+    printf ("  peak memory: %ld bytes\n", peakmemory);
+
+    free (check);
+    free (out);
+    free (lumps);
+    free (wad);
+    return 0;
+}
@@ -20,14 +20,20 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "i_system.h"
 #include "r_local.h"
 
 #include "doomdef.h"
 #include "doomdata.h"
 
+#include "m_argv.h"
 #include "m_bbox.h"
 #include "m_swap.h"
+#include "w_wad.h"
+#include "z_zone.h"
 
 #include "v_video.h"
 
@@ -125,6 +131,9 @@ int     usegamma;
 
 //
 // V_MarkRect
+// Grows the dirty box of screen 0 to cover the rectangle.
+// Note: M_AddToBox can not be used, since it only updates
+// one of the edges when starting from a cleared box.
 //
 void
 V_MarkRect
@@ -133,8 +142,24 @@ V_MarkRect
   int           width,
   int           height )
 {
-    M_AddToBox (dirtybox, x, y);
-    M_AddToBox (dirtybox, x+width-1, y+height-1);
+    if (x < dirtybox[BOXLEFT])
+        dirtybox[BOXLEFT] = x;
+    if (x+width-1 > dirtybox[BOXRIGHT])
+        dirtybox[BOXRIGHT] = x+width-1;
+    if (y < dirtybox[BOXBOTTOM])
+        dirtybox[BOXBOTTOM] = y;
+    if (y+height-1 > dirtybox[BOXTOP])
+        dirtybox[BOXTOP] = y+height-1;
+}
+
+//
+// V_ClearDirtyBox
+// Called by the video backend once the dirty
+// part of screen 0 has been sent to the display.
+//
+void V_ClearDirtyBox (void)
+{
+    M_ClearBox (dirtybox);
 }
 
 //
@@ -304,6 +329,296 @@ static inline void V_DrawPatchScaledInternal (int x,
     }
 }
 
+//
+// Pre-scaled patch cache.
+// Scaling a patch on the fly walks the patch column by column and
+// writes one pixel at a time with a stride of SCREENWIDTH. Full
+// screen pictures (title pages, intermission maps) and the animated
+// intermission graphics are drawn every frame, so they are scaled
+// once and kept in a row major span format that is drawn with one
+// memcpy per span. Fully opaque patches are stored as a plain
+// rectangle of pixels.
+//
+// Entries are keyed by lump number, live in the zone as
+// PU_CACHE, and are evicted least recently used first to keep the
+// cache within a memory budget (-patchcache <KB>, 0 disables it).
+// The resolution is fixed at compile time and patch lumps are never
+// reloaded, so entries don't go stale.
+//
+#ifdef MC1
+#define DEFAULT_PATCH_CACHE_KB  256
+#else
+#define DEFAULT_PATCH_CACHE_KB  1024
+#endif
+
+typedef struct
+{
+    short       x;
+    short       length;
+} vspan_t;
+
+typedef struct
+{
+    // Zone block, NULL when not cached (or purged by the zone).
+    // Opaque: width*height pixels.
+    // Masked: int rowspans[height+1], vspan_t spans[], pixels.
+    byte*       data;
+    int         size;
+    int         width;
+    int         height;
+    int         leftoffset;
+    int         topoffset;
+    boolean     opaque;
+    int         lastused;
+} vpatch_t;
+
+static vpatch_t*        patchcache;
+static int              patchcachelumps;
+static int              patchcachebudget;
+static int              patchclock;
+
+//
+// V_EvictPatches
+// Frees least recently used entries until size more bytes fit.
+// Sizes are summed on each call, since the zone may have
+// purged entries behind our back.
+//
+static boolean V_EvictPatches (int size)
+{
+    int         i;
+    int         used;
+    int         victim;
+
+    if (size > patchcachebudget)
+        return false;
+
+    for (;;)
+    {
+        used = 0;
+        victim = -1;
+        for (i = 0; i < patchcachelumps; i++)
+        {
+            if (!patchcache[i].data)
+                continue;
+            used += patchcache[i].size;
+            if (victim < 0
+                || patchcache[i].lastused < patchcache[victim].lastused)
+                victim = i;
+        }
+        if (used + size <= patchcachebudget)
+            return true;
+
+        Z_Free (patchcache[victim].data);
+    }
+}
+
+//
+// V_ScalePatch
+// Scales a patch into a width*height buffer, and flags the
+// pixels that were drawn in mask. Uses the same stepping as
+// V_DrawPatchScaledInternal, so the result is pixel identical
+// within the scaled size of the patch.
+//
+static void V_ScalePatch (patch_t* patch,
+                          int width,
+                          int height,
+                          byte* pixels,
+                          byte* mask)
+{
+    const fixed_t step_x = (BASE_WIDTH << 16) / SCREENWIDTH;
+    const fixed_t step_y = (BASE_HEIGHT << 16) / SCREENHEIGHT;
+    fixed_t col_fixed = 0;
+
+    for (int u = 0; u < width; ++u, col_fixed += step_x)
+    {
+        int col = col_fixed >> 16;
+        post_t* post =
+            (post_t*)((byte*)patch + LONG (patch->columnofs[col]));
+        while (post->topdelta != 0xff)
+        {
+            const byte* src = (byte*)post + 3;
+            int top = TOSCREENY ((int)post->topdelta);
+            int count = TOSCREENY ((int)post->length);
+            fixed_t row_fixed = 0;
+            for (int v = top; v < top + count && v < height; ++v)
+            {
+                pixels[v * width + u] = src[row_fixed >> 16];
+                mask[v * width + u] = 1;
+                row_fixed += step_y;
+            }
+            post = (post_t*)((byte*)post + post->length + 4);
+        }
+    }
+}
+
+//
+// V_CachePatchScaled
+// Returns the pre-scaled version of a patch lump,
+// or NULL if it does not fit in the cache.
+//
+static vpatch_t* V_CachePatchScaled (int lump)
+{
+    vpatch_t*   vp;
+    patch_t*    patch;
+
+    if (patchcachebudget <= 0)
+        return NULL;
+
+    if (!patchcache)
+    {
+        patchcachelumps = numlumps;
+        patchcache = Z_Malloc (patchcachelumps*sizeof(*patchcache),
+                               PU_STATIC, NULL);
+        memset (patchcache, 0, patchcachelumps*sizeof(*patchcache));
+    }
+    if (lump < 0 || lump >= patchcachelumps)
+        return NULL;
+
+    vp = &patchcache[lump];
+    vp->lastused = ++patchclock;
+    if (vp->data)
+        return vp;
+
+    // Don't use W_CacheLumpNum on a lump that is already loaded,
+    // since it would retag a PU_STATIC lump as PU_CACHE.
+    patch = lumpcache[lump];
+    if (!patch)
+        patch = W_CacheLumpNum (lump, PU_CACHE);
+
+    // Posts may reach a row below the scaled height due to rounding.
+    // They are cut off there, since that is all that the range check
+    // and the dirty rectangle of the direct path cover.
+    const int width = TOSCREENX (SHORT (patch->width));
+    const int height = TOSCREENY (SHORT (patch->height));
+
+    // Scale into temporary buffers outside the zone, so
+    // that the patch can not be purged while we read it.
+    byte* pixels = malloc (width * height * 2);
+    if (!pixels)
+        return NULL;
+    byte* mask = pixels + width * height;
+    memset (mask, 0, width * height);
+    V_ScalePatch (patch, width, height, pixels, mask);
+
+    vp->width = width;
+    vp->height = height;
+    vp->leftoffset = TOSCREENX (SHORT (patch->leftoffset));
+    vp->topoffset = TOSCREENY (SHORT (patch->topoffset));
+
+    // Count the spans.
+    int numspans = 0;
+    int numpixels = 0;
+    for (int v = 0; v < height; v++)
+    {
+        const byte* m = mask + v * width;
+        for (int u = 0; u < width; u++)
+        {
+            if (m[u])
+            {
+                if (u == 0 || !m[u - 1])
+                    ++numspans;
+                ++numpixels;
+            }
+        }
+    }
+
+    vp->opaque = numpixels == width * height;
+    if (vp->opaque)
+        vp->size = numpixels;
+    else
+        vp->size = (height + 1) * sizeof(int)
+                   + numspans * sizeof(vspan_t)
+                   + numpixels;
+
+    if (!V_EvictPatches (vp->size))
+    {
+        free (pixels);
+        return NULL;
+    }
+    Z_Malloc (vp->size, PU_CACHE, &vp->data);
+
+    if (vp->opaque)
+    {
+        memcpy (vp->data, pixels, numpixels);
+    }
+    else
+    {
+        int* rowspans = (int*)vp->data;
+        vspan_t* spans = (vspan_t*)(rowspans + height + 1);
+        byte* dest = (byte*)(spans + numspans);
+        int n = 0;
+        for (int v = 0; v < height; v++)
+        {
+            const byte* m = mask + v * width;
+            const byte* p = pixels + v * width;
+            rowspans[v] = n;
+            for (int u = 0; u < width; u++)
+            {
+                if (!m[u])
+                    continue;
+                int start = u;
+                while (u < width && m[u])
+                    *dest++ = p[u++];
+                spans[n].x = start;
+                spans[n].length = u - start;
+                ++n;
+            }
+        }
+        rowspans[height] = n;
+    }
+
+    free (pixels);
+    return vp;
+}
+
+//
+// V_DrawPatchCached
+// Draws a pre-scaled patch, one memcpy per span.
+//
+static void V_DrawPatchCached (int x, int y, int scrn, vpatch_t* vp)
+{
+    x -= vp->leftoffset;
+    y -= vp->topoffset;
+#ifdef RANGECHECK
+    if (x < 0 || x + vp->width > SCREENWIDTH || y < 0
+        || y + vp->height > SCREENHEIGHT || (unsigned)scrn > 4)
+    {
+        fprintf (stderr, "Patch at %d,%d exceeds LFB\n", x, y);
+        fprintf (stderr, "V_DrawPatchScaled: bad patch (ignored)\n");
+        return;
+    }
+#endif
+
+    if (!scrn)
+        V_MarkRect (x, y, vp->width, vp->height);
+
+    byte* dest = screens[scrn] + y * SCREENWIDTH + x;
+    if (vp->opaque)
+    {
+        const byte* src = vp->data;
+        for (int v = 0; v < vp->height; v++)
+        {
+            memcpy (dest, src, vp->width);
+            src += vp->width;
+            dest += SCREENWIDTH;
+        }
+        return;
+    }
+
+    const int* rowspans = (int*)vp->data;
+    const vspan_t* spans = (vspan_t*)(rowspans + vp->height + 1);
+    const byte* src = (byte*)(spans + rowspans[vp->height]);
+    for (int v = 0; v < vp->height; v++)
+    {
+        for (int n = rowspans[v]; n < rowspans[v + 1]; n++)
+        {
+            memcpy (dest + spans[n].x, src, spans[n].length);
+            src += spans[n].length;
+        }
+        dest += SCREENWIDTH;
+    }
+}
+
 static void V_DrawPatchInternal (int x,
                                  int y,
                                  int scrn,
@@ -388,6 +703,23 @@ void V_DrawPatchScaled (int x, int y, int scrn, patch_t* patch)
     V_DrawPatchScaledInternal (x, y, scrn, patch, false);
 }
 
+//
+// V_DrawPatchScaledNum
+// Like V_DrawPatchScaled, but takes a lump number,
+// and draws from the pre-scaled patch cache.
+//
+void V_DrawPatchScaledNum (int x, int y, int scrn, int lump)
+{
+    vpatch_t* vp = V_CachePatchScaled (lump);
+    if (vp)
+        V_DrawPatchCached (x, y, scrn, vp);
+    else if (lumpcache[lump])
+        V_DrawPatchScaledInternal (x, y, scrn, lumpcache[lump], false);
+    else
+        V_DrawPatchScaledInternal (x, y, scrn,
+                                   W_CacheLumpNum (lump, PU_CACHE), false);
+}
+
 //
 // V_DrawPatch
 // Masks a column based masked pic to the screen.
@@ -504,4 +836,12 @@ void V_Init (void)
 
     for (i=0 ; i<4 ; i++)
         screens[i] = base + i*SCREENWIDTH*SCREENHEIGHT;
+
+    V_ClearDirtyBox ();
+    V_MarkRect (0, 0, SCREENWIDTH, SCREENHEIGHT);
+
+    patchcachebudget = DEFAULT_PATCH_CACHE_KB * 1024;
+    i = M_CheckParm ("-patchcache");
+    if (i && i < myargc-1)
+        patchcachebudget = atoi (myargv[i+1]) * 1024;
 }
@@ -41,6 +41,8 @@
 
 extern  byte*           screens[5];
 
+// The part of screen 0 that has been drawn to since the
+// last V_ClearDirtyBox, as a M_ClearBox style box.
 extern  int     dirtybox[4];
 
 extern  byte    gammatable[5][256];
@@ -81,6 +83,15 @@ V_DrawPatchScaled
   int           scrn,
   patch_t*      patch);
 
+// Draws a patch lump scaled to the screen resolution,
+// from a cache of pre-scaled patches.
+void
+V_DrawPatchScaledNum
+( int           x,
+  int           y,
+  int           scrn,
+  int           lump );
+
 // Draw a linear block of pixels into the view buffer.
 void
 V_DrawBlock
@@ -108,6 +119,8 @@ V_MarkRect
   int           width,
   int           height );
 
+void V_ClearDirtyBox (void);
+
 void
 V_FillRect
 ( int           x,
@@ -18,7 +18,11 @@
 //
 //-----------------------------------------------------------------------------
 
+// For pread.
+#define _POSIX_C_SOURCE 200809L
+
 #include <ctype.h>
+#include <stdatomic.h>
 #include <string.h>
 #include <stdlib.h>
 #include <sys/types.h>
@@ -28,10 +32,18 @@
 #include <sys/stat.h>
 #define O_BINARY                0
 
+#ifndef MC1
+#include <pthread.h>
+#define PREFETCH_THREAD
+#endif
+
 #include "doomtype.h"
+#include "doomstat.h"
+#include "m_argv.h"
 #include "m_misc.h"
 #include "m_swap.h"
 #include "i_system.h"
+#include "m_lz.h"
 #include "z_zone.h"
 
 #include "w_wad.h"
@@ -46,6 +58,21 @@ int                     numlumps;
 
 void**                  lumpcache;
 
+// Compressed lumps are read here before they are decompressed.
+static byte*            scratch;
+static int              scratchsize;
+
+// Sizes and modification times of the files, for W_Checksum.
+static unsigned         filestamp;
+
+// Statistics.
+static int              numreads;
+static long long        bytesread;
+static long long        bytesloaded;
+static long long        readtime;
+static int              nummisses;
+static long long        misstime;
+
 static void strtoupper (char* s)
 {
     while (*s) { *s = toupper(*s); s++; }
@@ -121,12 +148,16 @@ void W_AddFile (char *filename)
     int                 length;
     ssize_t             bytes_read;
     int                 startlump;
+    boolean             compressed;
     filelump_t*         fileinfo;
-    filelump_t*         fileinfo_malloc;
+    cfilelump_t*        cfileinfo;
+    void*               fileinfo_malloc;
     filelump_t          singleinfo;
     int                 storehandle;
 
     fileinfo_malloc = NULL;
+    cfileinfo = NULL;
+    compressed = false;
 
     // open the file and add to directory
 
@@ -147,6 +178,13 @@ void W_AddFile (char *filename)
     printf (" adding %s\n",filename);
     startlump = numlumps;
 
+    {
+        struct stat fileinfo;
+        if (fstat (handle,&fileinfo) == 0)
+            filestamp = (filestamp ^ (unsigned)fileinfo.st_size) * 16777619u
+                        + (unsigned)fileinfo.st_mtime;
+    }
+
     if (M_strcmpi (filename + strlen (filename) - 3, "wad"))
     {
         // single lump file
@@ -161,28 +199,38 @@ void W_AddFile (char *filename)
         // WAD file
         if (read (handle, &header, sizeof(header)) != sizeof (header))
             I_Error ("Unable to read WAD header from %s", filename);
-        if (strncmp(header.identification,"IWAD",4))
+        compressed = !strncmp(header.identification,"CWAD",4);
+        if (strncmp(header.identification,"IWAD",4) && !compressed)
         {
             // Homebrew levels?
             if (strncmp(header.identification,"PWAD",4))
             {
-                I_Error ("Wad file %s doesn't have IWAD or PWAD id\n",
+                I_Error ("Wad file %s doesn't have IWAD, PWAD or CWAD id\n",
                          filename);
             }
 
             // ???modifiedgame = true;
         }
+        if (compressed && reloadname)
+            I_Error ("W_AddFile: %s is compressed, and can't be reloaded",
+                     filename);
         header.numlumps = LONG(header.numlumps);
         header.infotableofs = LONG(header.infotableofs);
-        length = header.numlumps*sizeof(filelump_t);
-        fileinfo_malloc = (filelump_t*)malloc (length);
+        if (compressed)
+            length = header.numlumps*sizeof(cfilelump_t);
+        else
+            length = header.numlumps*sizeof(filelump_t);
+        fileinfo_malloc = malloc (length);
         if (!fileinfo_malloc)
-            I_Error ("Couldn't malloc %d bytes for filelumps");
+            I_Error ("Couldn't malloc %d bytes for filelumps", length);
         fileinfo = fileinfo_malloc;
+        if (compressed)
+            cfileinfo = fileinfo_malloc;
         lseek (handle, header.infotableofs, SEEK_SET);
-        bytes_read = read (handle, fileinfo, length);
+        bytes_read = read (handle, fileinfo_malloc, length);
         if (bytes_read != length && bytes_read != 0)
             I_Error ("Unable to read lumps from %s", filename);
+        bytesread += sizeof(header) + bytes_read;
         numlumps += header.numlumps;
     }
 
@@ -200,12 +248,25 @@ void W_AddFile (char *filename)
 
     storehandle = reloadname ? -1 : handle;
 
-    for (i=startlump ; i<numlumps ; i++,lump_p++, fileinfo++)
+    for (i=startlump ; i<numlumps ; i++,lump_p++)
     {
         lump_p->handle = storehandle;
-        lump_p->position = LONG(fileinfo->filepos);
-        lump_p->size = LONG(fileinfo->size);
-        strncpy (lump_p->name, fileinfo->name, 8);
+        if (cfileinfo)
+        {
+            lump_p->position = LONG(cfileinfo->filepos);
+            lump_p->size = LONG(cfileinfo->size);
+            lump_p->csize = LONG(cfileinfo->csize);
+            strncpy (lump_p->name, cfileinfo->name, 8);
+            cfileinfo++;
+        }
+        else
+        {
+            lump_p->position = LONG(fileinfo->filepos);
+            lump_p->size = LONG(fileinfo->size);
+            lump_p->csize = lump_p->size;
+            strncpy (lump_p->name, fileinfo->name, 8);
+            fileinfo++;
+        }
     }
 
     if (fileinfo_malloc)
@@ -260,6 +321,7 @@ void W_Reload (void)
 
         lump_p->position = LONG(fileinfo->filepos);
         lump_p->size = LONG(fileinfo->size);
+        lump_p->csize = lump_p->size;
     }
 
     free (fileinfo);
@@ -387,6 +449,38 @@ int W_GetNumForName (const char* name)
     return i;
 }
 
+//
+// W_Checksum
+// Identifies the set of WAD files, from their directories,
+//  sizes and modification times.
+// Returns 0 if a reloadable file is in use, since it can
+//  change at any time.
+//
+unsigned W_Checksum (void)
+{
+    unsigned    hash;
+    byte*       p;
+    int         i;
+    int         j;
+
+    if (reloadname)
+        return 0;
+
+    // FNV-1a
+    hash = 2166136261u ^ filestamp;
+    for (i=0 ; i<numlumps ; i++)
+    {
+        p = (byte*)lumpinfo[i].name;
+        for (j=0 ; j<8 ; j++)
+            hash = (hash ^ p[j]) * 16777619u;
+        hash = (hash ^ (unsigned)lumpinfo[i].position) * 16777619u;
+        hash = (hash ^ (unsigned)lumpinfo[i].size) * 16777619u;
+        hash = (hash ^ (unsigned)lumpinfo[i].csize) * 16777619u;
+    }
+
+    return hash ? hash : 1;
+}
+
 //
 // W_LumpLength
 // Returns the buffer size needed to load the given lump.
@@ -399,6 +493,50 @@ int W_LumpLength (int lump)
     return lumpinfo[lump].size;
 }
 
+//
+// W_LumpFile
+// Returns the handle of the file that holds the lump as is,
+//  so that it can be read piece by piece from position.
+// Returns -1 for compressed and reloadable lumps.
+//
+int
+W_LumpFile
+( int           lump,
+  int*          position )
+{
+    lumpinfo_t* l;
+
+    if (lump >= numlumps)
+        I_Error ("W_LumpFile: %i >= numlumps",lump);
+
+    l = lumpinfo+lump;
+    if (l->handle == -1 || l->csize != l->size)
+        return -1;
+
+    *position = l->position;
+    return l->handle;
+}
+
+//
+// W_ReadAt
+// Reads from a position without moving the file offset, so
+//  that it can be used by the prefetch thread as well.
+//
+static int
+W_ReadAt
+( int           handle,
+  void*         dest,
+  int           size,
+  int           position )
+{
+#ifdef PREFETCH_THREAD
+    return pread (handle, dest, size, position);
+#else
+    lseek (handle, position, SEEK_SET);
+    return read (handle, dest, size);
+#endif
+}
+
 //
 // W_ReadLump
 // Loads the lump into the given buffer,
@@ -412,11 +550,13 @@ W_ReadLump
     int         c;
     lumpinfo_t* l;
     int         handle;
+    long long   starttime;
 
     if (lump >= numlumps)
         I_Error ("W_ReadLump: %i >= numlumps",lump);
 
     l = lumpinfo+lump;
+    starttime = I_GetTimeUS ();
 
     // ??? I_BeginRead ();
 
@@ -429,19 +569,410 @@ W_ReadLump
     else
         handle = l->handle;
 
-    lseek (handle, l->position, SEEK_SET);
-    c = read (handle, dest, l->size);
+    if (l->csize == l->size)
+    {
+        c = W_ReadAt (handle, dest, l->size, l->position);
+
+        if (c < l->size)
+            I_Error ("W_ReadLump: only read %i of %i on lump %i",
+                     c,l->size,lump);
+    }
+    else
+    {
+        // compressed lump, read into scratch and unpack
+        if (l->csize > scratchsize)
+        {
+            scratch = realloc (scratch, l->csize);
+            if (!scratch)
+                I_Error ("W_ReadLump: couldn't allocate %i bytes",
+                         l->csize);
+            scratchsize = l->csize;
+        }
+
+        c = W_ReadAt (handle, scratch, l->csize, l->position);
 
-    if (c < l->size)
-        I_Error ("W_ReadLump: only read %i of %i on lump %i",
-                 c,l->size,lump);
+        if (c < l->csize)
+            I_Error ("W_ReadLump: only read %i of %i on lump %i",
+                     c,l->csize,lump);
+
+        if (LZ_Decompress (scratch, l->csize, dest, l->size) != l->size)
+            I_Error ("W_ReadLump: lump %i is corrupt", lump);
+    }
 
     if (l->handle == -1)
         close (handle);
 
+    numreads++;
+    bytesread += l->csize;
+    bytesloaded += l->size;
+    readtime += I_GetTimeUS () - starttime;
+
     // ??? I_EndRead ();
 }
 
+//
+// PREFETCH
+// Lumps that will be needed soon, e.g. by the next level, can be
+//  read ahead by a worker thread (on MC1, a few at a time from
+//  W_UpdatePrefetch). The main thread allocates a zone block per
+//  lump up front, and once a lump has been read the block is handed
+//  over to the lump cache, so the data is never copied.
+// The worker only reads into the blocks, all zone and lump cache
+//  changes are done on the main thread.
+//
+#define DEFAULT_PREFETCH_KB     2048
+
+// Time to spend reading per W_UpdatePrefetch, without a thread.
+#define PREFETCH_SLICE_US       8000
+
+enum
+{
+    pf_pending,
+    pf_done,
+    pf_failed
+};
+
+typedef struct
+{
+    int                 lump;
+    void*               data;   // PU_STATIC block, NULL when handed over
+    atomic_int          state;
+} prefetch_t;
+
+static prefetch_t*      prefetch;
+static int              numprefetch;
+static int              prefetchleft;   // slots that still have data
+static int              prefetchnext;   // next slot to read, without a thread
+static int*             prefetchslot;   // slot of each lump, or -1
+static int              prefetchbudget = -1;
+
+#ifdef PREFETCH_THREAD
+static pthread_t        prefetchthread;
+static boolean          prefetchthreadrunning;
+static atomic_int       prefetchstop;
+#endif
+
+// Statistics.
+static int              prefetchlumps;
+static int              prefetchbytes;
+static int              prefetchadopted;
+
+//
+// W_ReadPrefetch
+// Reads a lump into its staging block. This may run on the
+//  worker thread, so errors are not reported here. A failed
+//  lump is read again with W_ReadLump, which reports them.
+//
+static int
+W_ReadPrefetch
+( prefetch_t*   pf,
+  byte**        scratchp,
+  int*          scratchsizep )
+{
+    lumpinfo_t* l;
+    byte*       buf;
+
+    l = &lumpinfo[pf->lump];
+
+    if (l->csize == l->size)
+    {
+        if (W_ReadAt (l->handle, pf->data, l->size, l->position) != l->size)
+            return pf_failed;
+        return pf_done;
+    }
+
+    if (l->csize > *scratchsizep)
+    {
+        buf = realloc (*scratchp, l->csize);
+        if (!buf)
+            return pf_failed;
+        *scratchp = buf;
+        *scratchsizep = l->csize;
+    }
+
+    if (W_ReadAt (l->handle, *scratchp, l->csize, l->position) != l->csize
+        || LZ_Decompress (*scratchp, l->csize, pf->data, l->size) != l->size)
+        return pf_failed;
+
+    return pf_done;
+}
+
+#ifdef PREFETCH_THREAD
+static void* W_PrefetchThread (void* arg)
+{
+    byte*       buf;
+    int         bufsize;
+    int         i;
+    int         state;
+
+    (void)arg;
+
+    // The worker has its own scratch buffer for compressed lumps.
+    buf = NULL;
+    bufsize = 0;
+
+    for (i=0 ; i<numprefetch && !atomic_load (&prefetchstop) ; i++)
+    {
+        state = W_ReadPrefetch (&prefetch[i], &buf, &bufsize);
+        atomic_store_explicit (&prefetch[i].state, state,
+                               memory_order_release);
+    }
+
+    free (buf);
+    return NULL;
+}
+#endif
+
+//
+// W_AdoptPrefetch
+// Hands a read lump over to the lump cache. If the lump has
+//  not been read yet, waits for it when wait is set.
+//
+static void W_AdoptPrefetch (int slot, boolean wait)
+{
+    prefetch_t* pf;
+    int         state;
+
+    pf = &prefetch[slot];
+    state = atomic_load_explicit (&pf->state, memory_order_acquire);
+
+    if (state == pf_pending)
+    {
+        if (!wait)
+            return;
+#ifdef PREFETCH_THREAD
+        if (prefetchthreadrunning)
+        {
+            while ((state = atomic_load_explicit (&pf->state,
+                                                  memory_order_acquire))
+                   == pf_pending)
+                I_Sleep (100);
+        }
+        else
+#endif
+            state = W_ReadPrefetch (pf, &scratch, &scratchsize);
+    }
+
+    if (state == pf_done)
+    {
+        Z_ChangeUser (pf->data, &lumpcache[pf->lump]);
+        Z_ChangeTag (pf->data, PU_CACHE);
+        prefetchadopted++;
+    }
+    else
+        Z_Free (pf->data);
+
+    pf->data = NULL;
+    prefetchslot[pf->lump] = -1;
+    prefetchleft--;
+}
+
+//
+// W_StopPrefetch
+// Stops the worker, keeps the lumps that have been read
+//  and drops the rest.
+//
+static void W_StopPrefetch (void)
+{
+    int         i;
+
+#ifdef PREFETCH_THREAD
+    if (prefetchthreadrunning)
+    {
+        atomic_store (&prefetchstop, 1);
+        pthread_join (prefetchthread, NULL);
+        prefetchthreadrunning = false;
+    }
+#endif
+
+    for (i=0 ; i<numprefetch ; i++)
+    {
+        if (!prefetch[i].data)
+            continue;
+        if (atomic_load (&prefetch[i].state) != pf_pending)
+            W_AdoptPrefetch (i, false);
+        else
+        {
+            Z_Free (prefetch[i].data);
+            prefetchslot[prefetch[i].lump] = -1;
+            prefetchleft--;
+        }
+    }
+
+    free (prefetch);
+    prefetch = NULL;
+    numprefetch = 0;
+}
+
+//
+// W_StartPrefetch
+// Starts reading the given lumps in the background. Lumps
+//  that are already cached are skipped, and the total is
+//  limited by -prefetch <KB> and by the free zone memory.
+//
+void W_StartPrefetch (const int* lumps, int count)
+{
+    int         i;
+    int         lump;
+    int         budget;
+    int         total;
+    lumpinfo_t* l;
+    prefetch_t* pf;
+
+    W_StopPrefetch ();
+
+    if (prefetchbudget < 0)
+    {
+        prefetchbudget = DEFAULT_PREFETCH_KB * 1024;
+        i = M_CheckParm ("-prefetch");
+        if (i && i < myargc-1)
+            prefetchbudget = atoi (myargv[i+1]) * 1024;
+    }
+
+    // Leave room for the level that is being left.
+    budget = Z_FreeMemory () / 2;
+    if (budget > prefetchbudget)
+        budget = prefetchbudget;
+    if (budget <= 0 || count <= 0)
+        return;
+
+    if (!prefetchslot)
+    {
+        prefetchslot = malloc (numlumps*sizeof(*prefetchslot));
+        if (!prefetchslot)
+            return;
+        for (i=0 ; i<numlumps ; i++)
+            prefetchslot[i] = -1;
+    }
+
+    prefetch = malloc (count*sizeof(*prefetch));
+    if (!prefetch)
+        return;
+
+    total = 0;
+    for (i=0 ; i<count ; i++)
+    {
+        lump = lumps[i];
+        if (lump < 0 || lump >= numlumps)
+            continue;
+        l = &lumpinfo[lump];
+        if (lumpcache[lump] || prefetchslot[lump] >= 0
+            || l->size == 0 || l->handle == -1
+            || total + l->size > budget)
+            continue;
+
+        pf = &prefetch[numprefetch];
+        pf->lump = lump;
+        atomic_init (&pf->state, pf_pending);
+        Z_Malloc (l->size, PU_STATIC, &pf->data);
+        prefetchslot[lump] = numprefetch++;
+        total += l->size;
+    }
+
+    prefetchleft = numprefetch;
+    prefetchnext = 0;
+    prefetchlumps += numprefetch;
+    prefetchbytes += total;
+
+#ifdef PREFETCH_THREAD
+    if (numprefetch)
+    {
+        atomic_store (&prefetchstop, 0);
+        prefetchthreadrunning =
+            !pthread_create (&prefetchthread, NULL, W_PrefetchThread, NULL);
+    }
+#endif
+}
+
+//
+// W_UpdatePrefetch
+// Called regularly while prefetching, e.g. from the
+//  intermission ticker. Adopts the lumps that have been read.
+//
+void W_UpdatePrefetch (void)
+{
+    long long   start;
+    prefetch_t* pf;
+    int         state;
+    int         i;
+
+#ifdef PREFETCH_THREAD
+    if (!prefetchthreadrunning)
+#endif
+    {
+        start = I_GetTimeUS ();
+        while (prefetchnext < numprefetch
+               && I_GetTimeUS () - start < PREFETCH_SLICE_US)
+        {
+            pf = &prefetch[prefetchnext++];
+
+            // W_CacheLumpNum may have got to it first.
+            if (!pf->data)
+                continue;
+
+            state = W_ReadPrefetch (pf, &scratch, &scratchsize);
+            atomic_store (&pf->state, state);
+        }
+    }
+
+    for (i=0 ; i<numprefetch ; i++)
+    {
+        if (prefetch[i].data)
+            W_AdoptPrefetch (i, false);
+    }
+}
+
+//
+// W_PrefetchDone
+// True when every prefetched lump is in the lump cache.
+//
+int W_PrefetchDone (void)
+{
+    return prefetchleft == 0;
+}
+
+//
+// W_FinishPrefetch
+// Stops prefetching, and reports what it did.
+//
+void W_FinishPrefetch (void)
+{
+    W_StopPrefetch ();
+
+    if (prefetchlumps && devparm)
+    {
+        fprintf (stderr, "W_FinishPrefetch: %d lumps (%d KB) prefetched, "
+                 "%d adopted\n",
+                 prefetchlumps,
+                 prefetchbytes / 1024,
+                 prefetchadopted);
+    }
+    prefetchlumps = 0;
+    prefetchbytes = 0;
+    prefetchadopted = 0;
+}
+
+//
+// W_ResetMisses
+// Clears the count of lumps that W_CacheLumpNum had to read.
+//
+void W_ResetMisses (void)
+{
+    nummisses = 0;
+    misstime = 0;
+}
+
+//
+// W_GetMisses
+// Returns the number of lumps that W_CacheLumpNum had to read
+//  since W_ResetMisses, and the time it took in usec.
+//
+int W_GetMisses (long long* time)
+{
+    *time = misstime;
+    return nummisses;
+}
+
 //
 // W_CacheLumpNum
 //
@@ -450,16 +981,25 @@ W_CacheLumpNum
 ( int           lump,
   int           tag )
 {
+    long long   starttime;
+
     if (lump < 0 || lump >= numlumps)
         I_Error ("W_CacheLumpNum: %i >= numlumps",lump);
 
+    // being prefetched?
+    if (!lumpcache[lump] && prefetchslot && prefetchslot[lump] >= 0)
+        W_AdoptPrefetch (prefetchslot[lump], true);
+
     if (!lumpcache[lump])
     {
         // read the lump in
 
         //printf ("cache miss on lump %i\n",lump);
+        starttime = I_GetTimeUS ();
         Z_Malloc (W_LumpLength (lump), tag, &lumpcache[lump]);
         W_ReadLump (lump, lumpcache[lump]);
+        nummisses++;
+        misstime += I_GetTimeUS () - starttime;
     }
     else
     {
@@ -538,3 +1078,16 @@ void W_Profile (void)
     fclose (f);
 }
 
+//
+// W_PrintStats
+//
+void W_PrintStats (void)
+{
+    printf ("W_PrintStats: %d lumps, %lld bytes read, %lld bytes loaded, "
+            "%.1f ms, %d bytes scratch\n",
+            numreads,
+            bytesread,
+            bytesloaded,
+            readtime / 1000.0,
+            scratchsize);
+}
@@ -41,6 +41,18 @@ typedef struct
 
 } filelump_t;
 
+// Directory entry of a compressed "CWAD" file. The header is the
+// same as for a WAD. A lump is stored as is when csize == size,
+// otherwise it is compressed with LZ_Compress.
+typedef struct
+{
+    int                 filepos;
+    int                 size;
+    int                 csize;
+    char                name[8];
+
+} cfilelump_t;
+
 //
 // WADFILE I/O related stuff.
 //
@@ -50,6 +62,7 @@ typedef struct
     int         handle;
     int         position;
     int         size;
+    int         csize;
 } lumpinfo_t;
 
 extern  void**          lumpcache;
@@ -62,10 +75,28 @@ void    W_Reload (void);
 int     W_CheckNumForName (const char* name);
 int     W_GetNumForName (const char* name);
 
+unsigned W_Checksum (void);
+
 int     W_LumpLength (int lump);
 void    W_ReadLump (int lump, void *dest);
 
+// File handle and position of an uncompressed lump, or -1.
+int     W_LumpFile (int lump, int* position);
+
 void*   W_CacheLumpNum (int lump, int tag);
 void*   W_CacheLumpName (const char *name, int tag);
 
+// Background reading of lumps that will be needed soon.
+void    W_StartPrefetch (const int* lumps, int count);
+void    W_UpdatePrefetch (void);
+int     W_PrefetchDone (void);
+void    W_FinishPrefetch (void);
+
+// Lumps that W_CacheLumpNum had to read from disk.
+void    W_ResetMisses (void);
+int     W_GetMisses (long long* time);
+
+// Prints how much was read from the WAD files.
+void    W_PrintStats (void);
+
 #endif  // __W_WAD__
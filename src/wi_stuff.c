@@ -142,6 +142,9 @@ typedef struct
     // actual graphics for frames of animations
     patch_t*    p[3];
 
+    // lump numbers of the frames, for the pre-scaled patch cache
+    int         lump[3];
+
     // following must be initialized to zero before use!
 
     // next value of bcnt (used in conjunction with period)
@@ -208,39 +211,39 @@ static point_t lnodes[NUMEPISODES][NUMMAPS] =
 //
 static anim_t epsd0animinfo[] =
 {
-    { ANIM_ALWAYS, TICRATE/3, 3, { 224, 104 }, 0,0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_ALWAYS, TICRATE/3, 3, { 184, 160 }, 0,0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_ALWAYS, TICRATE/3, 3, { 112, 136 }, 0,0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_ALWAYS, TICRATE/3, 3, { 72, 112 }, 0,0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_ALWAYS, TICRATE/3, 3, { 88, 96 }, 0,0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_ALWAYS, TICRATE/3, 3, { 64, 48 }, 0,0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_ALWAYS, TICRATE/3, 3, { 192, 40 }, 0,0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_ALWAYS, TICRATE/3, 3, { 136, 16 }, 0,0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_ALWAYS, TICRATE/3, 3, { 80, 16 }, 0,0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_ALWAYS, TICRATE/3, 3, { 64, 24 }, 0,0,{NULL,NULL,NULL},0,0,0,0 }
+    { ANIM_ALWAYS, TICRATE/3, 3, { 224, 104 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_ALWAYS, TICRATE/3, 3, { 184, 160 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_ALWAYS, TICRATE/3, 3, { 112, 136 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_ALWAYS, TICRATE/3, 3, { 72, 112 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_ALWAYS, TICRATE/3, 3, { 88, 96 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_ALWAYS, TICRATE/3, 3, { 64, 48 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_ALWAYS, TICRATE/3, 3, { 192, 40 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_ALWAYS, TICRATE/3, 3, { 136, 16 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_ALWAYS, TICRATE/3, 3, { 80, 16 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_ALWAYS, TICRATE/3, 3, { 64, 24 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 }
 };
 
 static anim_t epsd1animinfo[] =
 {
-    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 1, 0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 2, 0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 3, 0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 4, 0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 5, 0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 6, 0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 7, 0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_LEVEL, TICRATE/3, 3, { 192, 144 }, 8, 0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 8, 0,{NULL,NULL,NULL},0,0,0,0 }
+    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 1, 0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 2, 0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 3, 0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 4, 0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 5, 0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 6, 0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 7, 0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_LEVEL, TICRATE/3, 3, { 192, 144 }, 8, 0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_LEVEL, TICRATE/3, 1, { 128, 136 }, 8, 0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 }
 };
 
 static anim_t epsd2animinfo[] =
 {
-    { ANIM_ALWAYS, TICRATE/3, 3, { 104, 168 }, 0,0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_ALWAYS, TICRATE/3, 3, { 40, 136 }, 0,0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_ALWAYS, TICRATE/3, 3, { 160, 96 }, 0,0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_ALWAYS, TICRATE/3, 3, { 104, 80 }, 0,0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_ALWAYS, TICRATE/3, 3, { 120, 32 }, 0,0,{NULL,NULL,NULL},0,0,0,0 },
-    { ANIM_ALWAYS, TICRATE/4, 3, { 40, 0 }, 0,0,{NULL,NULL,NULL},0,0,0,0 }
+    { ANIM_ALWAYS, TICRATE/3, 3, { 104, 168 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_ALWAYS, TICRATE/3, 3, { 40, 136 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_ALWAYS, TICRATE/3, 3, { 160, 96 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_ALWAYS, TICRATE/3, 3, { 104, 80 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_ALWAYS, TICRATE/3, 3, { 120, 32 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 },
+    { ANIM_ALWAYS, TICRATE/4, 3, { 40, 0 }, 0,0,{NULL,NULL,NULL},{0,0,0},0,0,0,0 }
 };
 
 static int NUMANIMS[NUMEPISODES] =
@@ -317,9 +320,6 @@ static int              NUMCMAPS;
 //      GRAPHICS
 //
 
-// background (map of levels).
-static patch_t*         bg;
-
 // You Are Here graphic
 static patch_t*         yah[2];
 
@@ -575,7 +575,7 @@ void WI_drawAnimatedBack(void)
         {
             int dstx = TOSCREENX (a->loc.x);
             int dsty = TOSCREENY (a->loc.y);
-            V_DrawPatchScaled (dstx, dsty, FB, a->p[a->ctr]);
+            V_DrawPatchScaledNum (dstx, dsty, FB, a->lump[a->ctr]);
         }
     }
 
@@ -1509,8 +1509,7 @@ void WI_loadData(void)
     }
 
     // background
-    bg = (patch_t*)W_CacheLumpName (name, PU_CACHE);
-    V_DrawPatchScaled (0, 0, 1, bg);
+    V_DrawPatchScaledNum (0, 0, 1, W_GetNumForName (name));
 
     // UNUSED unsigned char *pic = screens[1];
     // if (gamemode == commercial)
@@ -1573,8 +1572,10 @@ void WI_loadData(void)
                             j <= 99 && i >= 0 && i <= 99)
                         {
                             sprintf (name, "WIA%d%.2d%.2d", wbs->epsd, j, i);
+                            a->lump[i] = W_GetNumForName (name);
                             a->p[i] =
-                                (patch_t*)W_CacheLumpName (name, PU_STATIC);
+                                (patch_t*)W_CacheLumpNum (a->lump[i],
+                                                          PU_STATIC);
                         }
                         else
                         {
@@ -1585,6 +1586,7 @@ void WI_loadData(void)
                     {
                         // HACK ALERT!
                         a->p[i] = anims[1][4].p[i];
+                        a->lump[i] = anims[1][4].lump[i];
                     }
                 }
             }
@@ -464,6 +464,28 @@ Z_ChangeTag2
     block->tag = tag;
 }
 
+//
+// Z_ChangeUser
+// Hands a block over to a new owner, e.g. from a
+//  staging slot to the lump cache.
+//
+void
+Z_ChangeUser
+( void*         ptr,
+  void**        user )
+{
+    memblock_t* block;
+
+    block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
+    Z_CheckBlockIntegrity (block);
+
+    if (block->id != ZONEID)
+        I_Error ("Z_ChangeUser: freed a pointer without ZONEID");
+
+    block->user = user;
+    *user = ptr;
+}
+
 //
 // Z_FreeMemory
 //
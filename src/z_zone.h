@@ -54,6 +54,7 @@ void    Z_DumpHeap (int lowtag, int hightag);
 void    Z_FileDumpHeap (FILE *f);
 void    Z_CheckHeap (void);
 void    Z_ChangeTag2 (void *ptr, int tag);
+void    Z_ChangeUser (void *ptr, void **user);
 int     Z_FreeMemory (void);
 
 typedef struct memblock_s